@@ -0,0 +1,65 @@
+#include "AllocationCounter.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+    std::atomic<std::uint64_t> g_allocations{0};
+    std::atomic<std::uint64_t> g_live_bytes{0};
+
+    //Every block starts with its size, so unsized deletes can subtract it too.
+    //The header keeps the block aligned for any fundamental type.
+    constexpr std::size_t header_size = alignof(std::max_align_t);
+
+    void* counted_allocate(std::size_t size) {
+        auto* block = static_cast<unsigned char*>(std::malloc(size + header_size));
+        if(!block) {
+            throw std::bad_alloc{};
+        }
+        *reinterpret_cast<std::size_t*>(block) = size;
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_live_bytes.fetch_add(size, std::memory_order_relaxed);
+        return block + header_size;
+    }
+
+    void counted_free(void* p) noexcept {
+        if(!p) {
+            return;
+        }
+        auto* block = static_cast<unsigned char*>(p) - header_size;
+        g_live_bytes.fetch_sub(*reinterpret_cast<std::size_t*>(block), std::memory_order_relaxed);
+        std::free(block);
+    }
+
+}
+
+AllocationCounts allocation_counts() noexcept {
+    return AllocationCounts{g_allocations.load(std::memory_order_relaxed), g_live_bytes.load(std::memory_order_relaxed)};
+}
+
+void* operator new(std::size_t size) {
+    return counted_allocate(size);
+}
+
+void* operator new[](std::size_t size) {
+    return counted_allocate(size);
+}
+
+void operator delete(void* p) noexcept {
+    counted_free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    counted_free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    counted_free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    counted_free(p);
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+
+//The benchmark executable replaces the global operator new and delete to count
+//heap allocations and the bytes they hold. Over-aligned allocations go through
+//the standard library's own operators and are not counted.
+struct AllocationCounts {
+    std::uint64_t allocations{0};
+    std::uint64_t live_bytes{0};
+};
+
+AllocationCounts allocation_counts() noexcept;
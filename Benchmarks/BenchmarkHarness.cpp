@@ -0,0 +1,100 @@
+#include "BenchmarkHarness.hpp"
+
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+volatile float g_benchmark_sink = 0.0f;
+
+namespace {
+
+    //Linear interpolation between the closest ranks of a sorted sample.
+    double percentile(const std::vector<double>& sorted, double p) {
+        if(sorted.empty()) {
+            return 0.0;
+        }
+        const auto rank = p * static_cast<double>(sorted.size() - 1);
+        const auto lower = static_cast<std::size_t>(std::floor(rank));
+        const auto upper = (std::min)(lower + 1, sorted.size() - 1);
+        const auto fraction = rank - static_cast<double>(lower);
+        return sorted[lower] + (sorted[upper] - sorted[lower]) * fraction;
+    }
+
+    std::string json_escape(const std::string& text) {
+        std::string escaped{};
+        for(const auto c : text) {
+            if(c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+}
+
+BenchmarkResult summarize(const std::string& name, std::uint64_t iterations, std::vector<double> nanoseconds_per_call) {
+    std::sort(nanoseconds_per_call.begin(), nanoseconds_per_call.end());
+    BenchmarkResult result{};
+    result.name = name;
+    result.iterations = iterations;
+    result.repetitions = static_cast<int>(nanoseconds_per_call.size());
+    if(nanoseconds_per_call.empty()) {
+        return result;
+    }
+    result.min = nanoseconds_per_call.front();
+    result.p10 = percentile(nanoseconds_per_call, 0.10);
+    result.median = percentile(nanoseconds_per_call, 0.50);
+    result.p90 = percentile(nanoseconds_per_call, 0.90);
+    result.p99 = percentile(nanoseconds_per_call, 0.99);
+    result.max = nanoseconds_per_call.back();
+    result.mean = std::accumulate(nanoseconds_per_call.begin(), nanoseconds_per_call.end(), 0.0) / static_cast<double>(nanoseconds_per_call.size());
+    return result;
+}
+
+void print_table_header(std::ostream& out) {
+    out << std::left << std::setw(40) << "benchmark (ns/call)" << std::right
+        << std::setw(12) << "median" << std::setw(12) << "p10" << std::setw(12) << "p90" << std::setw(12) << "p99"
+        << std::setw(14) << "iterations" << '\n';
+}
+
+void print_table_row(std::ostream& out, const BenchmarkResult& result) {
+    out << std::left << std::setw(40) << result.name << std::right << std::fixed << std::setprecision(2)
+        << std::setw(12) << result.median << std::setw(12) << result.p10 << std::setw(12) << result.p90 << std::setw(12) << result.p99
+        << std::setw(14) << result.iterations << '\n';
+}
+
+void write_json(std::ostream& out, const std::vector<BenchmarkResult>& results, const std::vector<std::pair<std::string, std::string>>& context) {
+    out << "{\n  \"context\": {";
+    for(std::size_t i = 0; i < context.size(); ++i) {
+        out << (i ? ", " : "") << '"' << json_escape(context[i].first) << "\": \"" << json_escape(context[i].second) << '"';
+    }
+    out << "},\n  \"benchmarks\": [\n";
+    out << std::setprecision(4) << std::fixed;
+    for(std::size_t i = 0; i < results.size(); ++i) {
+        const auto& r = results[i];
+        out << "    {\"name\": \"" << json_escape(r.name) << "\", \"iterations\": " << r.iterations << ", \"repetitions\": " << r.repetitions
+            << ", \"ns_per_call\": {\"min\": " << r.min << ", \"p10\": " << r.p10 << ", \"median\": " << r.median << ", \"p90\": " << r.p90
+            << ", \"p99\": " << r.p99 << ", \"max\": " << r.max << ", \"mean\": " << r.mean << "}}" << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    out << "  ]\n}\n";
+}
+
+void write_csv(std::ostream& out, const std::vector<BenchmarkResult>& results) {
+    out << "name,iterations,repetitions,min_ns,p10_ns,median_ns,p90_ns,p99_ns,max_ns,mean_ns\n";
+    out << std::setprecision(4) << std::fixed;
+    for(const auto& r : results) {
+        out << r.name << ',' << r.iterations << ',' << r.repetitions << ',' << r.min << ',' << r.p10 << ',' << r.median << ','
+            << r.p90 << ',' << r.p99 << ',' << r.max << ',' << r.mean << '\n';
+    }
+}
+
+BenchmarkSuite::BenchmarkSuite(const BenchmarkOptions& options, std::ostream& out)
+: _options{options}
+, _out{out} {
+    /* DO NOTHING */
+}
+
+const std::vector<BenchmarkResult>& BenchmarkSuite::results() const noexcept {
+    return _results;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct BenchmarkOptions {
+    //Calls per repetition. 0: calibrate during warmup so a repetition takes about repetition_milliseconds.
+    std::uint64_t iterations{0};
+    double repetition_milliseconds{20.0};
+    int warmup_repetitions{2};
+    int repetitions{20};
+    //Only benchmarks whose name contains this run.
+    std::string filter{};
+    std::string json_path{};
+    std::string csv_path{};
+    //Also render the cover scene at several sample counts, with and without
+    //the denoiser, and compare the time each takes to reach the same error.
+    bool time_to_quality{false};
+    //Also compare shared_ptr and SceneArena storage of a scene of this many
+    //spheres; 0 skips it.
+    std::size_t scene_storage_spheres{0};
+    //Also load this OBJ file and time its parse, BVH build and primary rays;
+    //empty skips it.
+    std::string mesh_path{};
+    //Also measure how far the fast shading math strays from the reference:
+    //per function against double precision, then over a whole image.
+    bool fast_math_accuracy{false};
+};
+
+//Nanoseconds per call over the timed repetitions of one benchmark.
+struct BenchmarkResult {
+    std::string name{};
+    std::uint64_t iterations{0};
+    int repetitions{0};
+    double min{0.0};
+    double p10{0.0};
+    double median{0.0};
+    double p90{0.0};
+    double p99{0.0};
+    double max{0.0};
+    double mean{0.0};
+};
+
+BenchmarkResult summarize(const std::string& name, std::uint64_t iterations, std::vector<double> nanoseconds_per_call);
+
+void print_table_header(std::ostream& out);
+void print_table_row(std::ostream& out, const BenchmarkResult& result);
+void write_json(std::ostream& out, const std::vector<BenchmarkResult>& results, const std::vector<std::pair<std::string, std::string>>& context);
+void write_csv(std::ostream& out, const std::vector<BenchmarkResult>& results);
+
+//Keeps the optimizer from discarding the benchmarked work.
+extern volatile float g_benchmark_sink;
+
+//Runs kernels one after another, printing each result as it finishes.
+//A kernel is called as fn(i) with the iteration index and returns a float that
+//depends on its work; the index lets it cycle through prepared inputs.
+class BenchmarkSuite {
+public:
+    BenchmarkSuite(const BenchmarkOptions& options, std::ostream& out);
+
+    //A template rather than std::function so the kernel inlines into the timing loop.
+    template<typename Fn>
+    void run(const std::string& name, Fn&& fn) {
+        if(!_options.filter.empty() && name.find(_options.filter) == std::string::npos) {
+            return;
+        }
+        auto iterations = _options.iterations ? _options.iterations : std::uint64_t{64};
+        for(int warmup = 0; warmup < (std::max)(1, _options.warmup_repetitions); ++warmup) {
+            const auto nanoseconds = time(iterations, fn);
+            if(!_options.iterations) {
+                //Grow the count until one repetition fills the requested time.
+                const auto target = _options.repetition_milliseconds * 1e6;
+                while(nanoseconds * static_cast<double>(iterations) < target && iterations < (std::uint64_t{1} << 32u)) {
+                    iterations *= 2;
+                    if(time(iterations, fn) * static_cast<double>(iterations) >= target) {
+                        break;
+                    }
+                }
+            }
+        }
+        std::vector<double> samples{};
+        samples.reserve(static_cast<std::size_t>(_options.repetitions));
+        for(int repetition = 0; repetition < _options.repetitions; ++repetition) {
+            samples.push_back(time(iterations, fn));
+        }
+        _results.emplace_back(summarize(name, iterations, std::move(samples)));
+        print_table_row(_out, _results.back());
+    }
+
+    const std::vector<BenchmarkResult>& results() const noexcept;
+
+protected:
+private:
+    //Nanoseconds per call of one repetition.
+    template<typename Fn>
+    double time(std::uint64_t iterations, Fn& fn) {
+        float sum = 0.0f;
+        const auto start = std::chrono::steady_clock::now();
+        for(std::uint64_t i = 0; i < iterations; ++i) {
+            sum += fn(i);
+        }
+        const auto end = std::chrono::steady_clock::now();
+        g_benchmark_sink = sum;
+        return std::chrono::duration<double, std::nano>(end - start).count() / static_cast<double>(iterations);
+    }
+
+    BenchmarkOptions _options{};
+    std::ostream& _out;
+    std::vector<BenchmarkResult> _results{};
+};
@@ -0,0 +1,41 @@
+#include "OutOfLineVector3.hpp"
+
+#include <cmath>
+
+namespace out_of_line {
+
+    Vector3 add(const Vector3& u, const Vector3& v) {
+        return Vector3{ u.x() + v.x(), u.y() + v.y(), u.z() + v.z() };
+    }
+
+    Vector3 sub(const Vector3& u, const Vector3& v) {
+        return Vector3{ u.x() - v.x(), u.y() - v.y(), u.z() - v.z() };
+    }
+
+    Vector3 mul(const Vector3& u, const Vector3& v) {
+        return Vector3{ u.x() * v.x(), u.y() * v.y(), u.z() * v.z() };
+    }
+
+    Vector3 scale(float t, const Vector3& v) {
+        return Vector3{ t * v.x(), t * v.y(), t * v.z() };
+    }
+
+    float dot(const Vector3& u, const Vector3& v) {
+        return u.x() * v.x() + u.y() * v.y() + u.z() * v.z();
+    }
+
+    Vector3 cross(const Vector3& u, const Vector3& v) {
+        return Vector3{ u.y() * v.z() - u.z() * v.y(),
+                       u.z() * v.x() - u.x() * v.z(),
+                       u.x() * v.y() - u.y() * v.x() };
+    }
+
+    Vector3 unit_vector(const Vector3& v) {
+        return scale(1.0f / std::sqrt(out_of_line::dot(v, v)), v);
+    }
+
+    Vector3 reflect(const Vector3& v, const Vector3& n) {
+        return sub(v, scale(2.0f * out_of_line::dot(v, n), n));
+    }
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Vector3.hpp"
+
+//The Vector3 operations as they were before Vector3 became header-only: defined
+//in their own translation unit, so every call is a real call. Marked noinline
+//so link-time code generation does not erase the difference being measured.
+#if defined(_MSC_VER)
+    #define RTIOW_NOINLINE __declspec(noinline)
+#else
+    #define RTIOW_NOINLINE __attribute__((noinline))
+#endif
+
+namespace out_of_line {
+
+    RTIOW_NOINLINE Vector3 add(const Vector3& u, const Vector3& v);
+    RTIOW_NOINLINE Vector3 sub(const Vector3& u, const Vector3& v);
+    RTIOW_NOINLINE Vector3 mul(const Vector3& u, const Vector3& v);
+    RTIOW_NOINLINE Vector3 scale(float t, const Vector3& v);
+    RTIOW_NOINLINE float dot(const Vector3& u, const Vector3& v);
+    RTIOW_NOINLINE Vector3 cross(const Vector3& u, const Vector3& v);
+    RTIOW_NOINLINE Vector3 unit_vector(const Vector3& v);
+    RTIOW_NOINLINE Vector3 reflect(const Vector3& v, const Vector3& n);
+
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Hittable.hpp"
+
+#include <memory>
+#include <vector>
+
+//HittableList as it was before scenes kept their objects in a SceneArena:
+//every object its own shared_ptr allocation, with a control block and an
+//atomic reference count next to it.
+class SharedPtrHittableList : public Hittable {
+public:
+    void add(std::shared_ptr<Hittable> object) {
+        m_objects.emplace_back(object);
+    }
+
+    const std::vector<std::shared_ptr<Hittable>>& objects() const {
+        return m_objects;
+    }
+
+    bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override {
+        hit_record temp_rec{};
+        bool hit_anything = false;
+        auto closest = t_max;
+        for(const auto& object : m_objects) {
+            if(object->hit(r, t_min, closest, temp_rec)) {
+                hit_anything = true;
+                closest = temp_rec.t;
+                rec = temp_rec;
+            }
+        }
+        return hit_anything;
+    }
+
+    bool bounding_box(Aabb& output_box) const override {
+        if(m_objects.empty()) {
+            return false;
+        }
+        output_box = Aabb::empty();
+        for(const auto& object : m_objects) {
+            Aabb object_box{};
+            if(!object->bounding_box(object_box)) {
+                return false;
+            }
+            output_box.expand(object_box);
+        }
+        return true;
+    }
+protected:
+private:
+    std::vector<std::shared_ptr<Hittable>> m_objects;
+};
@@ -0,0 +1,880 @@
+#include "AllocationCounter.hpp"
+#include "BenchmarkHarness.hpp"
+#include "OutOfLineVector3.hpp"
+#include "SharedPtrHittableList.hpp"
+
+#include "Bvh.hpp"
+#include "Camera.hpp"
+#include "Color.hpp"
+#include "Denoiser.hpp"
+#include "Framebuffer.hpp"
+#include "MaterialKernels.hpp"
+#include "MathUtils.hpp"
+#include "ObjLoader.hpp"
+#include "Random.hpp"
+#include "Renderer.hpp"
+#include "Sampler.hpp"
+#include "Scene.hpp"
+#include "SceneArena.hpp"
+#include "ShadingMath.hpp"
+#include "Sphere3.hpp"
+#include "SphereBatch.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleMesh.hpp"
+#include "Vector3.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    //The generator random_float() used before the PCG32 sampler: a function-local
+    //engine plus a distribution constructed on every call.
+    float legacy_random_float() {
+        std::uniform_real_distribution<float> d(0.0f, 1.0f);
+        static std::mt19937 g;
+        return d(g);
+    }
+
+    void print_usage(std::ostream& out, const char* program) {
+        out << "Usage: " << program << " [iterations] [options]\n"
+            << "  --iterations N    calls per repetition (default: calibrated to ~20 ms)\n"
+            << "  --repetitions N   timed repetitions per benchmark (default: 20)\n"
+            << "  --warmup N        untimed repetitions per benchmark (default: 2)\n"
+            << "  --filter TEXT     only run benchmarks whose name contains TEXT\n"
+            << "  --json FILE       write the results as JSON\n"
+            << "  --csv FILE        write the results as CSV\n"
+            << "  --time-to-quality compare samplers and the denoiser with brute force at equal error\n"
+            << "  --scene-storage N compare shared_ptr and arena storage of a scene of N spheres\n"
+            << "  --mesh FILE       time loading, building and tracing the OBJ mesh in FILE\n"
+            << "  --fast-math-accuracy  measure the fast shading math's error per function and over the cover scene\n";
+    }
+
+    int to_non_negative_int(const std::string& option, const std::string& value) {
+        try {
+            const auto result = std::stoi(value);
+            if(result >= 0) {
+                return result;
+            }
+        } catch(const std::exception&) {
+            /* DO NOTHING */
+        }
+        throw std::invalid_argument(option + " needs a non-negative integer, got '" + value + "'");
+    }
+
+    BenchmarkOptions parse_command_line(int argc, char** argv) {
+        BenchmarkOptions options{};
+        for(int i = 1; i < argc; ++i) {
+            const std::string arg{argv[i]};
+            const auto next = [&]() -> std::string {
+                if(i + 1 >= argc) {
+                    throw std::invalid_argument(arg + " needs a value");
+                }
+                return argv[++i];
+            };
+            if(arg == "--iterations") {
+                options.iterations = static_cast<std::uint64_t>(to_non_negative_int(arg, next()));
+            } else if(arg == "--repetitions") {
+                options.repetitions = (std::max)(1, to_non_negative_int(arg, next()));
+            } else if(arg == "--warmup") {
+                options.warmup_repetitions = to_non_negative_int(arg, next());
+            } else if(arg == "--filter") {
+                options.filter = next();
+            } else if(arg == "--json") {
+                options.json_path = next();
+            } else if(arg == "--csv") {
+                options.csv_path = next();
+            } else if(arg == "--time-to-quality") {
+                options.time_to_quality = true;
+            } else if(arg == "--scene-storage") {
+                options.scene_storage_spheres = static_cast<std::size_t>(to_non_negative_int(arg, next()));
+            } else if(arg == "--mesh") {
+                options.mesh_path = next();
+            } else if(arg == "--fast-math-accuracy") {
+                options.fast_math_accuracy = true;
+            } else if(i == 1 && !arg.empty() && arg[0] != '-') {
+                options.iterations = static_cast<std::uint64_t>(to_non_negative_int("iterations", arg));
+            } else {
+                throw std::invalid_argument("Unknown option " + arg);
+            }
+        }
+        return options;
+    }
+
+    const char* vector3_storage_name() {
+#if defined(RTIOW_VECTOR3_SSE)
+        return "SSE 4-lane";
+#elif defined(RTIOW_VECTOR3_NEON)
+        return "NEON 4-lane";
+#else
+        return "scalar";
+#endif
+    }
+
+    //Index mask for the tables of prepared inputs; a power of two so cycling is a single and.
+    constexpr std::uint64_t input_mask = 1023u;
+
+    //Root mean square difference of two images after the encoders' clamp and
+    //gamma, so it measures the error a viewer would see.
+    double display_rmse(const Framebuffer& image, const Framebuffer& reference) {
+        const auto display = [](float linear) { return (std::min)(1.0, std::sqrt(static_cast<double>((std::max)(0.0f, linear)))); };
+        double sum = 0.0;
+        for(std::size_t i = 0; i < image.pixel_count(); ++i) {
+            const auto a = image.average(i);
+            const auto b = reference.average(i);
+            for(int c = 0; c < 3; ++c) {
+                const auto d = display(a[c]) - display(b[c]);
+                sum += d * d;
+            }
+        }
+        return std::sqrt(sum / (3.0 * static_cast<double>(image.pixel_count())));
+    }
+
+    //A way of spending samples, compared against independent sampling without denoising.
+    struct QualityMethod {
+        const char* name{""};
+        SamplerType sampler{SamplerType::Independent};
+        bool denoised{false};
+        int max_samples_per_pixel{32};
+    };
+
+    constexpr QualityMethod quality_methods[] = {
+        {"brute_force", SamplerType::Independent, false, 128}
+        ,{"stratified", SamplerType::Stratified, false, 32}
+        ,{"sobol", SamplerType::Sobol, false, 32}
+        ,{"blue_noise", SamplerType::BlueNoise, false, 32}
+        ,{"denoised", SamplerType::Independent, true, 32}
+    };
+
+    struct QualityPoint {
+        const QualityMethod* method{nullptr};
+        int samples_per_pixel{0};
+        double seconds{0.0};
+        double rmse{0.0};
+    };
+
+    //Renders the cover scene at the renderer's default size and increasing
+    //sample counts with every quality method, and prints each one's time and
+    //error against a high sample count reference, then the sample count and
+    //time brute force needs to match each other render's error.
+    void run_time_to_quality(const Scene& scene, const Hittable& world, std::ostream& out) {
+        constexpr int width = 400;
+        constexpr int height = 266;
+        constexpr int reference_samples = 512;
+        const auto camera = random_scene_camera(static_cast<float>(width) / height);
+        ThreadPool pool{ThreadPool::default_thread_count()};
+        const auto tiles = make_tiles(width, height, 16);
+        const auto render_image = [&](int samples_per_pixel, const QualityMethod& method, Framebuffer& image) {
+            auto settings = RenderSettings{width, height, samples_per_pixel};
+            settings.sampler = method.sampler;
+            settings.report_progress = false;
+            const auto start = std::chrono::steady_clock::now();
+            render(world, scene.materials, camera, settings, pool, tiles, image);
+            if(method.denoised) {
+                const auto aovs = render_aovs(world, scene.materials, camera, settings, pool, tiles, (std::min)(samples_per_pixel, 8));
+                denoise(image, aovs, DenoiseSettings{}, pool);
+            }
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        Framebuffer reference{width, height};
+        const auto reference_seconds = render_image(reference_samples, quality_methods[0], reference);
+        out << "\nTime to quality: " << width << 'x' << height << ", error against a " << reference_samples << " spp reference ("
+            << std::fixed << std::setprecision(1) << reference_seconds << " s)\n"
+            << "method        spp   seconds      rmse\n";
+        std::vector<QualityPoint> points{};
+        for(const auto& method : quality_methods) {
+            for(int spp = 4; spp <= method.max_samples_per_pixel; spp *= 2) {
+                Framebuffer image{width, height};
+                const auto seconds = render_image(spp, method, image);
+                points.emplace_back(QualityPoint{&method, spp, seconds, display_rmse(image, reference)});
+                out << std::left << std::setw(12) << method.name << std::right << std::setw(5) << spp
+                    << std::setw(10) << std::setprecision(3) << seconds << std::setw(10) << std::setprecision(5) << points.back().rmse << '\n';
+            }
+        }
+        //Brute-force error against sample count is close to a straight line in
+        //log-log space; read the other errors off it between the nearest
+        //measured points, extending the end segments for errors outside them.
+        std::vector<QualityPoint> brute{};
+        std::copy_if(points.begin(), points.end(), std::back_inserter(brute), [](const QualityPoint& p) { return p.method == &quality_methods[0]; });
+        for(const auto& point : points) {
+            if(point.method == &quality_methods[0]) {
+                continue;
+            }
+            std::size_t segment = 0;
+            while(segment + 2 < brute.size() && brute[segment + 1].rmse > point.rmse) {
+                ++segment;
+            }
+            const auto& lo = brute[segment];
+            const auto& hi = brute[segment + 1];
+            const auto t = std::log(point.rmse / lo.rmse) / std::log(hi.rmse / lo.rmse);
+            const auto brute_samples = lo.samples_per_pixel * std::pow(static_cast<double>(hi.samples_per_pixel) / lo.samples_per_pixel, t);
+            const auto brute_seconds = lo.seconds + (hi.seconds - lo.seconds) * (brute_samples - lo.samples_per_pixel) / (hi.samples_per_pixel - lo.samples_per_pixel);
+            out << point.method->name << ' ' << point.samples_per_pixel << " spp (" << std::setprecision(3) << point.seconds << " s) matches brute force at about "
+                << std::setprecision(0) << brute_samples << " spp (" << std::setprecision(3) << brute_seconds << " s): "
+                << std::setprecision(2) << brute_seconds / point.seconds << "x the time\n";
+        }
+        out << std::defaultfloat;
+    }
+
+    //What one way of storing a scene's primitives costs, from building the list
+    //to tearing it down.
+    struct StorageResult {
+        double build_ms{0.0};
+        std::uint64_t allocations{0};
+        std::uint64_t bytes{0};
+        double list_ns_per_test{0.0};
+        double bvh_ns_per_ray{0.0};
+        double teardown_ms{0.0};
+    };
+
+    double milliseconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //Nanoseconds per ray for world.hit over all the rays.
+    double time_rays(const Hittable& world, const std::vector<Ray3>& rays) {
+        const auto start = std::chrono::steady_clock::now();
+        for(const auto& r : rays) {
+            hit_record rec{};
+            world.hit(r, 0.001f, infinity, rec);
+        }
+        return milliseconds_since(start) * 1e6 / static_cast<double>(rays.size());
+    }
+
+    //Builds a scene of `count` small spheres on a jittered grid once with a
+    //shared_ptr per sphere, as scenes were stored before SceneArena, and once
+    //in an arena, and prints what each costs to build, hold, trace and free.
+    //The list scan tests every sphere for a few rays; the BVH traces many rays
+    //through Objects leaves, which dereference one sphere pointer per test, so
+    //it shows how well the spheres' placement in memory suits the cache.
+    void run_scene_storage(std::size_t count, std::ostream& out) {
+        const auto side = (std::max)(std::size_t{1}, static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(count)))));
+        SphereBatch spheres{};
+        spheres.reserve(count);
+        seed_thread_rng(make_path_key(0, 0, 1), 0);
+        for(std::size_t i = 0; i < count; ++i) {
+            const auto x = static_cast<float>(i % side) + random_float(0.2f, 0.8f);
+            const auto z = static_cast<float>(i / side) + random_float(0.2f, 0.8f);
+            spheres.add(Point3{x, 0.2f, z}, 0.2f, static_cast<MaterialId>(i % 4u));
+        }
+        //Rays from above the grid at random points of it, so every one lands on
+        //the spheres or the gaps between them.
+        const auto extent = static_cast<float>(side);
+        std::vector<Ray3> bvh_rays(std::size_t{1} << 16u);
+        for(auto& r : bvh_rays) {
+            const auto target = Point3{random_float(0.0f, extent), 0.0f, random_float(0.0f, extent)};
+            const auto origin = Point3{random_float(0.0f, extent), 10.0f, random_float(0.0f, extent)};
+            r = Ray3{origin, target - origin};
+        }
+        const std::vector<Ray3> list_rays(bvh_rays.begin(), bvh_rays.begin() + 8);
+
+        const auto measure_traversal = [&](const Hittable& list, const HittableList& pointers, StorageResult& result) {
+            result.list_ns_per_test = time_rays(list, list_rays) / static_cast<double>((std::max)(count, std::size_t{1}));
+            const Bvh bvh{pointers, BvhLeafFormat::Objects};
+            result.bvh_ns_per_ray = time_rays(bvh, bvh_rays);
+        };
+
+        StorageResult shared{};
+        {
+            const auto before = allocation_counts();
+            auto start = std::chrono::steady_clock::now();
+            auto list = std::make_unique<SharedPtrHittableList>();
+            for(std::size_t i = 0; i < spheres.size(); ++i) {
+                list->add(std::make_shared<Sphere3>(spheres.center(i), spheres.radius(i), spheres.material_id(i)));
+            }
+            shared.build_ms = milliseconds_since(start);
+            const auto after = allocation_counts();
+            shared.allocations = after.allocations - before.allocations;
+            shared.bytes = after.live_bytes - before.live_bytes;
+            HittableList pointers{};
+            pointers.reserve(list->objects().size());
+            for(const auto& object : list->objects()) {
+                pointers.add(object.get());
+            }
+            measure_traversal(*list, pointers, shared);
+            start = std::chrono::steady_clock::now();
+            list.reset();
+            shared.teardown_ms = milliseconds_since(start);
+        }
+
+        StorageResult arena{};
+        {
+            const auto before = allocation_counts();
+            auto start = std::chrono::steady_clock::now();
+            auto storage = std::make_unique<SceneArena>();
+            auto list = std::make_unique<HittableList>(make_sphere_list(spheres, *storage));
+            arena.build_ms = milliseconds_since(start);
+            const auto after = allocation_counts();
+            arena.allocations = after.allocations - before.allocations;
+            arena.bytes = after.live_bytes - before.live_bytes;
+            measure_traversal(*list, *list, arena);
+            start = std::chrono::steady_clock::now();
+            list.reset();
+            storage.reset();
+            arena.teardown_ms = milliseconds_since(start);
+        }
+
+        out << "\nScene storage: " << count << " spheres (" << sizeof(Sphere3) << " bytes each)\n"
+            << "storage     build ms  allocations    MB held  list ns/test  bvh ns/ray  teardown ms\n"
+            << std::fixed;
+        const auto print_row = [&out](const char* name, const StorageResult& result) {
+            out << std::left << std::setw(10) << name << std::right
+                << std::setw(10) << std::setprecision(1) << result.build_ms
+                << std::setw(13) << result.allocations
+                << std::setw(11) << std::setprecision(1) << static_cast<double>(result.bytes) / (1024.0 * 1024.0)
+                << std::setw(14) << std::setprecision(2) << result.list_ns_per_test
+                << std::setw(12) << std::setprecision(0) << result.bvh_ns_per_ray
+                << std::setw(13) << std::setprecision(1) << result.teardown_ms << '\n';
+        };
+        print_row("shared_ptr", shared);
+        print_row("arena", arena);
+        out << std::defaultfloat;
+    }
+
+    //A UV sphere of 2 * rings * rings triangles, those at the poles degenerate,
+    //so triangle and analytic sphere tests can be timed on the same shape.
+    MeshBuffers tessellate_sphere(const Point3& center, float radius, int rings) {
+        MeshBuffers mesh{};
+        const auto segments = rings * 2;
+        for(int i = 0; i <= rings; ++i) {
+            const auto theta = pi * static_cast<float>(i) / static_cast<float>(rings);
+            for(int j = 0; j < segments; ++j) {
+                const auto phi = 2.0f * pi * static_cast<float>(j) / static_cast<float>(segments);
+                const auto p = center + radius * Vector3{std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+                mesh.positions.insert(mesh.positions.end(), {p.x(), p.y(), p.z()});
+            }
+        }
+        for(int i = 0; i < rings; ++i) {
+            for(int j = 0; j < segments; ++j) {
+                const auto a = static_cast<std::uint32_t>(i * segments + j);
+                const auto b = static_cast<std::uint32_t>(i * segments + (j + 1) % segments);
+                const auto c = a + static_cast<std::uint32_t>(segments);
+                const auto d = b + static_cast<std::uint32_t>(segments);
+                mesh.indices.insert(mesh.indices.end(), {a, c, d, a, d, b});
+            }
+        }
+        return mesh;
+    }
+
+    //Loads an OBJ file as a scene's mesh statement does and prints how long
+    //parsing it and building its BVH take, then traces primary rays at it on
+    //one thread next to as many rays through the cover scene.
+    //Writes an OBJ file of triangles that each use "f -3 -2 -1" on their own
+    //three vertices, large enough to be parsed in several chunks, loads it on
+    //four threads, and throws std::runtime_error unless every triangle got its
+    //own vertices, including those whose face and vertices straddle a chunk
+    //boundary.
+    void check_relative_obj_indices(std::ostream& out) {
+        constexpr std::uint32_t triangle_count = 200'000;
+        const auto path = (std::filesystem::temp_directory_path() / "rtiow_relative_indices.obj").string();
+        {
+            std::ofstream file{path, std::ios_base::binary};
+            for(std::uint32_t i = 0; i < triangle_count; ++i) {
+                file << "v " << i << " 0 0\nv " << i << " 1 0\nv " << i << " 0 1\nf -3 -2 -1\n";
+            }
+            if(!file) {
+                throw std::runtime_error("Could not write " + path);
+            }
+        }
+        ThreadPool pool{4};
+        const auto buffers = load_obj(path, pool);
+        std::filesystem::remove(path);
+        std::size_t wrong = 0;
+        for(std::uint32_t i = 0; i < buffers.indices.size(); ++i) {
+            wrong += buffers.indices[i] != i ? 1u : 0u;
+        }
+        if(buffers.indices.size() != std::size_t{3} * triangle_count || wrong > 0) {
+            throw std::runtime_error("Relative OBJ indices resolved wrongly across chunks: " + std::to_string(wrong) + " corners");
+        }
+        out << "Relative OBJ indices across chunks: " << triangle_count << " triangles on " << pool.thread_count() << " threads, all correct\n";
+    }
+
+    void run_mesh(const std::string& path, const Hittable& cover, const Camera& cover_camera, std::ostream& out) {
+        check_relative_obj_indices(out);
+        ThreadPool pool{ThreadPool::default_thread_count()};
+        auto start = std::chrono::steady_clock::now();
+        auto buffers = load_obj(path, pool);
+        const auto load_ms = milliseconds_since(start);
+        start = std::chrono::steady_clock::now();
+        const TriangleMesh mesh{std::move(buffers), 0};
+        const auto build_ms = milliseconds_since(start);
+
+        Aabb bounds{};
+        if(!mesh.bounding_box(bounds)) {
+            throw std::runtime_error(path + " has no faces");
+        }
+        const auto center = bounds.centroid();
+        const auto extent = (bounds.maximum - bounds.minimum).length();
+        const auto camera = make_camera(CameraDesc{center + extent * Vector3{0.0f, 0.25f, 1.0f}, center, Vector3{0.0f, 1.0f, 0.0f}, 40.0f, 0.0f, extent}, 1.0f);
+        std::vector<Ray3> mesh_rays(std::size_t{1} << 18u);
+        std::vector<Ray3> cover_rays(mesh_rays.size());
+        seed_thread_rng(make_path_key(0, 0, 2), 0);
+        for(std::size_t i = 0; i < mesh_rays.size(); ++i) {
+            mesh_rays[i] = camera.get_ray(random_float(), random_float());
+            cover_rays[i] = cover_camera.get_ray(random_float(), random_float());
+        }
+        std::size_t hits = 0;
+        for(const auto& r : mesh_rays) {
+            hit_record rec{};
+            hits += mesh.hit(r, 0.001f, infinity, rec) ? 1u : 0u;
+        }
+        const auto mesh_ns = time_rays(mesh, mesh_rays);
+        const auto cover_ns = time_rays(cover, cover_rays);
+
+        out << "\nMesh: " << path << ", " << mesh.triangle_count() << " triangles, " << mesh.vertex_count() << " vertices\n"
+            << std::fixed << std::setprecision(1)
+            << "load " << load_ms << " ms on " << pool.thread_count() << " threads, BVH " << build_ms << " ms\n"
+            << mesh.build_stats() << '\n'
+            << "primary rays, one thread: mesh " << std::setprecision(2) << 1e3 / mesh_ns << " Mrays/s ("
+            << std::setprecision(1) << 100.0 * static_cast<double>(hits) / static_cast<double>(mesh_rays.size()) << "% hit), cover scene "
+            << std::setprecision(2) << 1e3 / cover_ns << " Mrays/s\n"
+            << std::defaultfloat;
+    }
+
+    //Absolute error of one function over many inputs.
+    struct ErrorStats {
+        double max{0.0};
+        double sum{0.0};
+        std::uint64_t count{0};
+
+        void add(double error) {
+            max = (std::max)(max, error);
+            sum += error;
+            ++count;
+        }
+        double mean() const {
+            return count ? sum / static_cast<double>(count) : 0.0;
+        }
+    };
+
+    using Double3 = std::array<double, 3>;
+
+    Double3 to_double3(const Vector3& v) {
+        return {v.x(), v.y(), v.z()};
+    }
+
+    double dot_double(const Double3& a, const Double3& b) {
+        return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+    }
+
+    //Largest component difference.
+    double vector_error(const Vector3& v, const Double3& truth) {
+        return (std::max)({std::abs(v.x() - truth[0]), std::abs(v.y() - truth[1]), std::abs(v.z() - truth[2])});
+    }
+
+    //Compares the reference and fast shading math with the same function in
+    //double precision over random inputs, then renders the cover scene in each
+    //and prints how far apart the images are next to how far apart two
+    //reference renders with different seeds are, which is the noise the
+    //difference has to hide in.
+    void run_fast_math_accuracy(const Scene& scene, const Hittable& world, std::ostream& out) {
+        constexpr int input_count = 1 << 20;
+        std::mt19937 engine{2024u};
+        std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+        const auto random_direction = [&]() {
+            Vector3 v{};
+            do {
+                v = Vector3{2.0f * unit(engine) - 1.0f, 2.0f * unit(engine) - 1.0f, 2.0f * unit(engine) - 1.0f};
+            } while(v.length_squared() < 1e-4f || v.length_squared() > 1.0f);
+            return v;
+        };
+        std::array<std::pair<ErrorStats, ErrorStats>, 2> errors{};
+        auto& [schlick_reference, schlick_fast] = errors[0];
+        auto& [refract_reference, refract_fast] = errors[1];
+        for(int i = 0; i < input_count; ++i) {
+            //Schlick over every cosine, entering and leaving glass.
+            const auto cosine = unit(engine);
+            const auto ref_idx = (i & 1) ? 1.5f : 1.0f / 1.5f;
+            const auto r0 = std::pow((1.0 - ref_idx) / (1.0 + ref_idx), 2.0);
+            const auto schlick = r0 + (1.0 - r0) * std::pow(1.0 - cosine, 5.0);
+            schlick_reference.add(std::abs(schlick_reflectance(cosine, ref_idx) - schlick));
+            schlick_fast.add(std::abs(fast_schlick_reflectance(cosine, ref_idx) - schlick));
+
+            //Refraction of a unit direction into the hemisphere the normal faces
+            //away from, skipped where it would be total internal reflection.
+            const auto uv = unit_vector(random_direction());
+            auto n = unit_vector(random_direction());
+            if(dot(uv, n) > 0.0f) {
+                n = -n;
+            }
+            const auto cos_theta = (std::min)(dot(-uv, n), 1.0f);
+            if(ref_idx * ref_idx * (1.0f - cos_theta * cos_theta) > 1.0f) {
+                continue;
+            }
+            const auto uv_d = to_double3(uv);
+            const auto n_d = to_double3(n);
+            const auto cos_d = (std::min)(-dot_double(uv_d, n_d), 1.0);
+            Double3 refracted{};
+            double perpendicular_squared = 0.0;
+            for(int c = 0; c < 3; ++c) {
+                refracted[c] = ref_idx * (uv_d[c] + cos_d * n_d[c]);
+                perpendicular_squared += refracted[c] * refracted[c];
+            }
+            const auto parallel = std::sqrt(std::abs(1.0 - perpendicular_squared));
+            for(int c = 0; c < 3; ++c) {
+                refracted[c] -= parallel * n_d[c];
+            }
+            refract_reference.add(vector_error(refract(uv, n, ref_idx), refracted));
+            refract_fast.add(vector_error(fast_refract(uv, n, ref_idx, cos_theta), refracted));
+        }
+        const char* names[] = {"schlick", "refract"};
+        out << "\nFast shading math: absolute error against double precision over " << input_count << " inputs\n"
+            << "function              reference max     mean        fast max     mean\n" << std::scientific << std::setprecision(2);
+        for(std::size_t i = 0; i < errors.size(); ++i) {
+            out << std::left << std::setw(18) << names[i] << std::right << std::setw(16) << errors[i].first.max << std::setw(10) << errors[i].first.mean()
+                << std::setw(16) << errors[i].second.max << std::setw(10) << errors[i].second.mean() << '\n';
+        }
+
+        constexpr int width = 400;
+        constexpr int height = 266;
+        constexpr int samples_per_pixel = 32;
+        const auto camera = random_scene_camera(static_cast<float>(width) / height);
+        ThreadPool pool{ThreadPool::default_thread_count()};
+        const auto tiles = make_tiles(width, height, 16);
+        const auto render_image = [&](ShadingMath math, std::uint64_t seed, Framebuffer& image) {
+            auto settings = RenderSettings{width, height, samples_per_pixel};
+            settings.seed = seed;
+            settings.shading_math = math;
+            settings.report_progress = false;
+            const auto start = std::chrono::steady_clock::now();
+            render(world, scene.materials, camera, settings, pool, tiles, image);
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        Framebuffer reference{width, height};
+        Framebuffer fast{width, height};
+        Framebuffer reseeded{width, height};
+        const auto reference_seconds = render_image(ShadingMath::Reference, 0, reference);
+        const auto fast_seconds = render_image(ShadingMath::Fast, 0, fast);
+        render_image(ShadingMath::Reference, 1, reseeded);
+        std::size_t changed_pixels = 0;
+        for(std::size_t i = 0; i < reference.pixel_count(); ++i) {
+            const auto a = reference.average(i);
+            const auto b = fast.average(i);
+            changed_pixels += (to_display_byte(a.x()) != to_display_byte(b.x()) || to_display_byte(a.y()) != to_display_byte(b.y())
+                               || to_display_byte(a.z()) != to_display_byte(b.z())) ? 1u : 0u;
+        }
+        out << std::fixed << "Cover scene, " << width << 'x' << height << " at " << samples_per_pixel << " spp: reference "
+            << std::setprecision(3) << reference_seconds << " s, fast " << fast_seconds << " s (" << std::setprecision(2) << reference_seconds / fast_seconds << "x)\n"
+            << "rmse fast vs reference, same seed: " << std::setprecision(5) << display_rmse(fast, reference) << ", "
+            << std::setprecision(1) << 100.0 * static_cast<double>(changed_pixels) / static_cast<double>(reference.pixel_count()) << "% of pixels changed\n"
+            << "rmse reference vs reference, another seed: " << std::setprecision(5) << display_rmse(reseeded, reference) << '\n'
+            << std::defaultfloat;
+    }
+
+    //A hit on a surface of one material type, with the ray that made it.
+    struct ScatterInput {
+        Ray3 ray{};
+        hit_record rec{};
+    };
+
+}
+
+int main(int argc, char** argv) {
+    const auto options = [argc, argv]() {
+        try {
+            return parse_command_line(argc, argv);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            print_usage(std::cerr, argv[0]);
+            std::exit(1);
+        }
+    }();
+
+    //The cover scene and its camera are built before anything else draws random
+    //numbers, so the scene is the one the renderer draws.
+    const auto scene = random_scene();
+    const auto camera = random_scene_camera(16.0f / 9.0f);
+    const Bvh bvh{scene.world, BvhLeafFormat::SphereBatch};
+
+    //Camera rays through a jittered grid, and the first hit of each, sorted by
+    //the material it landed on so every scatter branch has its own inputs.
+    std::vector<Ray3> camera_rays(input_mask + 1);
+    std::array<std::vector<ScatterInput>, 4> hits_by_type{};
+    std::vector<ScatterInput> all_hits{};
+    seed_thread_rng(make_path_key(0, 0, 0), 0);
+    for(std::size_t i = 0; i < camera_rays.size(); ++i) {
+        camera_rays[i] = camera.get_ray(random_float(), random_float());
+    }
+    for(std::uint64_t i = 0; all_hits.size() < 4096 && i < 1'000'000; ++i) {
+        const auto r = camera.get_ray(random_float(), random_float());
+        ScatterInput input{r, hit_record{}};
+        if(bvh.hit(r, 0.001f, infinity, input.rec)) {
+            hits_by_type[static_cast<std::size_t>(scene.materials[input.rec.material_id].type)].push_back(input);
+            all_hits.push_back(input);
+        }
+    }
+    const auto ray = [&camera_rays](std::uint64_t i) -> const Ray3& { return camera_rays[i & input_mask]; };
+    const Sphere3* center_sphere = nullptr;
+    for(const auto& object : scene.world.objects()) {
+        const auto* sphere = dynamic_cast<const Sphere3*>(object);
+        if(sphere && sphere->radius == 1.0f) {
+            center_sphere = sphere;
+            break;
+        }
+    }
+
+    std::vector<Vector3> operands(input_mask + 1);
+    for(auto& v : operands) {
+        v = Vector3::random(-1.0f, 1.0f);
+    }
+    const auto a = [&operands](std::uint64_t i) -> const Vector3& { return operands[i & input_mask]; };
+    const auto b = [&operands](std::uint64_t i) -> const Vector3& { return operands[(i + 511u) & input_mask]; };
+
+    std::cout << "Vector3: " << vector3_storage_name() << " storage, " << sizeof(Vector3) << " bytes. Scene: "
+              << scene.world.objects().size() << " objects.\n";
+    print_table_header(std::cout);
+    BenchmarkSuite suite{options, std::cout};
+
+    suite.run("rng/legacy_mt19937_random_float", [](std::uint64_t) { return legacy_random_float(); });
+    suite.run("rng/pcg32_random_float", [](std::uint64_t) { return random_float(); });
+    //One camera sample: reseed for the path, then pixel jitter and a lens sample.
+    suite.run("rng/legacy_per_sample", [](std::uint64_t) {
+        return legacy_random_float() + legacy_random_float() + legacy_random_float() + legacy_random_float();
+    });
+    suite.run("rng/pcg32_per_sample", [](std::uint64_t i) {
+        const auto key = make_path_key(0, i >> 7u, i & 127u);
+        seed_thread_rng(key, 0);
+        return random_float() + random_float() + random_float() + random_float();
+    });
+    //The same four numbers from each sampler, 128 samples per pixel.
+    const StratifiedSampler stratified{0, 128};
+    const SobolSampler sobol{0};
+    const BlueNoiseSampler blue_noise{0, 1024, 128};
+    for(const auto& [name, sampler] : {std::pair<const char*, const Sampler*>{"sampler/stratified_per_sample", &stratified}
+                                       ,{"sampler/sobol_per_sample", &sobol}
+                                       ,{"sampler/blue_noise_per_sample", &blue_noise}}) {
+        suite.run(name, [sampler](std::uint64_t i) {
+            const auto path = SamplePath{sampler, make_path_key(0, i >> 7u, i & 127u), i >> 7u, i & 127u};
+            seed_sample_path(path, 0);
+            return random_float() + random_float() + random_float() + random_float();
+        });
+    }
+    end_sample_path();
+
+    suite.run("sampling/random_in_unit_sphere", [](std::uint64_t) { return random_in_unit_sphere().x(); });
+    suite.run("sampling/random_unit_vector", [](std::uint64_t) { return random_unit_vector().y(); });
+    suite.run("sampling/random_in_unit_disk", [](std::uint64_t) { return random_in_unit_disk().x(); });
+
+    suite.run("camera/get_ray", [&camera](std::uint64_t i) {
+        const auto s = static_cast<float>(i & 255u) * (1.0f / 256.0f);
+        const auto t = static_cast<float>((i >> 8u) & 255u) * (1.0f / 256.0f);
+        return camera.get_ray(s, t).direction().x();
+    });
+
+    if(center_sphere) {
+        suite.run("sphere3/hit", [&](std::uint64_t i) {
+            hit_record rec{};
+            return center_sphere->hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+        });
+    }
+    if(center_sphere) {
+        //The center sphere as about as many triangles as a detailed model has.
+        const TriangleMesh sphere_mesh{tessellate_sphere(center_sphere->center, center_sphere->radius, 100), 0};
+        suite.run("triangle_mesh/hit", [&](std::uint64_t i) {
+            hit_record rec{};
+            return sphere_mesh.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+        });
+    }
+    suite.run("hittable_list/hit", [&](std::uint64_t i) {
+        hit_record rec{};
+        return scene.world.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+    });
+    suite.run("bvh/hit", [&](std::uint64_t i) {
+        hit_record rec{};
+        return bvh.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+    });
+    //What a sequence render pays per frame to update the cover scene's BVH
+    //after spheres moved: refitting the tree against building a new one.
+    {
+        auto refit_bvh = bvh;
+        suite.run("bvh/refit", [&](std::uint64_t) { return refit_bvh.refit(); });
+        suite.run("bvh/rebuild", [&](std::uint64_t) { return Bvh{bvh.spheres()}.nodes().size(); });
+    }
+
+    const auto run_scatter = [&](const std::string& name, const std::vector<ScatterInput>& inputs, auto&& scatter) {
+        if(inputs.empty()) {
+            return;
+        }
+        const auto count = inputs.size();
+        suite.run(name, [&inputs, &scatter, &scene, count](std::uint64_t i) {
+            const auto& input = inputs[i % count];
+            Ray3 scattered{};
+            return scatter(scene.materials[input.rec.material_id], input, scattered) ? scattered.direction().x() : 0.0f;
+        });
+    };
+    run_scatter("material/scatter_lambertian", hits_by_type[static_cast<std::size_t>(Material::Type::Lambertian)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return m.scatter_lambertian(in.ray, in.rec, out); });
+    run_scatter("material/scatter_metal", hits_by_type[static_cast<std::size_t>(Material::Type::Metal)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return m.scatter_metal(in.ray, in.rec, out); });
+    run_scatter("material/scatter_glass", hits_by_type[static_cast<std::size_t>(Material::Type::Glass)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return m.scatter_glass(in.ray, in.rec, out); });
+    //Hits in image order, so the type switch sees the scene's real mix of materials.
+    run_scatter("material/scatter", all_hits,
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return m.scatter(in.ray, in.rec, out); });
+
+    //The two ways of reaching primitives and materials: virtual Hittable calls
+    //and Material::scatter's switch, against a StaticSphereScene and the
+    //material kernels. Both BVHs are built the same way over the same spheres.
+    SphereBatch cover_spheres{};
+    make_sphere_batch(scene.world, cover_spheres);
+    const auto static_list = make_static_scene(cover_spheres, false);
+    const auto static_bvh = make_static_scene(cover_spheres, true);
+    const Bvh objects_bvh{scene.world, BvhLeafFormat::Objects};
+    suite.run("dispatch/hit_list/virtual", [&](std::uint64_t i) {
+        hit_record rec{};
+        return scene.world.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+    });
+    suite.run("dispatch/hit_list/static", [&](std::uint64_t i) {
+        hit_record rec{};
+        return static_list.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+    });
+    suite.run("dispatch/hit_bvh/virtual", [&](std::uint64_t i) {
+        hit_record rec{};
+        return objects_bvh.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+    });
+    suite.run("dispatch/hit_bvh/static", [&](std::uint64_t i) {
+        hit_record rec{};
+        return static_bvh.hit(ray(i), 0.001f, infinity, rec) ? rec.t : 0.0f;
+    });
+    run_scatter("dispatch/scatter/virtual", all_hits,
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return m.scatter(in.ray, in.rec, out); });
+    run_scatter("dispatch/scatter/static", all_hits, [](const Material& m, const ScatterInput& in, Ray3& out) {
+        return visit_material_type(m.type, [&](auto type) { return scatter_kernel<decltype(type)::value>(m, in.ray, in.rec, out); });
+    });
+    //The metal and glass kernels in each shading math.
+    run_scatter("shading/scatter_metal/reference", hits_by_type[static_cast<std::size_t>(Material::Type::Metal)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return scatter_kernel<Material::Type::Metal>(m, in.ray, in.rec, out); });
+    run_scatter("shading/scatter_metal/fast", hits_by_type[static_cast<std::size_t>(Material::Type::Metal)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return scatter_kernel<Material::Type::Metal, ShadingMath::Fast>(m, in.ray, in.rec, out); });
+    run_scatter("shading/scatter_glass/reference", hits_by_type[static_cast<std::size_t>(Material::Type::Glass)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return scatter_kernel<Material::Type::Glass>(m, in.ray, in.rec, out); });
+    run_scatter("shading/scatter_glass/fast", hits_by_type[static_cast<std::size_t>(Material::Type::Glass)],
+                [](const Material& m, const ScatterInput& in, Ray3& out) { return scatter_kernel<Material::Type::Glass, ShadingMath::Fast>(m, in.ray, in.rec, out); });
+    //Whole camera paths, hits and scatters together, as render_tile traces them.
+    const auto path_settings = RenderSettings{};
+    auto fast_path_settings = RenderSettings{};
+    fast_path_settings.shading_math = ShadingMath::Fast;
+    const auto run_path = [&](const std::string& name, const auto& world, const RenderSettings& settings) {
+        suite.run(name, [&](std::uint64_t i) {
+            const auto path = SamplePath{nullptr, make_path_key(0, i & input_mask, i >> 10u), i & input_mask, i >> 10u};
+            seed_sample_path(path, 0);
+            std::uint64_t rays = 0;
+            return ray_color(ray(i), world, scene.materials, settings.max_depth, settings, Color{1.0f, 1.0f, 1.0f}, path, rays).x();
+        });
+    };
+    run_path("dispatch/ray_color/virtual", static_cast<const Hittable&>(objects_bvh), path_settings);
+    run_path("dispatch/ray_color/static", static_bvh, path_settings);
+    run_path("shading/ray_color/reference", static_cast<const Hittable&>(objects_bvh), path_settings);
+    run_path("shading/ray_color/fast", static_cast<const Hittable&>(objects_bvh), fast_path_settings);
+
+    //Each fast shading function against the one it replaces; operands are in
+    //(-1, 1), so their lengths stay away from zero often enough to be typical.
+    suite.run("shading/schlick/reference", [&](std::uint64_t i) { return schlick_reflectance(std::abs(a(i).x()), 1.5f); });
+    suite.run("shading/schlick/fast", [&](std::uint64_t i) { return fast_schlick_reflectance(std::abs(a(i).x()), 1.5f); });
+    const auto incident = [&](std::uint64_t i) { return unit_vector(a(i)); };
+    const auto facing = [&](std::uint64_t i) {
+        const auto n = unit_vector(b(i));
+        return dot(incident(i), n) > 0.0f ? -n : n;
+    };
+    suite.run("shading/refract/reference", [&](std::uint64_t i) { return refract(incident(i), facing(i), 1.0f / 1.5f).x(); });
+    suite.run("shading/refract/fast", [&](std::uint64_t i) {
+        const auto uv = incident(i);
+        const auto n = facing(i);
+        return fast_refract(uv, n, 1.0f / 1.5f, (std::min)(dot(-uv, n), 1.0f)).x();
+    });
+
+    //One a-trous denoise of a 64x64 tile of the cover scene at 4 samples per
+    //pixel, on a single worker.
+    {
+        constexpr int size = 64;
+        const auto tile_camera = random_scene_camera(1.0f);
+        auto settings = RenderSettings{size, size, 4};
+        settings.report_progress = false;
+        const auto tiles = make_tiles(size, size, size);
+        ThreadPool pool{1};
+        Framebuffer noisy{size, size};
+        render(bvh, scene.materials, tile_camera, settings, pool, tiles, noisy);
+        const auto aovs = render_aovs(bvh, scene.materials, tile_camera, settings, pool, tiles, 4);
+        suite.run("denoise/atrous_64x64", [&](std::uint64_t) {
+            denoise(noisy, aovs, DenoiseSettings{}, pool);
+            return noisy.sum(0).x();
+        });
+    }
+
+    //Vector3 per-op cost: the out-of-line calls Vector3 used to make against the
+    //header-only operators.
+    suite.run("vector3/add/out_of_line", [&](std::uint64_t i) { return out_of_line::add(a(i), b(i)).x(); });
+    suite.run("vector3/add/inline", [&](std::uint64_t i) { return (a(i) + b(i)).x(); });
+    suite.run("vector3/sub/out_of_line", [&](std::uint64_t i) { return out_of_line::sub(a(i), b(i)).y(); });
+    suite.run("vector3/sub/inline", [&](std::uint64_t i) { return (a(i) - b(i)).y(); });
+    suite.run("vector3/mul/out_of_line", [&](std::uint64_t i) { return out_of_line::mul(a(i), b(i)).z(); });
+    suite.run("vector3/mul/inline", [&](std::uint64_t i) { return (a(i) * b(i)).z(); });
+    suite.run("vector3/scale/out_of_line", [&](std::uint64_t i) { return out_of_line::scale(0.5f, a(i)).x(); });
+    suite.run("vector3/scale/inline", [&](std::uint64_t i) { return (0.5f * a(i)).x(); });
+    suite.run("vector3/dot/out_of_line", [&](std::uint64_t i) { return out_of_line::dot(a(i), b(i)); });
+    suite.run("vector3/dot/inline", [&](std::uint64_t i) { return dot(a(i), b(i)); });
+    suite.run("vector3/cross/out_of_line", [&](std::uint64_t i) { return out_of_line::cross(a(i), b(i)).y(); });
+    suite.run("vector3/cross/inline", [&](std::uint64_t i) { return cross(a(i), b(i)).y(); });
+    suite.run("vector3/unit_vector/out_of_line", [&](std::uint64_t i) { return out_of_line::unit_vector(a(i)).z(); });
+    suite.run("vector3/unit_vector/inline", [&](std::uint64_t i) { return unit_vector(a(i)).z(); });
+    suite.run("vector3/reflect/out_of_line", [&](std::uint64_t i) { return out_of_line::reflect(a(i), b(i)).x(); });
+    suite.run("vector3/reflect/inline", [&](std::uint64_t i) { return reflect(a(i), b(i)).x(); });
+
+    if(options.time_to_quality) {
+        run_time_to_quality(scene, bvh, std::cout);
+    }
+    if(options.scene_storage_spheres > 0) {
+        run_scene_storage(options.scene_storage_spheres, std::cout);
+    }
+    if(options.fast_math_accuracy) {
+        run_fast_math_accuracy(scene, bvh, std::cout);
+    }
+    if(!options.mesh_path.empty()) {
+        try {
+            run_mesh(options.mesh_path, bvh, camera, std::cout);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
+        }
+    }
+
+    const std::vector<std::pair<std::string, std::string>> context{
+        {"vector3_storage", vector3_storage_name()}
+        ,{"vector3_bytes", std::to_string(sizeof(Vector3))}
+        ,{"scene_objects", std::to_string(scene.world.objects().size())}
+        ,{"repetitions", std::to_string(options.repetitions)}
+    };
+    int exit_code = 0;
+    if(!options.json_path.empty()) {
+        std::ofstream file{options.json_path};
+        write_json(file, suite.results(), context);
+        if(!file) {
+            std::cerr << "Could not write " << options.json_path << '\n';
+            exit_code = 1;
+        }
+    }
+    if(!options.csv_path.empty()) {
+        std::ofstream file{options.csv_path};
+        write_csv(file, suite.results());
+        if(!file) {
+            std::cerr << "Could not write " << options.csv_path << '\n';
+            exit_code = 1;
+        }
+    }
+    return exit_code;
+}
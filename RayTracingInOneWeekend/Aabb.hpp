@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Ray3.hpp"
+#include "Vector3.hpp"
+
+#include <algorithm>
+
+class Aabb {
+public:
+    Aabb() = default;
+    Aabb(const Aabb& other) = default;
+    Aabb(Aabb&& other) = default;
+    Aabb& operator=(const Aabb& other) = default;
+    Aabb& operator=(Aabb&& other) = default;
+    ~Aabb() = default;
+
+    Aabb(const Point3& a, const Point3& b) : minimum{a}, maximum{b} {}
+
+    //An inverted box: expanding it by anything yields that thing.
+    static Aabb empty() {
+        return Aabb{Point3{infinity, infinity, infinity}, Point3{-infinity, -infinity, -infinity}};
+    }
+
+    void expand(const Aabb& other) {
+        minimum = Point3{(std::min)(minimum.x(), other.minimum.x()), (std::min)(minimum.y(), other.minimum.y()), (std::min)(minimum.z(), other.minimum.z())};
+        maximum = Point3{(std::max)(maximum.x(), other.maximum.x()), (std::max)(maximum.y(), other.maximum.y()), (std::max)(maximum.z(), other.maximum.z())};
+    }
+
+    void expand(const Point3& p) {
+        expand(Aabb{p, p});
+    }
+
+    Point3 centroid() const {
+        return 0.5f * (minimum + maximum);
+    }
+
+    float surface_area() const {
+        const auto d = maximum - minimum;
+        if(d.x() < 0.0f || d.y() < 0.0f || d.z() < 0.0f) {
+            return 0.0f;
+        }
+        return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+    }
+
+    int longest_axis() const {
+        const auto d = maximum - minimum;
+        if(d.x() > d.y() && d.x() > d.z()) return 0;
+        return d.y() > d.z() ? 1 : 2;
+    }
+
+    //Slab test against a precomputed reciprocal ray direction.
+    bool hit(const Point3& origin, const Vector3& inv_direction, float t_min, float t_max) const {
+        for(int axis = 0; axis < 3; ++axis) {
+            auto t0 = (minimum[axis] - origin[axis]) * inv_direction[axis];
+            auto t1 = (maximum[axis] - origin[axis]) * inv_direction[axis];
+            if(inv_direction[axis] < 0.0f) {
+                std::swap(t0, t1);
+            }
+            t_min = t0 > t_min ? t0 : t_min;
+            t_max = t1 < t_max ? t1 : t_max;
+            if(t_max < t_min) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool hit(const Ray3& r, float t_min, float t_max) const {
+        const auto d = r.direction();
+        return hit(r.origin(), Vector3{1.0f / d.x(), 1.0f / d.y(), 1.0f / d.z()}, t_min, t_max);
+    }
+
+    Point3 minimum{};
+    Point3 maximum{};
+protected:
+private:
+};
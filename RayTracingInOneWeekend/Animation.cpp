@@ -0,0 +1,149 @@
+#include "Animation.hpp"
+
+#include "MathUtils.hpp"
+#include "Random.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+    //Uniform Catmull-Rom between p1 (u = 0) and p2 (u = 1).
+    Point3 catmull_rom(const Point3& p0, const Point3& p1, const Point3& p2, const Point3& p3, float u) {
+        const auto u2 = u * u;
+        const auto u3 = u2 * u;
+        return 0.5f * (2.0f * p1
+                       + u * (p2 - p0)
+                       + u2 * (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3)
+                       + u3 * (3.0f * p1 - p0 - 3.0f * p2 + p3));
+    }
+
+}
+
+CameraDesc camera_at(const std::vector<CameraKey>& keys, const CameraDesc& desc, float time) {
+    auto camera = desc;
+    if(keys.empty()) {
+        return camera;
+    }
+    const auto set = [&camera](const CameraKey& key) {
+        camera.look_from = key.look_from;
+        camera.look_at = key.look_at;
+        return camera;
+    };
+    if(time <= keys.front().time) {
+        return set(keys.front());
+    }
+    if(time >= keys.back().time) {
+        return set(keys.back());
+    }
+    //The segment from keys[i] to keys[i + 1] holds time; the keys either side shape its tangents.
+    std::size_t i = 0;
+    while(keys[i + 1].time < time) {
+        ++i;
+    }
+    const auto& k0 = keys[i > 0 ? i - 1 : i];
+    const auto& k1 = keys[i];
+    const auto& k2 = keys[i + 1];
+    const auto& k3 = keys[(std::min)(i + 2, keys.size() - 1)];
+    const auto span = k2.time - k1.time;
+    const auto u = span > 0.0f ? (time - k1.time) / span : 1.0f;
+    camera.look_from = catmull_rom(k0.look_from, k1.look_from, k2.look_from, k3.look_from, u);
+    camera.look_at = catmull_rom(k0.look_at, k1.look_at, k2.look_at, k3.look_at, u);
+    return camera;
+}
+
+std::vector<CameraKey> orbit_camera_keys(const CameraDesc& desc, float degrees) {
+    //Enough keys that the spline stays close to the circle.
+    constexpr int key_count = 9;
+    const auto arm = desc.look_from - desc.look_at;
+    std::vector<CameraKey> keys{};
+    keys.reserve(key_count);
+    for(int i = 0; i < key_count; ++i) {
+        const auto time = static_cast<float>(i) / (key_count - 1);
+        const auto angle = degrees_to_radians(degrees * (time - 0.5f));
+        const auto c = std::cos(angle);
+        const auto s = std::sin(angle);
+        const auto rotated = Vector3{c * arm.x() + s * arm.z(), arm.y(), c * arm.z() - s * arm.x()};
+        keys.emplace_back(CameraKey{time, desc.look_at + rotated, desc.look_at});
+    }
+    return keys;
+}
+
+std::vector<SphereMotion> cover_scene_motions(const SphereBatch& spheres) {
+    std::vector<SphereMotion> motions{};
+    for(std::size_t i = 0; i < spheres.size(); ++i) {
+        if(spheres.radius(i) == 0.2f) {
+            //A height from the sphere's index, so the scene's random numbers are left alone.
+            const auto height = 0.5f * static_cast<float>(mix_bits(i) >> 40u) / static_cast<float>(1u << 24u);
+            motions.emplace_back(SphereMotion{static_cast<std::uint32_t>(i), Vector3{0.0f, height, 0.0f}});
+        }
+    }
+    return motions;
+}
+
+AnimatedSpheres::AnimatedSpheres(const SphereBatch& spheres, std::vector<SphereMotion> motions, bool use_bvh)
+: m_motions{std::move(motions)} {
+    m_rest.reserve(spheres.size());
+    for(std::size_t i = 0; i < spheres.size(); ++i) {
+        m_rest.add(spheres.center(i), spheres.radius(i), spheres.material_id(i));
+    }
+    for(const auto& motion : m_motions) {
+        if(motion.sphere >= m_rest.size()) {
+            throw std::invalid_argument("A motion moves sphere " + std::to_string(motion.sphere) + " of " + std::to_string(m_rest.size()));
+        }
+    }
+    m_moved = m_rest;
+    if(use_bvh) {
+        m_bvh = std::make_unique<Bvh>(m_rest);
+        index_leaves();
+    }
+}
+
+double AnimatedSpheres::update(float time, BvhUpdate bvh_update) {
+    const auto start = std::chrono::steady_clock::now();
+    for(const auto& motion : m_motions) {
+        m_moved.set_center(motion.sphere, m_rest.center(motion.sphere) + time * motion.offset);
+    }
+    if(m_bvh && bvh_update == BvhUpdate::Rebuild) {
+        *m_bvh = Bvh{m_moved};
+        index_leaves();
+    } else if(m_bvh) {
+        //Only the spheres that move change; refit still visits every node.
+        for(const auto& motion : m_motions) {
+            m_bvh->set_sphere_center(m_leaf_index[motion.sphere], m_moved.center(motion.sphere));
+        }
+        m_bvh->refit();
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const Hittable& AnimatedSpheres::world() const noexcept {
+    if(m_bvh) {
+        return *m_bvh;
+    }
+    return m_moved;
+}
+
+const Bvh* AnimatedSpheres::bvh() const noexcept {
+    return m_bvh.get();
+}
+
+void AnimatedSpheres::index_leaves() {
+    const auto order = m_bvh->primitive_order();
+    m_leaf_index.resize(order.size());
+    for(std::size_t leaf = 0; leaf < order.size(); ++leaf) {
+        m_leaf_index[order[leaf]] = static_cast<std::uint32_t>(leaf);
+    }
+}
+
+std::ostream& operator<<(std::ostream& out, BvhUpdate bvh_update) {
+    switch(bvh_update) {
+    case BvhUpdate::Refit: return out << "refit";
+    case BvhUpdate::Rebuild: return out << "rebuild";
+    default: return out << "unknown";
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Bvh.hpp"
+#include "Camera.hpp"
+#include "Hittable.hpp"
+#include "SphereBatch.hpp"
+#include "Vector3.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+//Where the camera stands and looks at one time. Times run from 0 at the
+//first frame of a sequence to 1 at the last.
+struct CameraKey {
+    float time{0.0f};
+    Point3 look_from{};
+    Point3 look_at{};
+};
+
+//A sphere moving in a straight line: at time t its center is t * offset away
+//from where the scene puts it.
+struct SphereMotion {
+    //Index among the scene's spheres, those in world first, then those in spheres.
+    std::uint32_t sphere{0};
+    Vector3 offset{};
+};
+
+//How a BVH follows spheres that moved.
+enum class BvhUpdate {
+    Refit    //Keep the tree and recompute its bounds, see Bvh::refit.
+    ,Rebuild //Build a new tree.
+};
+
+//desc with look_from and look_at at `time` on a Catmull-Rom spline through
+//the keys, held at the first and last key outside them. The keys must be
+//sorted by time; with none, desc is returned as it is.
+CameraDesc camera_at(const std::vector<CameraKey>& keys, const CameraDesc& desc, float time);
+
+//Keys that swing the camera `degrees` around the vertical axis through
+//look_at, centered on where desc stands.
+std::vector<CameraKey> orbit_camera_keys(const CameraDesc& desc, float degrees);
+
+//The cover scene's small spheres bouncing up to half a unit, each its own
+//height, as in the moving spheres of the book's sequel.
+std::vector<SphereMotion> cover_scene_motions(const SphereBatch& spheres);
+
+//Spheres that move over a sequence, and optionally a SphereBatch-leaf BVH
+//over them. Both are built once and then updated in place each frame.
+class AnimatedSpheres {
+public:
+    AnimatedSpheres() = delete;
+    AnimatedSpheres(const AnimatedSpheres& other) = delete;
+    AnimatedSpheres(AnimatedSpheres&& other) = delete;
+    AnimatedSpheres& operator=(const AnimatedSpheres& other) = delete;
+    AnimatedSpheres& operator=(AnimatedSpheres&& other) = delete;
+    ~AnimatedSpheres() = default;
+
+    //Copies the spheres, which may be a view. Throws std::invalid_argument if
+    //a motion names a sphere that is not there.
+    AnimatedSpheres(const SphereBatch& spheres, std::vector<SphereMotion> motions, bool use_bvh);
+
+    //Moves the spheres to where they are at `time`, then refits or rebuilds
+    //the BVH. Returns the milliseconds it took.
+    double update(float time, BvhUpdate bvh_update);
+
+    //What rays are traced against: the BVH, or the spheres if there is none.
+    const Hittable& world() const noexcept;
+    const Bvh* bvh() const noexcept;
+
+protected:
+private:
+    void index_leaves();
+
+    SphereBatch m_rest{};
+    SphereBatch m_moved{};
+    std::vector<SphereMotion> m_motions{};
+    std::unique_ptr<Bvh> m_bvh{};
+    //Where each sphere of m_rest sits among m_bvh's spheres.
+    std::vector<std::uint32_t> m_leaf_index{};
+};
+
+std::ostream& operator<<(std::ostream& out, BvhUpdate bvh_update);
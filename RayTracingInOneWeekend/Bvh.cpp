@@ -0,0 +1,434 @@
+#include "Bvh.hpp"
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+    constexpr int bin_count = 16;
+    constexpr float traversal_cost = 1.0f;
+    constexpr float intersection_cost = 1.0f;
+
+    struct BuildPrimitive {
+        Aabb bounds{};
+        Point3 centroid{};
+        std::uint32_t index{0};
+    };
+
+    struct Bin {
+        Aabb bounds{Aabb::empty()};
+        std::size_t count{0};
+    };
+
+    class BvhBuilder {
+    public:
+        BvhBuilder(std::vector<BuildPrimitive>& primitives, int max_leaf_size, int primitives_per_test, std::vector<BvhNode>& nodes, BvhBuildStats& stats)
+        : _primitives{primitives}
+        , _max_leaf_size{static_cast<std::size_t>((std::clamp)(max_leaf_size, 1, 0xFFFF))}
+        , _primitives_per_test{static_cast<std::size_t>((std::max)(primitives_per_test, 1))}
+        , _nodes{nodes}
+        , _stats{stats} {
+            /* DO NOTHING */
+        }
+
+        void build(std::size_t begin, std::size_t end, std::size_t depth) {
+            const auto node_index = _nodes.size();
+            _nodes.emplace_back();
+            _stats.max_depth = (std::max)(_stats.max_depth, depth);
+
+            auto bounds = Aabb::empty();
+            auto centroid_bounds = Aabb::empty();
+            for(auto i = begin; i < end; ++i) {
+                bounds.expand(_primitives[i].bounds);
+                centroid_bounds.expand(_primitives[i].centroid);
+            }
+            _nodes[node_index].bounds = bounds;
+
+            //A node at the depth limit is a leaf, so traversal never needs more
+            //than bvh_max_depth stack entries. From half that depth on, nodes
+            //too big for a leaf are cut at the median instead of where the SAH
+            //likes: each of the remaining levels then halves them, which
+            //leaves any uint32_t count of primitives small enough for a leaf.
+            const auto count = end - begin;
+            if(count == 1 || depth + 1 >= bvh_max_depth) {
+                make_leaf(node_index, begin, end);
+                return;
+            }
+            const auto must_split = count > _max_leaf_size;
+            if(must_split && depth >= bvh_max_depth / 2) {
+                const auto axis = centroid_bounds.longest_axis();
+                const auto first = _primitives.begin() + static_cast<std::ptrdiff_t>(begin);
+                const auto middle = begin + count / 2;
+                std::nth_element(first, _primitives.begin() + static_cast<std::ptrdiff_t>(middle), _primitives.begin() + static_cast<std::ptrdiff_t>(end),
+                                 [axis](const BuildPrimitive& a, const BuildPrimitive& b) { return a.centroid[axis] < b.centroid[axis]; });
+                _nodes[node_index].axis = static_cast<std::uint16_t>(axis);
+                build(begin, middle, depth + 1);
+                _nodes[node_index].offset = static_cast<std::uint32_t>(_nodes.size());
+                build(middle, end, depth + 1);
+                return;
+            }
+            const auto leaf_cost = intersection_cost * test_count(count);
+            const auto split = find_split(begin, end, bounds, centroid_bounds);
+            if(!must_split && (split.axis < 0 || split.cost >= leaf_cost)) {
+                make_leaf(node_index, begin, end);
+                return;
+            }
+
+            auto middle = begin + count / 2;
+            if(split.axis >= 0) {
+                const auto axis = split.axis;
+                const auto low = centroid_bounds.minimum[axis];
+                const auto scale = bin_count / (centroid_bounds.maximum[axis] - low);
+                const auto first = _primitives.begin() + static_cast<std::ptrdiff_t>(begin);
+                const auto last = _primitives.begin() + static_cast<std::ptrdiff_t>(end);
+                middle = static_cast<std::size_t>(std::partition(first, last, [=](const BuildPrimitive& p) {
+                    return bin_of(p.centroid[axis], low, scale) < split.bin;
+                }) - _primitives.begin());
+            }
+            if(middle == begin || middle == end) {
+                //Every centroid coincides; any even split is as good as another.
+                middle = begin + count / 2;
+            }
+
+            _nodes[node_index].axis = static_cast<std::uint16_t>(split.axis >= 0 ? split.axis : centroid_bounds.longest_axis());
+            build(begin, middle, depth + 1);
+            _nodes[node_index].offset = static_cast<std::uint32_t>(_nodes.size());
+            build(middle, end, depth + 1);
+        }
+
+    private:
+        struct Split {
+            int axis{-1};
+            int bin{0};
+            float cost{infinity};
+        };
+
+        float test_count(std::size_t primitive_count) const {
+            return static_cast<float>((primitive_count + _primitives_per_test - 1) / _primitives_per_test);
+        }
+
+        static int bin_of(float centroid, float low, float scale) {
+            return (std::min)(bin_count - 1, static_cast<int>((centroid - low) * scale));
+        }
+
+        Split find_split(std::size_t begin, std::size_t end, const Aabb& bounds, const Aabb& centroid_bounds) const {
+            Split best{};
+            const auto parent_area = bounds.surface_area();
+            if(parent_area <= 0.0f) {
+                return best;
+            }
+            for(int axis = 0; axis < 3; ++axis) {
+                const auto low = centroid_bounds.minimum[axis];
+                const auto extent = centroid_bounds.maximum[axis] - low;
+                if(extent <= 0.0f) {
+                    continue;
+                }
+                const auto scale = bin_count / extent;
+                std::array<Bin, bin_count> bins{};
+                for(auto i = begin; i < end; ++i) {
+                    auto& bin = bins[static_cast<std::size_t>(bin_of(_primitives[i].centroid[axis], low, scale))];
+                    bin.bounds.expand(_primitives[i].bounds);
+                    ++bin.count;
+                }
+
+                //Sweep from the right to get the cost of everything above each plane.
+                std::array<float, bin_count> right_costs{};
+                auto right_bounds = Aabb::empty();
+                std::size_t right_count = 0;
+                for(int i = bin_count - 1; i > 0; --i) {
+                    right_bounds.expand(bins[static_cast<std::size_t>(i)].bounds);
+                    right_count += bins[static_cast<std::size_t>(i)].count;
+                    right_costs[static_cast<std::size_t>(i)] = right_bounds.surface_area() * test_count(right_count);
+                }
+
+                auto left_bounds = Aabb::empty();
+                std::size_t left_count = 0;
+                for(int i = 1; i < bin_count; ++i) {
+                    left_bounds.expand(bins[static_cast<std::size_t>(i - 1)].bounds);
+                    left_count += bins[static_cast<std::size_t>(i - 1)].count;
+                    if(left_count == 0 || left_count == end - begin) {
+                        continue;
+                    }
+                    const auto cost = traversal_cost + intersection_cost * (left_bounds.surface_area() * test_count(left_count) + right_costs[static_cast<std::size_t>(i)]) / parent_area;
+                    if(cost < best.cost) {
+                        best = Split{axis, i, cost};
+                    }
+                }
+            }
+            return best;
+        }
+
+        void make_leaf(std::size_t node_index, std::size_t begin, std::size_t end) {
+            //build's median splits keep leaves far below this.
+            if(end - begin > 0xFFFF) {
+                throw std::runtime_error("A BVH leaf of " + std::to_string(end - begin) + " primitives does not fit in a node");
+            }
+            auto& node = _nodes[node_index];
+            node.offset = static_cast<std::uint32_t>(begin);
+            node.count = static_cast<std::uint16_t>(end - begin);
+            ++_stats.leaf_count;
+            _stats.max_leaf_size = (std::max)(_stats.max_leaf_size, end - begin);
+        }
+
+        std::vector<BuildPrimitive>& _primitives;
+        std::size_t _max_leaf_size{4};
+        std::size_t _primitives_per_test{1};
+        std::vector<BvhNode>& _nodes;
+        BvhBuildStats& _stats;
+    };
+
+}
+
+std::ostream& operator<<(std::ostream& out, const BvhBuildStats& stats) {
+    return out << "BVH: " << stats.primitive_count << " primitives, "
+        << stats.node_count << " nodes, "
+        << stats.leaf_count << " leaves, depth " << stats.max_depth
+        << ", largest leaf " << stats.max_leaf_size
+        << ", built in " << stats.build_milliseconds << " ms";
+}
+
+std::ostream& operator<<(std::ostream& out, const BvhTraversalStats& stats) {
+    const auto rays = static_cast<double>(stats.rays ? stats.rays : 1);
+    return out << "BVH traversal: " << stats.rays << " rays, "
+        << static_cast<double>(stats.nodes_visited) / rays << " nodes/ray, "
+        << static_cast<double>(stats.primitive_tests) / rays << " primitive tests/ray";
+}
+
+BvhBuildStats build_bvh_nodes(const std::vector<Aabb>& primitive_bounds, int max_leaf_size, std::vector<BvhNode>& nodes, std::vector<std::uint32_t>& primitive_order, int primitives_per_test) {
+    const auto start = std::chrono::steady_clock::now();
+    BvhBuildStats stats{};
+    stats.primitive_count = primitive_bounds.size();
+
+    std::vector<BuildPrimitive> primitives{};
+    primitives.reserve(primitive_bounds.size());
+    for(std::size_t i = 0; i < primitive_bounds.size(); ++i) {
+        primitives.emplace_back(BuildPrimitive{primitive_bounds[i], primitive_bounds[i].centroid(), static_cast<std::uint32_t>(i)});
+    }
+
+    nodes.clear();
+    if(!primitives.empty()) {
+        nodes.reserve(2 * primitives.size());
+        BvhBuilder builder{primitives, max_leaf_size, primitives_per_test, nodes, stats};
+        builder.build(0, primitives.size(), 0);
+    }
+    nodes.shrink_to_fit();
+
+    primitive_order.clear();
+    primitive_order.reserve(primitives.size());
+    for(const auto& p : primitives) {
+        primitive_order.emplace_back(p.index);
+    }
+
+    stats.node_count = nodes.size();
+    stats.build_milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+Bvh::Bvh(const Bvh& other)
+: m_nodes{other.m_nodes}
+, m_node_view{other.m_node_view}
+, m_primitives{other.m_primitives}
+, m_spheres{other.m_spheres}
+, m_primitive_order{other.m_primitive_order}
+, m_leaf_format{other.m_leaf_format}
+, m_build_stats{other.m_build_stats} {
+    if(other.m_node_view.data() == other.m_nodes.data()) {
+        m_node_view = m_nodes;
+    }
+}
+
+//Moving a vector keeps its buffer, so the view stays valid in the new Bvh.
+Bvh::Bvh(Bvh&& other) noexcept
+: m_nodes{std::move(other.m_nodes)}
+, m_node_view{other.m_node_view}
+, m_primitives{std::move(other.m_primitives)}
+, m_spheres{std::move(other.m_spheres)}
+, m_primitive_order{std::move(other.m_primitive_order)}
+, m_leaf_format{other.m_leaf_format}
+, m_build_stats{other.m_build_stats} {
+    other.m_node_view = {};
+}
+
+Bvh& Bvh::operator=(const Bvh& other) {
+    if(this != &other) {
+        *this = Bvh{other};
+    }
+    return *this;
+}
+
+Bvh& Bvh::operator=(Bvh&& other) noexcept {
+    if(this != &other) {
+        m_nodes = std::move(other.m_nodes);
+        m_node_view = other.m_node_view;
+        m_primitives = std::move(other.m_primitives);
+        m_spheres = std::move(other.m_spheres);
+        m_primitive_order = std::move(other.m_primitive_order);
+        m_leaf_format = other.m_leaf_format;
+        m_build_stats = other.m_build_stats;
+        other.m_node_view = {};
+    }
+    return *this;
+}
+
+Bvh::Bvh(const HittableList& list, BvhLeafFormat leaf_format, int max_leaf_size) {
+    SphereBatch spheres{};
+    if(leaf_format == BvhLeafFormat::SphereBatch && make_sphere_batch(list, spheres)) {
+        *this = Bvh{spheres, max_leaf_size};
+        return;
+    }
+
+    const auto& objects = list.objects();
+    std::vector<Aabb> bounds{};
+    bounds.reserve(objects.size());
+    for(const auto& object : objects) {
+        Aabb box{};
+        if(!object->bounding_box(box)) {
+            //Unbounded objects can't be culled; give them a box that every ray enters.
+            box = Aabb{Point3{-infinity, -infinity, -infinity}, Point3{infinity, infinity, infinity}};
+        }
+        bounds.emplace_back(box);
+    }
+
+    m_build_stats = build_bvh_nodes(bounds, max_leaf_size, m_nodes, m_primitive_order);
+    m_node_view = m_nodes;
+    m_primitives.reserve(m_primitive_order.size());
+    for(const auto index : m_primitive_order) {
+        m_primitives.emplace_back(objects[index]);
+    }
+}
+
+Bvh::Bvh(const SphereBatch& spheres, int max_leaf_size)
+: m_leaf_format{BvhLeafFormat::SphereBatch} {
+    std::vector<Aabb> bounds{};
+    bounds.reserve(spheres.size());
+    for(std::size_t i = 0; i < spheres.size(); ++i) {
+        bounds.emplace_back(spheres.sphere_bounds(i));
+    }
+    const auto lanes = static_cast<int>(SphereBatch::lane_count);
+    m_build_stats = build_bvh_nodes(bounds, (std::max)(lanes, max_leaf_size), m_nodes, m_primitive_order, lanes);
+    m_node_view = m_nodes;
+    m_spheres.reserve(m_primitive_order.size());
+    for(const auto index : m_primitive_order) {
+        m_spheres.add(spheres.center(index), spheres.radius(index), spheres.material_id(index));
+    }
+}
+
+Bvh::Bvh(std::span<const BvhNode> nodes, SphereBatch spheres, const BvhBuildStats& stats)
+: m_node_view{nodes}
+, m_spheres{std::move(spheres)}
+, m_leaf_format{BvhLeafFormat::SphereBatch}
+, m_build_stats{stats} {
+    /* DO NOTHING */
+}
+
+Bvh::Bvh(std::vector<BvhNode> nodes, SphereBatch spheres, const BvhBuildStats& stats)
+: m_nodes{std::move(nodes)}
+, m_spheres{std::move(spheres)}
+, m_leaf_format{BvhLeafFormat::SphereBatch}
+, m_build_stats{stats} {
+    m_node_view = m_nodes;
+}
+
+bool Bvh::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+    return traverse<false>(r, t_min, t_max, rec, nullptr);
+}
+
+bool Bvh::hit(const Ray3& r, float t_min, float t_max, hit_record& rec, BvhTraversalStats& stats) const {
+    ++stats.rays;
+    return traverse<true>(r, t_min, t_max, rec, &stats);
+}
+
+bool Bvh::bounding_box(Aabb& output_box) const {
+    if(m_node_view.empty()) {
+        return false;
+    }
+    output_box = m_node_view.front().bounds;
+    return true;
+}
+
+void Bvh::set_sphere_center(std::size_t index, const Point3& center) {
+    m_spheres.set_center(index, center);
+}
+
+double Bvh::refit() {
+    const auto start = std::chrono::steady_clock::now();
+    if(m_node_view.data() != m_nodes.data()) {
+        m_nodes.assign(m_node_view.begin(), m_node_view.end());
+        m_node_view = m_nodes;
+    }
+    //Both children come after their parent, so walking backwards reaches them first.
+    for(auto i = m_nodes.size(); i-- > 0;) {
+        auto& node = m_nodes[i];
+        if(node.count == 0) {
+            node.bounds = m_nodes[i + 1].bounds;
+            node.bounds.expand(m_nodes[node.offset].bounds);
+            continue;
+        }
+        node.bounds = Aabb::empty();
+        for(auto p = node.offset; p < node.offset + node.count; ++p) {
+            Aabb box{};
+            if(m_leaf_format == BvhLeafFormat::SphereBatch) {
+                box = m_spheres.sphere_bounds(p);
+            } else if(!m_primitives[p]->bounding_box(box)) {
+                box = Aabb{Point3{-infinity, -infinity, -infinity}, Point3{infinity, infinity, infinity}};
+            }
+            node.bounds.expand(box);
+        }
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+const BvhBuildStats& Bvh::build_stats() const noexcept {
+    return m_build_stats;
+}
+
+std::span<const BvhNode> Bvh::nodes() const noexcept {
+    return m_node_view;
+}
+
+BvhLeafFormat Bvh::leaf_format() const noexcept {
+    return m_leaf_format;
+}
+
+const SphereBatch& Bvh::spheres() const noexcept {
+    return m_spheres;
+}
+
+std::span<const std::uint32_t> Bvh::primitive_order() const noexcept {
+    return m_primitive_order;
+}
+
+template<bool CollectStats>
+bool Bvh::traverse(const Ray3& r, float t_min, float t_max, hit_record& rec, [[maybe_unused]] BvhTraversalStats* stats) const {
+    hit_record temp_rec{};
+    const auto test_leaf = [&](std::uint32_t first, std::uint32_t count, float& closest) {
+        if constexpr(CollectStats) {
+            stats->primitive_tests += count;
+        }
+        bool hit_anything = false;
+        if(m_leaf_format == BvhLeafFormat::SphereBatch) {
+            if(m_spheres.hit_range(r, first, count, t_min, closest, temp_rec)) {
+                hit_anything = true;
+                closest = temp_rec.t;
+                rec = temp_rec;
+            }
+        } else {
+            for(auto i = first; i < first + count; ++i) {
+                if(m_primitives[i]->hit(r, t_min, closest, temp_rec)) {
+                    hit_anything = true;
+                    closest = temp_rec.t;
+                    rec = temp_rec;
+                }
+            }
+        }
+        return hit_anything;
+    };
+    if constexpr(CollectStats) {
+        return traverse_bvh<true>(m_node_view, r, t_min, t_max, test_leaf, &stats->nodes_visited);
+    } else {
+        return traverse_bvh(m_node_view, r, t_min, t_max, test_leaf);
+    }
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "Hittable.hpp"
+#include "HittableList.hpp"
+#include "Ray3.hpp"
+#include "SphereBatch.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <vector>
+
+//One node of a flattened BVH, laid out depth-first: an interior node's first
+//child immediately follows it and its second child lives at `offset`.
+struct BvhNode {
+    Aabb bounds{};
+    std::uint32_t offset{0}; //Leaf: index of the first primitive. Interior: index of the second child.
+    std::uint16_t count{0};  //Number of primitives in a leaf, 0 for interior nodes.
+    std::uint16_t axis{0};   //Split axis of an interior node.
+};
+#if !defined(RTIOW_VECTOR3_SIMD)
+static_assert(sizeof(BvhNode) == 32, "BvhNode should stay at two nodes per cache line.");
+#endif
+
+struct BvhBuildStats {
+    std::size_t primitive_count{0};
+    std::size_t node_count{0};
+    std::size_t leaf_count{0};
+    std::size_t max_depth{0};
+    std::size_t max_leaf_size{0};
+    double build_milliseconds{0.0};
+};
+
+struct BvhTraversalStats {
+    std::uint64_t rays{0};
+    std::uint64_t nodes_visited{0};
+    std::uint64_t primitive_tests{0};
+};
+
+std::ostream& operator<<(std::ostream& out, const BvhBuildStats& stats);
+std::ostream& operator<<(std::ostream& out, const BvhTraversalStats& stats);
+
+//Depth limit of build_bvh_nodes, and so the size of a traversal stack.
+constexpr std::size_t bvh_max_depth = 64;
+
+//Builds a flattened BVH over the given primitive bounds using binned SAH.
+//primitive_order receives the primitive indices in leaf order.
+//primitives_per_test is how many primitives a leaf tests at once; the SAH
+//charges a leaf per group of that many rather than per primitive.
+BvhBuildStats build_bvh_nodes(const std::vector<Aabb>& primitive_bounds, int max_leaf_size, std::vector<BvhNode>& nodes, std::vector<std::uint32_t>& primitive_order, int primitives_per_test = 1);
+
+enum class BvhLeafFormat {
+    Objects     //Leaves point at the list's Hittables.
+    ,SphereBatch //Leaves are runs of up to SphereBatch::lane_count spheres tested in one SIMD pass.
+};
+
+class Bvh : public Hittable {
+public:
+    Bvh() = delete;
+    Bvh(const Bvh& other);
+    Bvh(Bvh&& other) noexcept;
+    Bvh& operator=(const Bvh& other);
+    Bvh& operator=(Bvh&& other) noexcept;
+    virtual ~Bvh() = default;
+
+    //SphereBatch leaves are used only if every object in the list is a Sphere3.
+    //Objects leaves point at the list's objects, which must outlive the Bvh.
+    explicit Bvh(const HittableList& list, BvhLeafFormat leaf_format = BvhLeafFormat::Objects, int max_leaf_size = 4);
+
+    //SphereBatch leaves over a copy of the spheres, reordered to match the leaves.
+    explicit Bvh(const SphereBatch& spheres, int max_leaf_size = 4);
+
+    //A SphereBatch-leaf BVH built earlier, e.g. stored in a compiled scene:
+    //nodes() and spheres() of the original. The first form uses the nodes in
+    //place, so they must outlive the Bvh; the second takes ownership.
+    Bvh(std::span<const BvhNode> nodes, SphereBatch spheres, const BvhBuildStats& stats);
+    Bvh(std::vector<BvhNode> nodes, SphereBatch spheres, const BvhBuildStats& stats);
+
+    bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override;
+    bool bounding_box(Aabb& output_box) const override;
+
+    //Same as hit, but also counts the work the traversal did.
+    bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec, BvhTraversalStats& stats) const;
+
+    //SphereBatch leaves: moves sphere `index` of spheres(). Call refit once
+    //every sphere that moves has. Not for BVHs over a view of the spheres.
+    void set_sphere_center(std::size_t index, const Point3& center);
+
+    //Recomputes every node's bounds from the current bounds of its primitives,
+    //keeping the tree. That is far cheaper than building again, but the tree
+    //fits the primitives less well the further they move from where it was
+    //built. Returns the milliseconds it took.
+    double refit();
+
+    const BvhBuildStats& build_stats() const noexcept;
+    std::span<const BvhNode> nodes() const noexcept;
+    BvhLeafFormat leaf_format() const noexcept;
+    //The spheres in leaf order; empty unless leaf_format() is SphereBatch.
+    const SphereBatch& spheres() const noexcept;
+    //For each primitive in leaf order, its index in the list or batch the Bvh
+    //was built from; empty for BVHs built earlier.
+    std::span<const std::uint32_t> primitive_order() const noexcept;
+
+protected:
+private:
+    template<bool CollectStats>
+    bool traverse(const Ray3& r, float t_min, float t_max, hit_record& rec, BvhTraversalStats* stats) const;
+
+    std::vector<BvhNode> m_nodes{};
+    //What traversal reads: m_nodes, or nodes owned by someone else.
+    std::span<const BvhNode> m_node_view{};
+    //Objects leaves: the list's objects in leaf order, owned by whoever owns the list's.
+    std::vector<const Hittable*> m_primitives{};
+    SphereBatch m_spheres{};
+    std::vector<std::uint32_t> m_primitive_order{};
+    BvhLeafFormat m_leaf_format{BvhLeafFormat::Objects};
+    BvhBuildStats m_build_stats{};
+};
+
+//Walks a flattened BVH, near child first. test_leaf(first, count, closest)
+//tests primitives [first, first + count) of a leaf, lowers closest (a float&)
+//to any nearer hit and returns whether it found one. With CountNodes, every
+//node visited is counted into *nodes_visited.
+template<bool CountNodes = false, typename LeafTest>
+bool traverse_bvh(std::span<const BvhNode> nodes, const Ray3& r, float t_min, float t_max, LeafTest&& test_leaf, [[maybe_unused]] std::uint64_t* nodes_visited = nullptr) {
+    if(nodes.empty()) {
+        return false;
+    }
+    const auto origin = r.origin();
+    const auto direction = r.direction();
+    const auto inv_direction = Vector3{1.0f / direction.x(), 1.0f / direction.y(), 1.0f / direction.z()};
+
+    std::array<std::uint32_t, bvh_max_depth> stack{};
+    std::size_t stack_size = 0;
+    std::uint32_t node_index = 0;
+    bool hit_anything = false;
+    auto closest = t_max;
+    for(;;) {
+        const auto& node = nodes[node_index];
+        if constexpr(CountNodes) {
+            ++*nodes_visited;
+        }
+        if(node.bounds.hit(origin, inv_direction, t_min, closest)) {
+            if(node.count == 0) {
+                //Descend into the child on the near side of the split plane first
+                //so closer hits shrink `closest` before the far child is tested.
+                const auto near_is_second = direction[node.axis] < 0.0f;
+                stack[stack_size++] = near_is_second ? node_index + 1 : node.offset;
+                node_index = near_is_second ? node.offset : node_index + 1;
+                continue;
+            }
+            if(test_leaf(node.offset, static_cast<std::uint32_t>(node.count), closest)) {
+                hit_anything = true;
+            }
+        }
+        if(stack_size == 0) {
+            break;
+        }
+        node_index = stack[--stack_size];
+    }
+    return hit_anything;
+}
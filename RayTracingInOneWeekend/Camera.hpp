@@ -3,6 +3,17 @@
 #include "Ray3.hpp"
 #include "Vector3.hpp"
 
+//Where a camera stands and how its lens is set; the image's aspect ratio is
+//only known at render time.
+struct CameraDesc {
+    Point3 look_from{13.0f, 2.0f, 3.0f};
+    Point3 look_at{0.0f, 0.0f, 0.0f};
+    Vector3 up{0.0f, 1.0f, 0.0f};
+    float vfov_degrees{20.0f};
+    float aperture{0.1f};
+    float focus_distance{10.0f};
+};
+
 class Camera {
 public:
     Camera(Point3 lookFrom, Point3 lookAt, Vector3 vUp, float vfovDegrees, float aspectRatio, float aperture, float focusDistance) {
@@ -38,3 +49,7 @@ private:
     Vector3 w;
     float lens_radius;
 };
+
+inline Camera make_camera(const CameraDesc& desc, float aspect_ratio) {
+    return Camera{desc.look_from, desc.look_at, desc.up, desc.vfov_degrees, aspect_ratio, desc.aperture, desc.focus_distance};
+}
@@ -0,0 +1,238 @@
+#include "Checkpoint.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <set>
+#include <stdexcept>
+
+namespace {
+
+    constexpr std::size_t tile_record_header_bytes = 4 * sizeof(std::int32_t);
+    constexpr std::size_t pixel_record_bytes = 3 * sizeof(float) + sizeof(std::uint32_t);
+
+    template<typename T>
+    void append_value(std::vector<char>& out, const T& value) {
+        const auto* bytes = reinterpret_cast<const char*>(&value);
+        out.insert(out.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    T read_value(const char* data) {
+        T value{};
+        std::memcpy(&value, data, sizeof(T));
+        return value;
+    }
+
+    std::array<int, 4> tile_key(const Tile& tile) {
+        return {tile.x_begin, tile.y_begin, tile.x_end, tile.y_end};
+    }
+
+}
+
+CheckpointHeader make_checkpoint_header(const RenderSettings& settings, std::uint64_t scene_fingerprint) {
+    CheckpointHeader header{};
+    header.image_width = settings.image_width;
+    header.image_height = settings.image_height;
+    header.samples_per_pixel = settings.samples_per_pixel;
+    header.max_depth = settings.max_depth;
+    header.tile_size = settings.tile_size;
+    header.adaptive = settings.adaptive ? 1u : 0u;
+    header.min_samples_per_pixel = settings.adaptive ? settings.min_samples_per_pixel : 0;
+    header.error_threshold = settings.adaptive ? settings.error_threshold : 0.0f;
+    header.roulette_min_depth = settings.roulette_min_depth;
+    header.sampler = static_cast<std::uint32_t>(settings.sampler);
+    header.shading_math = static_cast<std::uint32_t>(settings.shading_math);
+    header.seed = settings.seed;
+    header.first_sample = settings.first_sample;
+    header.scene_fingerprint = scene_fingerprint;
+    return header;
+}
+
+CheckpointContents read_checkpoint(const std::string& path, Framebuffer& framebuffer, CheckpointRead mode) {
+    std::ifstream file(path, std::ios_base::binary);
+    if(!file) {
+        throw std::runtime_error("Could not open checkpoint " + path);
+    }
+    const std::vector<char> data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    CheckpointContents contents{};
+    auto& header = contents.header;
+    if(data.size() < sizeof(CheckpointHeader)) {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    header = read_value<CheckpointHeader>(data.data());
+    if(std::memcmp(header.magic, CheckpointHeader{}.magic, sizeof(header.magic)) != 0 || header.version != CheckpointHeader{}.version
+       || header.image_width <= 0 || header.image_height <= 0) {
+        throw std::runtime_error(path + " is not a checkpoint");
+    }
+    if(framebuffer.pixel_count() == 0) {
+        framebuffer = Framebuffer{header.image_width, header.image_height};
+    } else if(framebuffer.width() != header.image_width || framebuffer.height() != header.image_height) {
+        throw std::runtime_error(path + " is a checkpoint of a " + std::to_string(header.image_width) + 'x' + std::to_string(header.image_height) + " image");
+    }
+
+    std::size_t offset = sizeof(CheckpointHeader);
+    while(data.size() - offset >= tile_record_header_bytes) {
+        const auto* record = data.data() + offset;
+        const auto tile = Tile{read_value<std::int32_t>(record), read_value<std::int32_t>(record + 4), read_value<std::int32_t>(record + 8), read_value<std::int32_t>(record + 12)};
+        if(tile.x_begin < 0 || tile.y_begin < 0 || tile.x_end > header.image_width || tile.y_end > header.image_height
+           || tile.x_begin >= tile.x_end || tile.y_begin >= tile.y_end) {
+            throw std::runtime_error(path + " has a corrupt tile record");
+        }
+        const auto pixel_bytes = static_cast<std::size_t>(tile.x_end - tile.x_begin) * (tile.y_end - tile.y_begin) * pixel_record_bytes;
+        if(data.size() - offset - tile_record_header_bytes < pixel_bytes) {
+            break;
+        }
+        const auto* pixel = record + tile_record_header_bytes;
+        for(int y = tile.y_begin; y < tile.y_end; ++y) {
+            for(int x = tile.x_begin; x < tile.x_end; ++x) {
+                const auto sum = Color{read_value<float>(pixel), read_value<float>(pixel + 4), read_value<float>(pixel + 8)};
+                const auto sample_count = read_value<std::uint32_t>(pixel + 12);
+                if(mode == CheckpointRead::Accumulate) {
+                    framebuffer.accumulate(framebuffer.index(x, y), sum, sample_count);
+                } else {
+                    framebuffer.store(framebuffer.index(x, y), sum, sample_count);
+                }
+                pixel += pixel_record_bytes;
+            }
+        }
+        contents.tiles.push_back(tile);
+        offset += tile_record_header_bytes + pixel_bytes;
+    }
+    contents.valid_bytes = offset;
+    return contents;
+}
+
+bool samples_overlap(const CheckpointContents& a, const CheckpointContents& b) {
+    const auto& ha = a.header;
+    const auto& hb = b.header;
+    if(ha.seed != hb.seed || ha.first_sample + static_cast<std::uint64_t>(ha.samples_per_pixel) <= hb.first_sample
+       || hb.first_sample + static_cast<std::uint64_t>(hb.samples_per_pixel) <= ha.first_sample) {
+        return false;
+    }
+    //Per pixel, not per tile: the two may have been cut with different tile sizes.
+    const auto width = static_cast<std::size_t>(ha.image_width);
+    std::vector<std::uint8_t> covered(width * static_cast<std::size_t>(ha.image_height), 0);
+    for(const auto& tile : a.tiles) {
+        for(int y = tile.y_begin; y < tile.y_end; ++y) {
+            std::fill_n(covered.begin() + static_cast<std::ptrdiff_t>(y * width + tile.x_begin), tile.x_end - tile.x_begin, std::uint8_t{1});
+        }
+    }
+    for(const auto& tile : b.tiles) {
+        for(int y = tile.y_begin; y < tile.y_end; ++y) {
+            const auto row = covered.begin() + static_cast<std::ptrdiff_t>(y * width);
+            if(std::find(row + tile.x_begin, row + tile.x_end, std::uint8_t{1}) != row + tile.x_end) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+std::vector<Tile> remaining_tiles(const std::vector<Tile>& all, const std::vector<Tile>& done) {
+    std::set<std::array<int, 4>> done_keys{};
+    for(const auto& tile : done) {
+        done_keys.insert(tile_key(tile));
+    }
+    std::vector<Tile> remaining{};
+    std::copy_if(all.begin(), all.end(), std::back_inserter(remaining), [&done_keys](const Tile& tile) {
+        return !done_keys.contains(tile_key(tile));
+    });
+    return remaining;
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& path, const CheckpointHeader& header, const Framebuffer& framebuffer, std::chrono::milliseconds interval, std::uint64_t resume_from_bytes)
+: _framebuffer{framebuffer}
+, _interval{interval} {
+    if(resume_from_bytes > 0) {
+        //Drop a torn record left by the interrupted run before appending to it.
+        std::error_code error{};
+        std::filesystem::resize_file(path, resume_from_bytes, error);
+        if(error) {
+            throw std::runtime_error("Could not continue checkpoint " + path + ": " + error.message());
+        }
+        _file.open(path, std::ios_base::binary | std::ios_base::app);
+    } else {
+        _file.open(path, std::ios_base::binary | std::ios_base::trunc);
+        _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        _file.flush();
+    }
+    if(!_file) {
+        throw std::runtime_error("Could not write checkpoint " + path);
+    }
+    _thread = std::thread([this]() { writer_loop(); });
+}
+
+CheckpointWriter::~CheckpointWriter() noexcept {
+    finish();
+}
+
+void CheckpointWriter::tile_done(const Tile& tile) {
+    std::scoped_lock lock(_mutex);
+    _queued.push_back(tile);
+}
+
+bool CheckpointWriter::finish() {
+    {
+        std::scoped_lock lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if(_thread.joinable()) {
+        _thread.join();
+    }
+    return !_failed;
+}
+
+void CheckpointWriter::writer_loop() {
+    PROFILE_THREAD_NAME("Checkpoint Writer");
+    std::vector<Tile> tiles{};
+    for(;;) {
+        bool stopping = false;
+        {
+            std::unique_lock lock(_mutex);
+            _wake.wait_for(lock, _interval, [this]() { return _stopping; });
+            stopping = _stopping;
+            tiles.swap(_queued);
+        }
+        write_tiles(tiles);
+        tiles.clear();
+        if(stopping) {
+            return;
+        }
+    }
+}
+
+//The queued tiles' pixels were stored before they were queued and are never
+//written again, so they can be read here while the workers render other tiles.
+void CheckpointWriter::write_tiles(const std::vector<Tile>& tiles) {
+    if(tiles.empty() || _failed) {
+        return;
+    }
+    PROFILE_SCOPE("Write Checkpoint");
+    _buffer.clear();
+    for(const auto& tile : tiles) {
+        append_value(_buffer, static_cast<std::int32_t>(tile.x_begin));
+        append_value(_buffer, static_cast<std::int32_t>(tile.y_begin));
+        append_value(_buffer, static_cast<std::int32_t>(tile.x_end));
+        append_value(_buffer, static_cast<std::int32_t>(tile.y_end));
+        for(int y = tile.y_begin; y < tile.y_end; ++y) {
+            for(int x = tile.x_begin; x < tile.x_end; ++x) {
+                const auto index = _framebuffer.index(x, y);
+                const auto& sum = _framebuffer.sum(index);
+                append_value(_buffer, sum.x());
+                append_value(_buffer, sum.y());
+                append_value(_buffer, sum.z());
+                append_value(_buffer, _framebuffer.sample_count(index));
+            }
+        }
+    }
+    _file.write(_buffer.data(), static_cast<std::streamsize>(_buffer.size()));
+    _file.flush();
+    _failed = !_file;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include "Framebuffer.hpp"
+#include "Renderer.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//A checkpoint, or the partial accumulation file of a render split across
+//processes, is this header followed by one record per finished tile: the
+//tile's rectangle as four int32s, then for each of its pixels, row by row from
+//the top, the summed radiance as three floats and the sample count as a uint32.
+//Records are only ever appended, so an interrupted write costs at most the
+//last, truncated record.
+//
+//The header is also the whole RNG state: every path's random sequence is keyed
+//on (seed, pixel, sample, bounce), so the seed plus the per-pixel sample counts
+//in the records say exactly where each pixel's sampling stopped.
+struct CheckpointHeader {
+    char magic[4]{'R', 'T', 'C', 'K'};
+    std::uint32_t version{6};
+    std::int32_t image_width{0};
+    std::int32_t image_height{0};
+    std::int32_t samples_per_pixel{0};
+    std::int32_t max_depth{0};
+    std::int32_t tile_size{0};
+    std::uint32_t adaptive{0};
+    std::int32_t min_samples_per_pixel{0};
+    float error_threshold{0.0f};
+    std::int32_t roulette_min_depth{0};
+    std::uint32_t sampler{0}; //SamplerType
+    std::uint32_t shading_math{0}; //ShadingMath
+    std::uint32_t reserved{0};
+    std::uint64_t seed{0};
+    std::uint64_t first_sample{0};
+    std::uint64_t scene_fingerprint{0}; //See scene_fingerprint in Scene.hpp.
+
+    bool operator==(const CheckpointHeader& rhs) const = default;
+};
+static_assert(sizeof(CheckpointHeader) == 80, "CheckpointHeader is written to disk as is.");
+
+CheckpointHeader make_checkpoint_header(const RenderSettings& settings, std::uint64_t scene_fingerprint);
+
+struct CheckpointContents {
+    CheckpointHeader header{};
+    std::vector<Tile> tiles{};
+    //Length of the header and the complete records; anything after it is a torn write.
+    std::uint64_t valid_bytes{0};
+};
+
+enum class CheckpointRead {
+    Replace       //Resuming: the stored pixels are the framebuffer's pixels.
+    ,Accumulate   //Merging: the stored samples are added to the framebuffer's.
+};
+
+//Reads a checkpoint in one bulk read and puts every complete tile record into
+//the framebuffer, which is created from the header if it is empty.
+//Throws std::runtime_error if the file cannot be read, is not a checkpoint, or
+//does not match the framebuffer's size.
+CheckpointContents read_checkpoint(const std::string& path, Framebuffer& framebuffer, CheckpointRead mode = CheckpointRead::Replace);
+
+//True if both files hold some of the same samples of the same pixels: the same
+//seed, overlapping sample ranges and a pixel in common, whatever tile sizes
+//they were rendered with. Merging them would count those samples twice.
+bool samples_overlap(const CheckpointContents& a, const CheckpointContents& b);
+
+//The tiles of all that are not in done, in their original order.
+std::vector<Tile> remaining_tiles(const std::vector<Tile>& all, const std::vector<Tile>& done);
+
+//Appends finished tiles to a checkpoint file from a background thread, so the
+//render workers only ever take a lock long enough to queue a tile. Queued tiles
+//are written and flushed once per interval and when the writer finishes.
+class CheckpointWriter {
+public:
+    //Starts a new checkpoint, or continues one whose first resume_from_bytes
+    //bytes are valid (see CheckpointContents::valid_bytes).
+    //Throws std::runtime_error if the file cannot be opened.
+    CheckpointWriter(const std::string& path, const CheckpointHeader& header, const Framebuffer& framebuffer, std::chrono::milliseconds interval, std::uint64_t resume_from_bytes = 0);
+    ~CheckpointWriter() noexcept;
+
+    CheckpointWriter() = delete;
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter(CheckpointWriter&&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(CheckpointWriter&&) = delete;
+
+    //Called by a render worker once every pixel of the tile is stored.
+    void tile_done(const Tile& tile);
+
+    //Writes everything still queued and stops the background thread.
+    //Returns false if any write failed.
+    bool finish();
+
+protected:
+private:
+    void writer_loop();
+    void write_tiles(const std::vector<Tile>& tiles);
+
+    const Framebuffer& _framebuffer;
+    std::chrono::milliseconds _interval{};
+    std::ofstream _file{};
+    std::vector<char> _buffer{};
+    std::mutex _mutex{};
+    std::condition_variable _wake{};
+    std::vector<Tile> _queued{};
+    bool _stopping{false};
+    bool _failed{false};
+    std::thread _thread{};
+};
@@ -0,0 +1,214 @@
+#include "Denoiser.hpp"
+
+#include "MathUtils.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+    //Below this an albedo channel is treated as black: the lighting under it
+    //cannot be recovered, so the radiance is filtered as it is.
+    constexpr float min_albedo = 0.01f;
+
+    //Mirror-like surfaces are seen through: their AOVs are those of what they
+    //reflect or refract, up to this many bounces deep.
+    constexpr int max_specular_bounces = 4;
+    constexpr float max_specular_roughness = 0.1f;
+
+    bool is_specular(const Material& material) {
+        return material.type == Material::Type::Glass || (material.type == Material::Type::Metal && material.roughness < max_specular_roughness);
+    }
+
+    //Rows per task of a filter pass.
+    constexpr int band_rows = 16;
+
+    constexpr float max_distance = 16.0f;
+
+    //exp(-x) for 0 <= x <= max_distance to about 2e-4 relative error, for
+    //well under the cost of std::exp. Splits 2^(-x log2 e) into an integer power,
+    //placed straight into the exponent bits, and a cubic for the fraction.
+    float negative_exp(float x) {
+        const auto y = -x * 1.44269504f;
+        const auto whole = std::floor(y);
+        const auto f = y - whole;
+        const auto fraction = 1.0f + f * (0.6951786f + f * (0.2261586f + f * 0.0786628f));
+        return std::bit_cast<float>(std::bit_cast<std::int32_t>(fraction) + (static_cast<std::int32_t>(whole) << 23));
+    }
+
+    //B3 spline, the a-trous filter's 1D kernel.
+    constexpr float kernel[5] = {1.0f / 16.0f, 1.0f / 4.0f, 3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+    //Everything a pass reads about a pixel, gathered once.
+    struct GuidePixel {
+        Vector3 normal{};
+        Color albedo{};
+        float depth{0.0f};
+        bool has_samples{false};
+    };
+
+    float demodulate(float radiance, float albedo) {
+        return albedo > min_albedo ? radiance / albedo : radiance;
+    }
+
+    float remodulate(float lighting, float albedo) {
+        return albedo > min_albedo ? lighting * albedo : lighting;
+    }
+
+    //One pass over rows [row_begin, row_end) with taps step pixels apart.
+    void filter_rows(const std::vector<Color>& in, std::vector<Color>& out, const std::vector<GuidePixel>& guide, int width, int height, int row_begin, int row_end, int step, float sigma_color, const DenoiseSettings& settings) {
+        const auto inv_color = 1.0f / (sigma_color * sigma_color);
+        const auto inv_normal = 1.0f / (settings.sigma_normal * settings.sigma_normal);
+        const auto inv_albedo = 1.0f / (settings.sigma_albedo * settings.sigma_albedo);
+        const auto inv_depth = 1.0f / settings.sigma_depth;
+        for(int y = row_begin; y < row_end; ++y) {
+            for(int x = 0; x < width; ++x) {
+                const auto p = static_cast<std::size_t>(y) * width + x;
+                const auto& center = guide[p];
+                if(!center.has_samples) {
+                    out[p] = in[p];
+                    continue;
+                }
+                const auto center_color = in[p];
+                Color sum{0.0f, 0.0f, 0.0f};
+                float weight_sum = 0.0f;
+                for(int dy = -2; dy <= 2; ++dy) {
+                    const auto qy = y + dy * step;
+                    if(qy < 0 || qy >= height) {
+                        continue;
+                    }
+                    for(int dx = -2; dx <= 2; ++dx) {
+                        const auto qx = x + dx * step;
+                        if(qx < 0 || qx >= width) {
+                            continue;
+                        }
+                        const auto q = static_cast<std::size_t>(qy) * width + qx;
+                        const auto& tap = guide[q];
+                        if(!tap.has_samples) {
+                            continue;
+                        }
+                        const auto color_distance = (center_color - in[q]).length_squared() * inv_color;
+                        const auto normal_distance = (center.normal - tap.normal).length_squared() * inv_normal;
+                        const auto albedo_distance = (center.albedo - tap.albedo).length_squared() * inv_albedo;
+                        const auto depth_distance = std::abs(center.depth - tap.depth) / (std::max)((std::max)(center.depth, tap.depth), 1e-4f) * inv_depth;
+                        const auto distance = color_distance + normal_distance + albedo_distance + depth_distance;
+                        //Past this the weight is below 1e-7 of the center's; skip the exp.
+                        if(distance > max_distance) {
+                            continue;
+                        }
+                        const auto weight = kernel[dx + 2] * kernel[dy + 2] * negative_exp(distance);
+                        sum += weight * in[q];
+                        weight_sum += weight;
+                    }
+                }
+                //The center tap always counts, so weight_sum is never 0.
+                out[p] = sum / weight_sum;
+            }
+        }
+    }
+
+}
+
+AovBuffers render_aovs(const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, int sample_count) {
+    PROFILE_SCOPE_FUNCTION();
+    AovBuffers aovs{Framebuffer{settings.image_width, settings.image_height}, Framebuffer{settings.image_width, settings.image_height}, Framebuffer{settings.image_width, settings.image_height}};
+    const auto sampler = make_sampler(settings);
+    for(const auto& tile : tiles) {
+        pool.submit([&tile, &world, &materials, &camera, &settings, &aovs, &sampler, sample_count]() {
+            for(int y = tile.y_begin; y < tile.y_end; ++y) {
+                for(int x = tile.x_begin; x < tile.x_end; ++x) {
+                    const auto pixel_index = static_cast<std::uint64_t>(y) * settings.image_width + x;
+                    Color albedo{0.0f, 0.0f, 0.0f};
+                    Vector3 normal{0.0f, 0.0f, 0.0f};
+                    float depth = 0.0f;
+                    for(int sample = 0; sample < sample_count; ++sample) {
+                        //The same draws, in the same order, as render_tile's camera rays.
+                        const auto sample_index = settings.first_sample + static_cast<std::uint64_t>(sample);
+                        const auto path = SamplePath{sampler.get(), make_path_key(settings.seed, pixel_index, sample_index), pixel_index, sample_index};
+                        seed_sample_path(path, 0);
+                        const auto u = (x + random_float()) / (settings.image_width - 1);
+                        const auto v = (y + random_float()) / (settings.image_height - 1);
+                        auto r = camera.get_ray(u, v);
+                        auto weight = Color{1.0f, 1.0f, 1.0f};
+                        auto distance = 0.0f;
+                        for(int bounce = 0; ; ++bounce) {
+                            hit_record rec{};
+                            if(!world.hit(r, 0.001f, infinity, rec)) {
+                                albedo += weight * background_color(r);
+                                break;
+                            }
+                            distance += rec.t * r.direction().length();
+                            const auto& material = materials[rec.material_id];
+                            Ray3 scattered{};
+                            const auto follow = is_specular(material) && bounce < max_specular_bounces && bounce + 1 < settings.max_depth;
+                            //Seeded as ray_color seeds this bounce, so glass picks the same branch.
+                            seed_sample_path(path, static_cast<std::uint32_t>(bounce + 1));
+                            if(!follow || !material.scatter(r, rec, scattered)) {
+                                albedo += weight * material.color;
+                                normal += rec.normal;
+                                depth += distance;
+                                break;
+                            }
+                            weight = weight * material.color;
+                            r = scattered;
+                        }
+                    }
+                    const auto index = aovs.albedo.index(x, y);
+                    const auto count = static_cast<std::uint32_t>(sample_count);
+                    aovs.albedo.store(index, albedo, count);
+                    aovs.normal.store(index, normal, count);
+                    aovs.depth.store(index, Color{depth, depth, depth}, count);
+                }
+            }
+            end_sample_path();
+        });
+    }
+    pool.wait();
+    return aovs;
+}
+
+void denoise(Framebuffer& framebuffer, const AovBuffers& aovs, const DenoiseSettings& settings, ThreadPool& pool) {
+    PROFILE_SCOPE_FUNCTION();
+    const auto width = framebuffer.width();
+    const auto height = framebuffer.height();
+    const auto pixel_count = framebuffer.pixel_count();
+
+    std::vector<GuidePixel> guide(pixel_count);
+    std::vector<Color> lighting(pixel_count);
+    for(std::size_t i = 0; i < pixel_count; ++i) {
+        const auto albedo = aovs.albedo.average(i);
+        const auto radiance = framebuffer.average(i);
+        guide[i] = GuidePixel{aovs.normal.average(i), albedo, aovs.depth.average(i).x(), framebuffer.sample_count(i) > 0};
+        lighting[i] = Color{demodulate(radiance.x(), albedo.x()), demodulate(radiance.y(), albedo.y()), demodulate(radiance.z(), albedo.z())};
+    }
+
+    std::vector<Color> filtered(pixel_count);
+    auto sigma_color = settings.sigma_color;
+    for(int pass = 0; pass < settings.iterations; ++pass) {
+        const auto step = 1 << pass;
+        for(int row = 0; row < height; row += band_rows) {
+            pool.submit([&lighting, &filtered, &guide, &settings, width, height, row, step, sigma_color]() {
+                filter_rows(lighting, filtered, guide, width, height, row, (std::min)(row + band_rows, height), step, sigma_color, settings);
+            });
+        }
+        pool.wait();
+        std::swap(lighting, filtered);
+        sigma_color *= 0.5f;
+    }
+
+    for(std::size_t i = 0; i < pixel_count; ++i) {
+        const auto count = framebuffer.sample_count(i);
+        if(count == 0) {
+            continue;
+        }
+        const auto& albedo = guide[i].albedo;
+        const auto& l = lighting[i];
+        const auto radiance = Color{remodulate(l.x(), albedo.x()), remodulate(l.y(), albedo.y()), remodulate(l.z(), albedo.z())};
+        framebuffer.store(i, static_cast<float>(count) * radiance, count);
+    }
+}
@@ -0,0 +1,29 @@
+#include "Framebuffer.hpp"
+
+Framebuffer::Framebuffer(int width, int height)
+: m_width{width}
+, m_height{height}
+, m_sums(static_cast<std::size_t>(width) * height, Color{0.0f, 0.0f, 0.0f})
+, m_sample_counts(static_cast<std::size_t>(width) * height, 0u) {
+    /* DO NOTHING */
+}
+
+int Framebuffer::width() const noexcept {
+    return m_width;
+}
+
+int Framebuffer::height() const noexcept {
+    return m_height;
+}
+
+std::size_t Framebuffer::pixel_count() const noexcept {
+    return m_sums.size();
+}
+
+const std::vector<Color>& Framebuffer::sums() const noexcept {
+    return m_sums;
+}
+
+const std::vector<std::uint32_t>& Framebuffer::sample_counts() const noexcept {
+    return m_sample_counts;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Vector3.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Linear radiance accumulated per pixel, kept as float sums next to the number
+//of samples in each so nothing is clamped or gamma-encoded until an encoder
+//writes it out. Pixels are stored top-to-bottom, left-to-right.
+class Framebuffer {
+public:
+    Framebuffer() = default;
+    Framebuffer(const Framebuffer& other) = default;
+    Framebuffer(Framebuffer&& other) = default;
+    Framebuffer& operator=(const Framebuffer& other) = default;
+    Framebuffer& operator=(Framebuffer&& other) = default;
+    ~Framebuffer() = default;
+
+    Framebuffer(int width, int height);
+
+    int width() const noexcept;
+    int height() const noexcept;
+    std::size_t pixel_count() const noexcept;
+
+    //Storage index of the pixel at image coordinates (x, y), y growing upwards as in the camera.
+    std::size_t index(int x, int y) const noexcept {
+        return static_cast<std::size_t>(m_height - 1 - y) * m_width + x;
+    }
+
+    void store(std::size_t index, const Color& sum, std::uint32_t sample_count) {
+        m_sums[index] = sum;
+        m_sample_counts[index] = sample_count;
+    }
+
+    //Adds another render's samples of the same pixel.
+    void accumulate(std::size_t index, const Color& sum, std::uint32_t sample_count) {
+        m_sums[index] += sum;
+        m_sample_counts[index] += sample_count;
+    }
+
+    const Color& sum(std::size_t index) const {
+        return m_sums[index];
+    }
+
+    std::uint32_t sample_count(std::size_t index) const {
+        return m_sample_counts[index];
+    }
+
+    //Mean radiance of a pixel; black if it has no samples.
+    Color average(std::size_t index) const {
+        const auto count = m_sample_counts[index];
+        if(count == 0) {
+            return Color{0.0f, 0.0f, 0.0f};
+        }
+        const auto scale = 1.0f / static_cast<float>(count);
+        const auto& s = m_sums[index];
+        return Color{scale * s.x(), scale * s.y(), scale * s.z()};
+    }
+
+    const std::vector<Color>& sums() const noexcept;
+    const std::vector<std::uint32_t>& sample_counts() const noexcept;
+
+protected:
+private:
+    int m_width{0};
+    int m_height{0};
+    std::vector<Color> m_sums{};
+    std::vector<std::uint32_t> m_sample_counts{};
+};
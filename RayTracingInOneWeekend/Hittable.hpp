@@ -1,14 +1,17 @@
 #pragma once
 
+#include "Aabb.hpp"
 #include "Ray3.hpp"
 #include "Vector3.hpp"
 #include "Material.hpp"
 
+//Kept small: every candidate hit writes one, but only the closest is shaded,
+//so the material is looked up through material_id after traversal finishes.
 struct hit_record {
     Point3 p{};
     Vector3 normal{};
-    Material material{};
-    float t;
+    float t{};
+    MaterialId material_id{};
     bool hit{false};
     bool front_face{ false };
 
@@ -17,10 +20,12 @@ struct hit_record {
         normal = front_face ? outward_normal : -outward_normal;
     }
 };
+static_assert(sizeof(hit_record) <= 2 * sizeof(Vector3) + 16, "hit_record is copied for every closer hit; keep it compact.");
 
 class Hittable {
 public:
     virtual bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const = 0;
+    virtual bool bounding_box(Aabb& output_box) const = 0;
     virtual ~Hittable() noexcept = default;
 protected:
 private:
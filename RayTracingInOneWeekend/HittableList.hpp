@@ -3,35 +3,45 @@
 #include "Hittable.hpp"
 #include "Ray3.hpp"
 
-#include <memory>
+#include <cstddef>
 #include <vector>
 
+//Refers to objects it does not own, usually ones placed in a SceneArena.
 class HittableList : public Hittable{
 public:
     HittableList() = default;
-    HittableList(std::shared_ptr<Hittable> object) {
+    explicit HittableList(const Hittable* object) {
         add(object);
     }
 
     void clear() {
-        objects.clear();
+        m_objects.clear();
     }
 
-    void add(std::shared_ptr<Hittable> object) {
-        objects.emplace_back(object);
+    void reserve(std::size_t count) {
+        m_objects.reserve(count);
+    }
+
+    void add(const Hittable* object) {
+        m_objects.emplace_back(object);
+    }
+
+    const std::vector<const Hittable*>& objects() const {
+        return m_objects;
     }
 
     virtual bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override;
+    virtual bool bounding_box(Aabb& output_box) const override;
 protected:
 private:
-    std::vector<std::shared_ptr<Hittable>> objects;
+    std::vector<const Hittable*> m_objects;
 };
 
-bool HittableList::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+inline bool HittableList::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
     hit_record temp_rec{};
     bool hit_anything = false;
     auto closest = t_max;
-    for(const auto& object : objects) {
+    for(const auto* object : m_objects) {
         if(object->hit(r, t_min, closest, temp_rec)) {
             hit_anything = true;
             closest = temp_rec.t;
@@ -39,4 +49,19 @@ bool HittableList::hit(const Ray3& r, float t_min, float t_max, hit_record& rec)
         }
     }
     return hit_anything;
-}
\ No newline at end of file
+}
+
+inline bool HittableList::bounding_box(Aabb& output_box) const {
+    if(m_objects.empty()) {
+        return false;
+    }
+    output_box = Aabb::empty();
+    for(const auto* object : m_objects) {
+        Aabb object_box{};
+        if(!object->bounding_box(object_box)) {
+            return false;
+        }
+        output_box.expand(object_box);
+    }
+    return true;
+}
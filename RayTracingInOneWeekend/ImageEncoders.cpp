@@ -0,0 +1,194 @@
+#include "ImageEncoders.hpp"
+
+#include "Color.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace {
+
+    void append(std::vector<std::uint8_t>& out, std::string_view text) {
+        out.insert(out.end(), text.begin(), text.end());
+    }
+
+    void append_u32_be(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        out.push_back(static_cast<std::uint8_t>(value >> 24u));
+        out.push_back(static_cast<std::uint8_t>(value >> 16u));
+        out.push_back(static_cast<std::uint8_t>(value >> 8u));
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    constexpr std::array<std::uint32_t, 256> make_crc32_table() {
+        std::array<std::uint32_t, 256> table{};
+        for(std::uint32_t n = 0; n < 256; ++n) {
+            auto c = n;
+            for(int k = 0; k < 8; ++k) {
+                c = (c & 1u) ? 0xEDB88320u ^ (c >> 1u) : c >> 1u;
+            }
+            table[n] = c;
+        }
+        return table;
+    }
+
+    std::uint32_t crc32(const std::uint8_t* data, std::size_t size) {
+        static constexpr auto table = make_crc32_table();
+        auto c = 0xFFFFFFFFu;
+        for(std::size_t i = 0; i < size; ++i) {
+            c = table[(c ^ data[i]) & 0xFFu] ^ (c >> 8u);
+        }
+        return c ^ 0xFFFFFFFFu;
+    }
+
+    std::uint32_t adler32(const std::uint8_t* data, std::size_t size) {
+        //5552 bytes is the most that can be summed before the 32-bit sums could overflow.
+        constexpr std::size_t block = 5552;
+        constexpr std::uint32_t modulus = 65521;
+        std::uint32_t a = 1;
+        std::uint32_t b = 0;
+        while(size > 0) {
+            const auto n = (std::min)(size, block);
+            for(std::size_t i = 0; i < n; ++i) {
+                a += data[i];
+                b += a;
+            }
+            a %= modulus;
+            b %= modulus;
+            data += n;
+            size -= n;
+        }
+        return (b << 16u) | a;
+    }
+
+    //Appends length, type, data and CRC of one PNG chunk.
+    void append_png_chunk(std::vector<std::uint8_t>& out, const char (&type)[5], const std::vector<std::uint8_t>& data) {
+        append_u32_be(out, static_cast<std::uint32_t>(data.size()));
+        const auto crc_start = out.size();
+        append(out, std::string_view{type, 4});
+        out.insert(out.end(), data.begin(), data.end());
+        append_u32_be(out, crc32(out.data() + crc_start, out.size() - crc_start));
+    }
+
+}
+
+ImageFormat image_format_from_path(const std::string& path) {
+    const auto dot = path.find_last_of('.');
+    auto extension = dot == std::string::npos ? std::string{} : path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if(extension == "ppm") {
+        return ImageFormat::Ppm;
+    } else if(extension == "pfm") {
+        return ImageFormat::Pfm;
+    } else if(extension == "png") {
+        return ImageFormat::Png;
+    }
+    throw std::invalid_argument("Unknown image format '" + path + "', expected .ppm, .pfm or .png");
+}
+
+std::vector<std::uint8_t> to_display_rgb8(const Framebuffer& framebuffer) {
+    std::vector<std::uint8_t> rgb(framebuffer.pixel_count() * 3);
+    for(std::size_t i = 0; i < framebuffer.pixel_count(); ++i) {
+        const auto c = framebuffer.average(i);
+        rgb[3 * i + 0] = to_display_byte(c.x());
+        rgb[3 * i + 1] = to_display_byte(c.y());
+        rgb[3 * i + 2] = to_display_byte(c.z());
+    }
+    return rgb;
+}
+
+std::vector<std::uint8_t> encode_ppm(int width, int height, const std::vector<std::uint8_t>& rgb) {
+    const auto header = "P6\n" + std::to_string(width) + ' ' + std::to_string(height) + "\n255\n";
+    std::vector<std::uint8_t> out{};
+    out.reserve(header.size() + rgb.size());
+    append(out, header);
+    out.insert(out.end(), rgb.begin(), rgb.end());
+    return out;
+}
+
+//Zlib stream of stored (uncompressed) deflate blocks: no compression library
+//needed, and encoding costs little more than a copy and two checksums.
+std::vector<std::uint8_t> encode_png(int width, int height, const std::vector<std::uint8_t>& rgb) {
+    const auto row_bytes = static_cast<std::size_t>(width) * 3;
+    std::vector<std::uint8_t> raw{};
+    raw.reserve((row_bytes + 1) * height);
+    for(int y = 0; y < height; ++y) {
+        raw.push_back(0); //Filter type None.
+        const auto row = rgb.begin() + static_cast<std::ptrdiff_t>(row_bytes * y);
+        raw.insert(raw.end(), row, row + static_cast<std::ptrdiff_t>(row_bytes));
+    }
+
+    constexpr std::size_t max_stored_block = 65535;
+    const auto block_count = (std::max)(std::size_t{1}, (raw.size() + max_stored_block - 1) / max_stored_block);
+    std::vector<std::uint8_t> zlib{};
+    zlib.reserve(2 + raw.size() + block_count * 5 + 4);
+    zlib.push_back(0x78);
+    zlib.push_back(0x01);
+    for(std::size_t offset = 0, block = 0; block < block_count; ++block, offset += max_stored_block) {
+        const auto length = static_cast<std::uint16_t>((std::min)(max_stored_block, raw.size() - offset));
+        zlib.push_back(block + 1 == block_count ? 1 : 0);
+        zlib.push_back(static_cast<std::uint8_t>(length));
+        zlib.push_back(static_cast<std::uint8_t>(length >> 8u));
+        const auto inverted_length = static_cast<std::uint16_t>(~length);
+        zlib.push_back(static_cast<std::uint8_t>(inverted_length));
+        zlib.push_back(static_cast<std::uint8_t>(inverted_length >> 8u));
+        zlib.insert(zlib.end(), raw.begin() + static_cast<std::ptrdiff_t>(offset), raw.begin() + static_cast<std::ptrdiff_t>(offset + length));
+    }
+    append_u32_be(zlib, adler32(raw.data(), raw.size()));
+
+    std::vector<std::uint8_t> header{};
+    append_u32_be(header, static_cast<std::uint32_t>(width));
+    append_u32_be(header, static_cast<std::uint32_t>(height));
+    header.insert(header.end(), {8, 2, 0, 0, 0}); //8-bit RGB, deflate, no interlacing.
+
+    std::vector<std::uint8_t> out{};
+    out.reserve(zlib.size() + 64);
+    out.insert(out.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'});
+    append_png_chunk(out, "IHDR", header);
+    append_png_chunk(out, "IDAT", zlib);
+    append_png_chunk(out, "IEND", {});
+    return out;
+}
+
+//Rows run bottom to top and the sign of the scale gives the byte order.
+std::vector<std::uint8_t> encode_pfm(const Framebuffer& framebuffer) {
+    const auto width = framebuffer.width();
+    const auto height = framebuffer.height();
+    const auto header = "PF\n" + std::to_string(width) + ' ' + std::to_string(height) + '\n'
+                      + (std::endian::native == std::endian::little ? "-1.0\n" : "1.0\n");
+    std::vector<std::uint8_t> out(header.size() + framebuffer.pixel_count() * 3 * sizeof(float));
+    std::memcpy(out.data(), header.data(), header.size());
+    auto* dst = out.data() + header.size();
+    for(int row = height - 1; row >= 0; --row) {
+        for(int x = 0; x < width; ++x) {
+            const auto c = framebuffer.average(static_cast<std::size_t>(row) * width + x);
+            const float values[3] = {c.x(), c.y(), c.z()};
+            std::memcpy(dst, values, sizeof(values));
+            dst += sizeof(values);
+        }
+    }
+    return out;
+}
+
+std::vector<std::uint8_t> encode_image(const Framebuffer& framebuffer, ImageFormat format) {
+    switch(format) {
+    case ImageFormat::Ppm: return encode_ppm(framebuffer.width(), framebuffer.height(), to_display_rgb8(framebuffer));
+    case ImageFormat::Pfm: return encode_pfm(framebuffer);
+    case ImageFormat::Png: return encode_png(framebuffer.width(), framebuffer.height(), to_display_rgb8(framebuffer));
+    default: return {};
+    }
+}
+
+bool write_file(const std::string& path, const std::vector<std::uint8_t>& bytes) {
+    std::ofstream file(path, std::ios_base::binary);
+    if(!file) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    file.close();
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Framebuffer.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class ImageFormat {
+    Ppm   //Binary 8-bit RGB (P6), gamma 2.
+    ,Pfm  //Portable float map: linear, unclamped radiance for compositing.
+    ,Png  //8-bit RGB, gamma 2.
+};
+
+//Picks the format from a file name's extension: .ppm, .pfm or .png.
+//Throws std::invalid_argument for anything else.
+ImageFormat image_format_from_path(const std::string& path);
+
+//Averages, gamma-encodes and clamps the framebuffer to 8-bit RGB, top row first.
+std::vector<std::uint8_t> to_display_rgb8(const Framebuffer& framebuffer);
+
+//Each encoder returns the complete file, ready for write_file.
+std::vector<std::uint8_t> encode_ppm(int width, int height, const std::vector<std::uint8_t>& rgb);
+std::vector<std::uint8_t> encode_png(int width, int height, const std::vector<std::uint8_t>& rgb);
+std::vector<std::uint8_t> encode_pfm(const Framebuffer& framebuffer);
+
+std::vector<std::uint8_t> encode_image(const Framebuffer& framebuffer, ImageFormat format);
+
+//Writes the whole file with one call. Returns false if it could not be written.
+bool write_file(const std::string& path, const std::vector<std::uint8_t>& bytes);
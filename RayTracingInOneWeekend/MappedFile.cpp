@@ -0,0 +1,97 @@
+#include "MappedFile.hpp"
+
+#include <stdexcept>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(const std::string& path) {
+    _file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(_file == INVALID_HANDLE_VALUE) {
+        _file = nullptr;
+        throw std::runtime_error("Could not open " + path);
+    }
+    LARGE_INTEGER size{};
+    if(!GetFileSizeEx(_file, &size)) {
+        CloseHandle(_file);
+        throw std::runtime_error("Could not read the size of " + path);
+    }
+    _size = static_cast<std::size_t>(size.QuadPart);
+    if(_size == 0) {
+        return;
+    }
+    _mapping = CreateFileMappingA(_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!_mapping) {
+        CloseHandle(_file);
+        throw std::runtime_error("Could not map " + path);
+    }
+    _data = static_cast<const char*>(MapViewOfFile(_mapping, FILE_MAP_READ, 0, 0, 0));
+    if(!_data) {
+        CloseHandle(_mapping);
+        CloseHandle(_file);
+        throw std::runtime_error("Could not map " + path);
+    }
+}
+
+MappedFile::~MappedFile() noexcept {
+    if(_data) {
+        UnmapViewOfFile(_data);
+    }
+    if(_mapping) {
+        CloseHandle(_mapping);
+    }
+    if(_file) {
+        CloseHandle(_file);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& path) {
+    const auto fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0) {
+        throw std::runtime_error("Could not open " + path);
+    }
+    struct stat info{};
+    if(::fstat(fd, &info) != 0) {
+        ::close(fd);
+        throw std::runtime_error("Could not read the size of " + path);
+    }
+    _size = static_cast<std::size_t>(info.st_size);
+    if(_size > 0) {
+        auto* mapped = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapped == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error("Could not map " + path);
+        }
+        _data = static_cast<const char*>(mapped);
+    }
+    //The mapping keeps the file alive on its own.
+    ::close(fd);
+}
+
+MappedFile::~MappedFile() noexcept {
+    if(_data) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+#endif
+
+const char* MappedFile::data() const noexcept {
+    return _data;
+}
+
+std::size_t MappedFile::size() const noexcept {
+    return _size;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+//A whole file mapped read-only into memory. Pages are read from disk the
+//first time they are touched, so opening even a very large file is cheap.
+class MappedFile {
+public:
+    //Throws std::runtime_error if the file cannot be opened or mapped.
+    explicit MappedFile(const std::string& path);
+    ~MappedFile() noexcept;
+
+    MappedFile() = delete;
+    MappedFile(const MappedFile&) = delete;
+    MappedFile(MappedFile&&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile& operator=(MappedFile&&) = delete;
+
+    const char* data() const noexcept;
+    std::size_t size() const noexcept;
+
+protected:
+private:
+    const char* _data{nullptr};
+    std::size_t _size{0};
+#if defined(_WIN32)
+    void* _file{nullptr};
+    void* _mapping{nullptr};
+#endif
+};
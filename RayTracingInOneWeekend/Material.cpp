@@ -2,57 +2,42 @@
 
 #include "Ray3.hpp"
 #include "Hittable.hpp"
+#include "MaterialKernels.hpp"
+#include "RayStats.hpp"
 
-bool Material::scatter([[maybe_unused]] const Ray3& ray_in, const hit_record& rec, Ray3& result) {
+bool Material::scatter(const Ray3& ray_in, const hit_record& rec, Ray3& result) const {
     switch(type) {
     case Type::Lambertian:
     {
-        const auto direction = [&rec, this]() {
-            auto result = rec.normal + roughness * random_unit_vector();
-            if(result.near_zero()) {
-                result = rec.normal;
-            }
-            return result;
-        }();
-        result = Ray3{ rec.p, direction };
-        return true;
+        return scatter_lambertian(ray_in, rec, result);
     }
     case Type::Metal:
     {
-        const auto direction = metallic * reflect(unit_vector(ray_in.direction()), rec.normal);
-        result = Ray3{rec.p, direction + roughness * random_in_unit_sphere()};
-        return (dot(result.direction(), rec.normal) > 0);
+        return scatter_metal(ray_in, rec, result);
     }
     case Type::Glass:
     {
-        static const auto reflectance = [](float cosine, float ref_idx) {
-            // Use Schlick's approximation for reflectance.
-            auto r0 = (1.0f - ref_idx) / (1.0f + ref_idx);
-            r0 = r0 * r0;
-            return r0 + (1.0f - r0) * std::pow((1.0f - cosine), 5.0f);
-        };
-        const auto direction = [&rec, &ray_in, this]() {
-            const auto refraction_ratio = rec.front_face ? (1.0f / refractionIndex) : refractionIndex;
-            const auto unit_direction = unit_vector(ray_in.direction());
-            const auto cos_theta = std::fmin(dot(-unit_direction, rec.normal), 1.0f);
-            const auto sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
-            const auto cannot_refract = refraction_ratio * sin_theta > 1.0f;
-            if(cannot_refract || reflectance(cos_theta, refraction_ratio) > random_float()) {
-                return reflect(unit_direction, rec.normal);
-            } else {
-                return refract(unit_direction, rec.normal, refraction_ratio);
-            }
-        }();
-        result = Ray3{ rec.p, direction };
-        return true;
+        return scatter_glass(ray_in, rec, result);
     }
     default:
     {
-        return false;
+        return scatter_kernel<Type::None>(*this, ray_in, rec, result);
     }
     }
 }
 
+bool Material::scatter_lambertian(const Ray3& ray_in, const hit_record& rec, Ray3& result) const {
+    return scatter_kernel<Type::Lambertian>(*this, ray_in, rec, result);
+}
+
+bool Material::scatter_metal(const Ray3& ray_in, const hit_record& rec, Ray3& result) const {
+    return scatter_kernel<Type::Metal>(*this, ray_in, rec, result);
+}
+
+bool Material::scatter_glass(const Ray3& ray_in, const hit_record& rec, Ray3& result) const {
+    return scatter_kernel<Type::Glass>(*this, ray_in, rec, result);
+}
+
 Material make_material(const MaterialDesc& desc) {
     Material m{};
     m.color = desc.color;
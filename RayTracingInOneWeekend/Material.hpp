@@ -2,6 +2,10 @@
 
 #include "Vector3.hpp"
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 class Ray3;
 struct hit_record;
 
@@ -14,7 +18,12 @@ public:
         ,Glass
     };
 
-    bool scatter(const Ray3& ray_in, const hit_record& rec, Ray3& result);
+    bool scatter(const Ray3& ray_in, const hit_record& rec, Ray3& result) const;
+
+    //The individual branches of scatter, for callers that have already grouped hits by type.
+    bool scatter_lambertian(const Ray3& ray_in, const hit_record& rec, Ray3& result) const;
+    bool scatter_metal(const Ray3& ray_in, const hit_record& rec, Ray3& result) const;
+    bool scatter_glass(const Ray3& ray_in, const hit_record& rec, Ray3& result) const;
 
     Vector3 attenuation{};
     Color color{};
@@ -33,6 +42,35 @@ struct MaterialDesc {
     float refractionIndex{1.0f};
 };
 
+//Index of a Material in the scene's MaterialTable.
+using MaterialId = std::uint32_t;
+
+//Scene-wide material storage. Primitives and hit records refer to materials
+//by MaterialId so a hit never copies a Material.
+class MaterialTable {
+public:
+    MaterialId add(const Material& material) {
+        m_materials.emplace_back(material);
+        return static_cast<MaterialId>(m_materials.size() - 1);
+    }
+
+    const Material& operator[](MaterialId id) const {
+        return m_materials[id];
+    }
+
+    std::size_t size() const noexcept {
+        return m_materials.size();
+    }
+
+    void clear() {
+        m_materials.clear();
+    }
+
+protected:
+private:
+    std::vector<Material> m_materials{};
+};
+
 Material make_material(const MaterialDesc& desc);
 Material make_lambertian(const MaterialDesc& desc);
 Material make_metal(const MaterialDesc& desc);
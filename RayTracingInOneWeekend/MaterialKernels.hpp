@@ -0,0 +1,88 @@
+#pragma once
+
+#include "Hittable.hpp"
+#include "Material.hpp"
+#include "Ray3.hpp"
+#include "RayStats.hpp"
+#include "ShadingMath.hpp"
+#include "Vector3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+
+//The branches of Material::scatter as one template over the material type.
+//Code that knows the type at compile time gets its branch inlined and
+//specialized instead of calling through the switch; Material's own scatter
+//functions are these kernels too, in ShadingMath::Reference.
+//
+//ShadingMath::Fast swaps the Schlick power and the refraction for the fast_
+//versions in ShadingMath.hpp; normalization stays unit_vector in both, as a
+//reciprocal square root estimate measured no faster. They differ from the
+//reference by a few float ulps; the benchmarks' --fast-math-accuracy reports
+//by how much, and what it does to the image.
+template<Material::Type type, ShadingMath math = ShadingMath::Reference>
+bool scatter_kernel(const Material& material, const Ray3& ray_in, const hit_record& rec, Ray3& result);
+
+//Calls kernel(std::integral_constant<Material::Type, type>{}), so the kernel
+//can pass the type on as a template argument, and returns what it returns.
+template<typename Kernel>
+decltype(auto) visit_material_type(Material::Type type, Kernel&& kernel);
+
+template<Material::Type type, ShadingMath math>
+bool scatter_kernel(const Material& material, [[maybe_unused]] const Ray3& ray_in, const hit_record& rec, Ray3& result) {
+    if constexpr(type == Material::Type::Lambertian) {
+        auto direction = rec.normal + material.roughness * random_unit_vector();
+        if(direction.near_zero()) {
+            direction = rec.normal;
+        }
+        result = Ray3{rec.p, direction};
+        return true;
+    } else if constexpr(type == Material::Type::Metal) {
+        const auto direction = material.metallic * reflect(unit_vector(ray_in.direction()), rec.normal);
+        result = Ray3{rec.p, direction + material.roughness * random_in_unit_sphere()};
+        const auto scattered = dot(result.direction(), rec.normal) > 0;
+        if(!scattered) {
+            RAY_STATS(++thread_ray_stats().absorbed);
+        }
+        return scattered;
+    } else if constexpr(type == Material::Type::Glass) {
+        const auto refraction_ratio = rec.front_face ? (1.0f / material.refractionIndex) : material.refractionIndex;
+        const auto unit_direction = unit_vector(ray_in.direction());
+        if constexpr(math == ShadingMath::Fast) {
+            //sin_theta > 1 / ratio, squared, so no square root; then refract
+            //reuses cos_theta.
+            const auto cos_theta = (std::min)(dot(-unit_direction, rec.normal), 1.0f);
+            const auto cannot_refract = refraction_ratio * refraction_ratio * (1.0f - cos_theta * cos_theta) > 1.0f;
+            if(cannot_refract || fast_schlick_reflectance(cos_theta, refraction_ratio) > random_float()) {
+                result = Ray3{rec.p, reflect(unit_direction, rec.normal)};
+            } else {
+                result = Ray3{rec.p, fast_refract(unit_direction, rec.normal, refraction_ratio, cos_theta)};
+            }
+        } else {
+            const auto cos_theta = std::fmin(dot(-unit_direction, rec.normal), 1.0f);
+            const auto sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+            const auto cannot_refract = refraction_ratio * sin_theta > 1.0f;
+            if(cannot_refract || schlick_reflectance(cos_theta, refraction_ratio) > random_float()) {
+                result = Ray3{rec.p, reflect(unit_direction, rec.normal)};
+            } else {
+                result = Ray3{rec.p, refract(unit_direction, rec.normal, refraction_ratio)};
+            }
+        }
+        return true;
+    } else {
+        RAY_STATS(++thread_ray_stats().absorbed);
+        return false;
+    }
+}
+
+template<typename Kernel>
+decltype(auto) visit_material_type(Material::Type type, Kernel&& kernel) {
+    switch(type) {
+    case Material::Type::Lambertian: return std::forward<Kernel>(kernel)(std::integral_constant<Material::Type, Material::Type::Lambertian>{});
+    case Material::Type::Metal: return std::forward<Kernel>(kernel)(std::integral_constant<Material::Type, Material::Type::Metal>{});
+    case Material::Type::Glass: return std::forward<Kernel>(kernel)(std::integral_constant<Material::Type, Material::Type::Glass>{});
+    default: return std::forward<Kernel>(kernel)(std::integral_constant<Material::Type, Material::Type::None>{});
+    }
+}
@@ -1,9 +1,12 @@
 #pragma once
 
+#include "Random.hpp"
+#include "Sampler.hpp"
+
 #include <climits>
 #include <cmath>
+#include <limits>
 #include <numbers>
-#include <random>
 
 constexpr auto infinity = std::numeric_limits<float>::infinity();
 constexpr auto pi = std::numbers::pi_v<float>;
@@ -12,14 +15,16 @@ inline float degrees_to_radians(float degrees) {
     return degrees * pi / 180.0f;
 }
 
+//The next number of the calling thread's sample stream, see seed_sample_path,
+//or of its generator once the stream's dimensions are used up.
 inline float random_float() {
-    std::uniform_real_distribution<float> d(0.0f, 1.0f);
-    static std::mt19937 g;
-    return d(g);
+    auto& stream = thread_sample_stream();
+    if(stream.dimension < stream.dimension_end) {
+        return stream.sampler->get(stream.pixel_index, stream.sample_index, stream.dimension++);
+    }
+    return thread_rng().next_float();
 }
 
 inline float random_float(float min, float exclusive_max) {
-    std::uniform_real_distribution<float> d(min, exclusive_max);
-    static std::mt19937 g;
-    return d(g);
+    return min + (exclusive_max - min) * random_float();
 }
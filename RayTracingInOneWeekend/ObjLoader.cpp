@@ -0,0 +1,208 @@
+#include "ObjLoader.hpp"
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+    //Files are split into chunks of at least this many bytes, so small files
+    //are not scattered across the pool for nothing.
+    constexpr std::size_t min_chunk_bytes = std::size_t{1} << 20u;
+
+    struct ObjChunk {
+        const char* begin{nullptr};
+        const char* end{nullptr};
+        std::vector<float> positions{};
+        //Three corners per triangle. OBJ indices count from 1; these count
+        //from 0, from the start of the file for positive OBJ indices and from
+        //the start of this chunk for negative ones, which relative_corners
+        //lists so they can be moved once every chunk's vertex count is known.
+        //A relative corner that reaches back past the chunk's first vertex is
+        //negative until then.
+        std::vector<std::int64_t> corners{};
+        std::vector<std::size_t> relative_corners{};
+        //Where parsing stopped and why; empty if it did not.
+        const char* error_position{nullptr};
+        std::string error{};
+        std::exception_ptr failure{};
+    };
+
+    bool is_space(char c) {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    std::string_view next_word(std::string_view& rest) {
+        while(!rest.empty() && is_space(rest.front())) {
+            rest.remove_prefix(1);
+        }
+        auto end = std::size_t{0};
+        while(end < rest.size() && !is_space(rest[end])) {
+            ++end;
+        }
+        const auto word = rest.substr(0, end);
+        rest.remove_prefix(end);
+        return word;
+    }
+
+    //Parses one line, returning an error message, or nothing if it is fine.
+    //face is scratch space for the OBJ indices of a face.
+    const char* parse_line(std::string_view line, ObjChunk& chunk, std::vector<std::int64_t>& face) {
+        const auto statement = next_word(line);
+        if(statement == "v") {
+            for(int axis = 0; axis < 3; ++axis) {
+                const auto word = next_word(line);
+                float value{};
+                const auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), value);
+                if(word.empty() || error != std::errc{} || end != word.data() + word.size()) {
+                    return "a vertex needs three numbers";
+                }
+                chunk.positions.push_back(value);
+            }
+        } else if(statement == "f") {
+            face.clear();
+            const auto local_vertices = static_cast<std::int64_t>(chunk.positions.size() / 3);
+            for(auto word = next_word(line); !word.empty(); word = next_word(line)) {
+                //Only the vertex of "v/vt/vn" matters.
+                std::int64_t index{};
+                const auto [end, error] = std::from_chars(word.data(), word.data() + word.size(), index);
+                if(error != std::errc{} || (end != word.data() + word.size() && *end != '/') || index == 0) {
+                    return "a face corner is not a vertex index";
+                }
+                face.push_back(index);
+            }
+            if(face.size() < 3) {
+                return "a face needs at least three corners";
+            }
+            const auto add_corner = [&chunk, local_vertices](std::int64_t index) {
+                if(index < 0) {
+                    chunk.relative_corners.push_back(chunk.corners.size());
+                    chunk.corners.push_back(local_vertices + index);
+                } else {
+                    chunk.corners.push_back(index - 1);
+                }
+            };
+            for(std::size_t i = 1; i + 1 < face.size(); ++i) {
+                add_corner(face[0]);
+                add_corner(face[i]);
+                add_corner(face[i + 1]);
+            }
+        }
+        //Everything else (vt, vn, g, o, s, usemtl, mtllib, comments) is skipped.
+        return nullptr;
+    }
+
+    void parse_chunk(ObjChunk& chunk) {
+        std::vector<std::int64_t> face{};
+        for(const char* line = chunk.begin; line < chunk.end;) {
+            const auto* newline = static_cast<const char*>(std::memchr(line, '\n', static_cast<std::size_t>(chunk.end - line)));
+            const auto* line_end = newline ? newline : chunk.end;
+            if(const auto* error = parse_line(std::string_view{line, static_cast<std::size_t>(line_end - line)}, chunk, face)) {
+                chunk.error_position = line;
+                chunk.error = error;
+                return;
+            }
+            line = line_end + 1;
+        }
+    }
+
+}
+
+MeshBuffers load_obj(const std::string& path, ThreadPool& pool) {
+    const MappedFile file{path};
+    const auto* data = file.data();
+    const auto size = file.size();
+
+    //Chunk boundaries move forward to the next line break.
+    const auto max_chunks = static_cast<std::size_t>(pool.thread_count()) * 4;
+    const auto chunk_count = std::clamp(size / min_chunk_bytes, std::size_t{1}, max_chunks);
+    std::vector<ObjChunk> chunks(chunk_count);
+    const char* chunk_begin = data;
+    for(std::size_t i = 0; i < chunk_count; ++i) {
+        const char* chunk_end = data + size;
+        if(i + 1 < chunk_count) {
+            chunk_end = (std::max)(chunk_begin, data + size * (i + 1) / chunk_count);
+            const auto* newline = static_cast<const char*>(std::memchr(chunk_end, '\n', static_cast<std::size_t>(data + size - chunk_end)));
+            chunk_end = newline ? newline + 1 : data + size;
+        }
+        chunks[i].begin = chunk_begin;
+        chunks[i].end = chunk_end;
+        chunk_begin = chunk_end;
+    }
+    for(auto& chunk : chunks) {
+        pool.submit([&chunk]() {
+            try {
+                parse_chunk(chunk);
+            } catch(...) {
+                chunk.failure = std::current_exception();
+            }
+        });
+    }
+    pool.wait();
+
+    std::vector<std::size_t> vertex_offsets(chunk_count + 1);
+    std::vector<std::size_t> corner_offsets(chunk_count + 1);
+    for(std::size_t i = 0; i < chunk_count; ++i) {
+        const auto& chunk = chunks[i];
+        if(chunk.failure) {
+            std::rethrow_exception(chunk.failure);
+        }
+        if(!chunk.error.empty()) {
+            const auto line = std::count(data, chunk.error_position, '\n') + 1;
+            throw std::runtime_error(path + ':' + std::to_string(line) + ": " + chunk.error);
+        }
+        vertex_offsets[i + 1] = vertex_offsets[i] + chunk.positions.size() / 3;
+        corner_offsets[i + 1] = corner_offsets[i] + chunk.corners.size();
+    }
+    const auto vertex_count = vertex_offsets.back();
+    if(vertex_count > (std::numeric_limits<std::uint32_t>::max)()) {
+        throw std::runtime_error(path + " has more vertices than 32-bit indices can address");
+    }
+
+    //Every chunk's part of the buffers is known now, so the chunks are copied
+    //into place on the pool as well.
+    MeshBuffers buffers{};
+    buffers.positions.resize(vertex_count * 3);
+    buffers.indices.resize(corner_offsets.back());
+    //The first corner of each chunk that is outside the file's vertices.
+    std::vector<std::optional<std::int64_t>> bad_corners(chunk_count);
+    for(std::size_t i = 0; i < chunk_count; ++i) {
+        pool.submit([&, i]() {
+            auto& chunk = chunks[i];
+            std::copy(chunk.positions.begin(), chunk.positions.end(), buffers.positions.begin() + static_cast<std::ptrdiff_t>(vertex_offsets[i] * 3));
+            for(const auto corner : chunk.relative_corners) {
+                chunk.corners[corner] += static_cast<std::int64_t>(vertex_offsets[i]);
+            }
+            auto* indices = buffers.indices.data() + corner_offsets[i];
+            for(std::size_t c = 0; c < chunk.corners.size(); ++c) {
+                const auto corner = chunk.corners[c];
+                if(corner < 0 || corner >= static_cast<std::int64_t>(vertex_count)) {
+                    bad_corners[i] = corner;
+                    return;
+                }
+                indices[c] = static_cast<std::uint32_t>(corner);
+            }
+        });
+    }
+    pool.wait();
+    for(const auto& corner : bad_corners) {
+        if(!corner) {
+            continue;
+        }
+        if(*corner < 0) {
+            throw std::runtime_error(path + ": a face's relative index refers to a vertex before the first one");
+        }
+        throw std::runtime_error(path + ": a face refers to vertex " + std::to_string(*corner + 1) + ", but the file has " + std::to_string(vertex_count));
+    }
+    return buffers;
+}
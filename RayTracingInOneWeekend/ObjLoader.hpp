@@ -0,0 +1,16 @@
+#pragma once
+
+#include "TriangleMesh.hpp"
+
+#include <string>
+
+class ThreadPool;
+
+//Reads the vertices and faces of a Wavefront OBJ file into mesh buffers. The
+//file is mapped, cut into chunks at line breaks, and the chunks are parsed on
+//the pool at the same time; nothing is allocated per vertex or face beyond
+//the buffers themselves. Faces with more than three corners become a fan of
+//triangles and negative (relative) indices are resolved. Texture coordinates,
+//normals, groups and materials are skipped. Throws std::runtime_error naming
+//the file, and the line where it can tell.
+MeshBuffers load_obj(const std::string& path, ThreadPool& pool);
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "MathUtils.hpp"
+#include "Vector3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+//Running mean and variance of the luminance of one pixel's samples, updated one
+//sample at a time with Welford's method so no sample has to be kept around.
+class PixelStatistics {
+public:
+    void add(const Color& sample) {
+        const auto luminance = 0.2126f * sample.x() + 0.7152f * sample.y() + 0.0722f * sample.z();
+        ++m_count;
+        const auto delta = luminance - m_mean;
+        m_mean += delta / static_cast<float>(m_count);
+        m_m2 += delta * (luminance - m_mean);
+    }
+
+    std::uint32_t count() const {
+        return m_count;
+    }
+
+    float mean() const {
+        return m_mean;
+    }
+
+    float variance() const {
+        return m_count > 1 ? m_m2 / static_cast<float>(m_count - 1) : 0.0f;
+    }
+
+    //Half-width of the 95% confidence interval of the mean, measured after the
+    //gamma 2 encoding the image is written with, so it reads in output units
+    //(1/255 is one step of an 8-bit channel).
+    float error() const {
+        if(m_count < 2) {
+            return infinity;
+        }
+        const auto standard_error = std::sqrt(variance() / static_cast<float>(m_count));
+        return 1.96f * standard_error / (2.0f * std::sqrt((std::max)(m_mean, 1e-4f)));
+    }
+
+protected:
+private:
+    std::uint32_t m_count{0};
+    float m_mean{0.0f};
+    float m_m2{0.0f};
+};
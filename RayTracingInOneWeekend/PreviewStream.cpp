@@ -0,0 +1,162 @@
+#include "PreviewStream.hpp"
+
+#include "Color.hpp"
+#include "Profiler.hpp"
+
+#include <string>
+#include <utility>
+
+#if defined(_WIN32)
+    #include <fcntl.h>
+    #include <io.h>
+#else
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+PreviewStream::PreviewStream(const std::string& path, int width, int height, std::chrono::milliseconds interval)
+: _path{path}
+, _width{width}
+, _height{height}
+, _interval{interval}
+, _last_post{std::chrono::steady_clock::now() - interval} {
+#if !defined(_WIN32)
+    //A viewer closing the pipe must fail the next write, not end the process.
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    _thread = std::thread([this]() { writer_loop(); });
+}
+
+PreviewStream::~PreviewStream() noexcept {
+    finish();
+}
+
+bool PreviewStream::frame_due() const noexcept {
+    return std::chrono::steady_clock::now() - _last_post >= _interval;
+}
+
+void PreviewStream::post(const Framebuffer& snapshot) {
+    _last_post = std::chrono::steady_clock::now();
+    {
+        std::scoped_lock lock(_mutex);
+        if(_has_pending) {
+            ++_frames_replaced;
+        }
+        //Assigning into the mailbox reuses its buffers once it has held a frame this size.
+        _pending = snapshot;
+        _has_pending = true;
+    }
+    _wake.notify_one();
+}
+
+bool PreviewStream::finish() {
+    {
+        std::scoped_lock lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_one();
+    if(_thread.joinable()) {
+        _thread.join();
+    }
+    return !_failed;
+}
+
+std::uint64_t PreviewStream::frames_sent() const noexcept {
+    return _frames_sent;
+}
+
+std::uint64_t PreviewStream::frames_replaced() const noexcept {
+    return _frames_replaced;
+}
+
+void PreviewStream::writer_loop() {
+    PROFILE_THREAD_NAME("Preview Stream");
+    std::FILE* stream = open_stream();
+    Framebuffer snapshot{};
+    for(;;) {
+        bool has_frame = false;
+        bool stopping = false;
+        {
+            std::unique_lock lock(_mutex);
+            _wake.wait(lock, [this]() { return _has_pending || _stopping; });
+            stopping = _stopping;
+            if(_has_pending) {
+                //Swapped, not copied: the mailbox gets back the last frame's buffers.
+                std::swap(snapshot, _pending);
+                _has_pending = false;
+                has_frame = true;
+            }
+        }
+        if(has_frame && stream && !_failed) {
+            write_frame(stream, snapshot);
+        }
+        if(stopping) {
+            break;
+        }
+    }
+    if(stream && stream != stdout) {
+        _failed = std::fclose(stream) != 0 || _failed;
+    }
+}
+
+//Opening a named pipe for writing waits for a reader. On POSIX the open is
+//retried without blocking, so finish can still stop a stream nobody opened.
+std::FILE* PreviewStream::open_stream() {
+    if(_path == "-") {
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        return stdout;
+    }
+#if defined(_WIN32)
+    std::FILE* stream = std::fopen(_path.c_str(), "wb");
+    _failed = stream == nullptr;
+    return stream;
+#else
+    for(;;) {
+        const auto fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+        if(fd >= 0) {
+            ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            std::FILE* stream = ::fdopen(fd, "wb");
+            _failed = stream == nullptr;
+            return stream;
+        }
+        if(errno != ENXIO) {
+            _failed = true;
+            return nullptr;
+        }
+        std::unique_lock lock(_mutex);
+        if(_wake.wait_for(lock, std::chrono::milliseconds{100}, [this]() { return _stopping; })) {
+            return nullptr;
+        }
+    }
+#endif
+}
+
+void PreviewStream::write_frame(std::FILE* stream, const Framebuffer& snapshot) {
+    PROFILE_SCOPE("Write Preview Frame");
+    _rgb.resize(static_cast<std::size_t>(_width) * _height * 3);
+    //Nearest pixel, so a low-resolution pass shows as blocks the size of its pixels.
+    for(int y = 0; y < _height; ++y) {
+        const auto source_y = static_cast<int>(static_cast<std::int64_t>(y) * snapshot.height() / _height);
+        for(int x = 0; x < _width; ++x) {
+            const auto source_x = static_cast<int>(static_cast<std::int64_t>(x) * snapshot.width() / _width);
+            const auto c = snapshot.average(static_cast<std::size_t>(source_y) * snapshot.width() + source_x);
+            auto* pixel = &_rgb[(static_cast<std::size_t>(y) * _width + x) * 3];
+            pixel[0] = to_display_byte(c.x());
+            pixel[1] = to_display_byte(c.y());
+            pixel[2] = to_display_byte(c.z());
+        }
+    }
+    const auto header = "P6\n" + std::to_string(_width) + ' ' + std::to_string(_height) + "\n255\n";
+    const auto written = std::fwrite(header.data(), 1, header.size(), stream) == header.size()
+                         && std::fwrite(_rgb.data(), 1, _rgb.size(), stream) == _rgb.size()
+                         && std::fflush(stream) == 0;
+    if(written) {
+        ++_frames_sent;
+    } else {
+        _failed = true;
+    }
+}
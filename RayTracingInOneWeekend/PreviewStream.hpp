@@ -0,0 +1,68 @@
+#pragma once
+
+#include "Framebuffer.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Streams snapshots of a progressive render to stdout or a file, typically a
+//named pipe, as back-to-back binary PPM frames that any viewer reading P6 can
+//show live. A background thread encodes and writes them; post only copies the
+//snapshot into a one-frame mailbox, so a slow or stalled viewer never holds up
+//the render. A snapshot the viewer had no time for is replaced by the next.
+class PreviewStream {
+public:
+    //path "-" is stdout. Frames are width x height; snapshots of another size
+    //are scaled to it. interval is the least time between two frames.
+    PreviewStream(const std::string& path, int width, int height, std::chrono::milliseconds interval);
+    ~PreviewStream() noexcept;
+
+    PreviewStream() = delete;
+    PreviewStream(const PreviewStream&) = delete;
+    PreviewStream(PreviewStream&&) = delete;
+    PreviewStream& operator=(const PreviewStream&) = delete;
+    PreviewStream& operator=(PreviewStream&&) = delete;
+
+    //True once interval has passed since the last post.
+    bool frame_due() const noexcept;
+
+    //Queues a copy of the snapshot as the next frame.
+    void post(const Framebuffer& snapshot);
+
+    //Sends the frame still queued and stops the background thread. Returns
+    //false if the stream could not be opened or a write failed, as it does
+    //once the viewer closes its end.
+    bool finish();
+
+    std::uint64_t frames_sent() const noexcept;
+    //Frames replaced in the mailbox before the background thread took them.
+    std::uint64_t frames_replaced() const noexcept;
+
+protected:
+private:
+    void writer_loop();
+    std::FILE* open_stream();
+    void write_frame(std::FILE* stream, const Framebuffer& snapshot);
+
+    std::string _path{};
+    int _width{0};
+    int _height{0};
+    std::chrono::milliseconds _interval{};
+    std::chrono::steady_clock::time_point _last_post{};
+    std::vector<std::uint8_t> _rgb{};
+    std::mutex _mutex{};
+    std::condition_variable _wake{};
+    Framebuffer _pending{};
+    bool _has_pending{false};
+    bool _stopping{false};
+    bool _failed{false};
+    std::uint64_t _frames_sent{0};
+    std::uint64_t _frames_replaced{0};
+    std::thread _thread{};
+};
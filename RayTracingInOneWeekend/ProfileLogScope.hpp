@@ -1,14 +1,11 @@
 #pragma once
 
-#include <chrono>
-
-
-#define TOKEN_PASTE_SIMPLE(x, y) x##y
-#define TOKEN_PASTE(x, y) TOKEN_PASTE_SIMPLE(x, y)
-#define TOKEN_STRINGIZE_SIMPLE(x) #x
-#define TOKEN_STRINGIZE(x) TOKEN_STRINGIZE_SIMPLE(x)
+#include "Profiler.hpp"
 
+#include <chrono>
 
+//Prints how long a scope took to std::cerr. Unlike PROFILE_SCOPE it stays in
+//release builds; with the profiler compiled in, the scope is recorded as well.
 class ProfileLogScope {
 public:
     explicit ProfileLogScope(const char* scopeName) noexcept;
@@ -32,5 +29,5 @@ private:
     #undef PROFILE_LOG_SCOPE
     #undef PROFILE_LOG_SCOPE_FUNCTION
 #endif
-#define PROFILE_LOG_SCOPE(tag_str) ProfileLogScope TOKEN_PASTE(plscope_, __LINE__)(tag_str)
-#define PROFILE_LOG_SCOPE_FUNCTION() PROFILE_LOG_SCOPE(__FUNCSIG__)
+#define PROFILE_LOG_SCOPE(tag_str) PROFILE_SCOPE(tag_str); ProfileLogScope TOKEN_PASTE(plscope_, __LINE__)(tag_str)
+#define PROFILE_LOG_SCOPE_FUNCTION() PROFILE_LOG_SCOPE(RTIOW_FUNCTION_SIGNATURE)
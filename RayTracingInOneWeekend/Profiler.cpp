@@ -0,0 +1,216 @@
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+    //A block of events written by one thread. The writer fills a slot and then
+    //publishes it by bumping count with release semantics, so a reader that
+    //loads count with acquire sees complete events without any lock.
+    struct EventChunk {
+        static constexpr std::size_t capacity = 4096;
+        std::array<ProfileEvent, capacity> events{};
+        std::atomic<std::size_t> count{0};
+        std::atomic<EventChunk*> next{nullptr};
+    };
+
+    struct ThreadBuffer {
+        std::uint32_t thread_id{0};
+        std::string name{};
+        std::unique_ptr<EventChunk> head{std::make_unique<EventChunk>()};
+        EventChunk* tail{head.get()};
+        //Chunks after head, owned here and reached by readers through next.
+        std::vector<std::unique_ptr<EventChunk>> more{};
+    };
+
+    //Buffers live until the program exits, so the scopes of threads that have
+    //already finished are still exported.
+    struct BufferRegistry {
+        std::mutex mutex{};
+        std::vector<std::unique_ptr<ThreadBuffer>> buffers{};
+    };
+
+    BufferRegistry& registry() {
+        static BufferRegistry instance{};
+        return instance;
+    }
+
+    struct ThreadState {
+        ThreadBuffer* buffer{nullptr};
+        //Time spent in the closed children of each open scope, innermost last.
+        std::vector<std::int64_t> child_ns{};
+    };
+
+    thread_local ThreadState tl_state{};
+
+    std::atomic<bool> recording{true};
+
+    std::int64_t now_ns() noexcept {
+        static const auto epoch = std::chrono::steady_clock::now();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    //Registering is the only time a recording thread takes the lock.
+    ThreadBuffer& thread_buffer() {
+        if(!tl_state.buffer) {
+            auto& reg = registry();
+            std::scoped_lock lock(reg.mutex);
+            auto buffer = std::make_unique<ThreadBuffer>();
+            buffer->thread_id = static_cast<std::uint32_t>(reg.buffers.size());
+            tl_state.buffer = buffer.get();
+            reg.buffers.emplace_back(std::move(buffer));
+        }
+        return *tl_state.buffer;
+    }
+
+    void record(const ProfileEvent& event) {
+        auto& buffer = thread_buffer();
+        auto* chunk = buffer.tail;
+        auto count = chunk->count.load(std::memory_order_relaxed);
+        if(count == EventChunk::capacity) {
+            buffer.more.emplace_back(std::make_unique<EventChunk>());
+            auto* next = buffer.more.back().get();
+            chunk->next.store(next, std::memory_order_release);
+            buffer.tail = chunk = next;
+            count = 0;
+        }
+        chunk->events[count] = event;
+        chunk->count.store(count + 1, std::memory_order_release);
+    }
+
+    template<typename Fn>
+    void for_each_event(const ThreadBuffer& buffer, Fn&& fn) {
+        for(const auto* chunk = buffer.head.get(); chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            const auto count = chunk->count.load(std::memory_order_acquire);
+            for(std::size_t i = 0; i < count; ++i) {
+                fn(chunk->events[i]);
+            }
+        }
+    }
+
+    void write_json_string(std::ostream& out, const char* text) {
+        out << '"';
+        for(; *text; ++text) {
+            const auto c = *text;
+            if(c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if(static_cast<unsigned char>(c) < 0x20) {
+                out << ' ';
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    }
+
+}
+
+ProfileScope::ProfileScope(const char* scopeName) noexcept
+: _scope_name(scopeName)
+, _recording(recording.load(std::memory_order_relaxed)) {
+    if(_recording) {
+        _start_ns = now_ns();
+        tl_state.child_ns.push_back(0);
+    }
+}
+
+ProfileScope::~ProfileScope() noexcept {
+    if(!_recording) {
+        return;
+    }
+    const auto duration = now_ns() - _start_ns;
+    const auto children = tl_state.child_ns.back();
+    tl_state.child_ns.pop_back();
+    if(!tl_state.child_ns.empty()) {
+        tl_state.child_ns.back() += duration;
+    }
+    record(ProfileEvent{_scope_name, _start_ns, duration, duration - children, static_cast<std::uint32_t>(tl_state.child_ns.size())});
+}
+
+void profiler_set_recording(bool on) noexcept {
+    recording.store(on, std::memory_order_relaxed);
+}
+
+void profiler_set_thread_name(const std::string& name) {
+    auto& buffer = thread_buffer();
+    std::scoped_lock lock(registry().mutex);
+    buffer.name = name;
+}
+
+std::vector<ProfileSummary> profiler_summary() {
+    std::map<std::string, ProfileSummary> by_name{};
+    {
+        auto& reg = registry();
+        std::scoped_lock lock(reg.mutex);
+        for(const auto& buffer : reg.buffers) {
+            for_each_event(*buffer, [&by_name](const ProfileEvent& event) {
+                auto& entry = by_name[event.name];
+                ++entry.count;
+                entry.total_ns += event.duration_ns;
+                entry.self_ns += event.self_ns;
+            });
+        }
+    }
+    std::vector<ProfileSummary> summary{};
+    summary.reserve(by_name.size());
+    for(auto& [name, entry] : by_name) {
+        entry.name = name;
+        summary.emplace_back(std::move(entry));
+    }
+    std::sort(summary.begin(), summary.end(), [](const ProfileSummary& a, const ProfileSummary& b) { return a.total_ns > b.total_ns; });
+    return summary;
+}
+
+void print_profile_summary(std::ostream& out, const std::vector<ProfileSummary>& summary) {
+    out << std::setw(10) << "calls" << std::setw(14) << "total ms" << std::setw(14) << "self ms" << std::setw(14) << "mean us" << "  scope\n";
+    for(const auto& entry : summary) {
+        out << std::setw(10) << entry.count << std::fixed << std::setprecision(3) << std::setw(14) << entry.total_ns * 1e-6
+            << std::setw(14) << entry.self_ns * 1e-6 << std::setw(14) << entry.total_ns * 1e-3 / static_cast<double>(entry.count)
+            << "  " << entry.name << '\n';
+    }
+    out << std::defaultfloat;
+}
+
+bool write_chrome_trace(const std::string& path) {
+    std::ofstream file{path};
+    if(!file) {
+        return false;
+    }
+    file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    file << std::fixed << std::setprecision(3);
+    bool first = true;
+    const auto separator = [&file, &first]() {
+        if(!first) {
+            file << ",\n";
+        }
+        first = false;
+    };
+    auto& reg = registry();
+    std::scoped_lock lock(reg.mutex);
+    for(const auto& buffer : reg.buffers) {
+        if(!buffer->name.empty()) {
+            separator();
+            file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"args\":{\"name\":";
+            write_json_string(file, buffer->name.c_str());
+            file << "}}";
+        }
+        //Complete events; ts and dur are in microseconds.
+        for_each_event(*buffer, [&](const ProfileEvent& event) {
+            separator();
+            file << "{\"name\":";
+            write_json_string(file, event.name);
+            file << ",\"cat\":\"rtiow\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->thread_id << ",\"ts\":" << event.start_ns * 1e-3
+                 << ",\"dur\":" << event.duration_ns * 1e-3 << ",\"args\":{\"self_us\":" << event.self_ns * 1e-3 << ",\"depth\":" << event.depth << "}}";
+        });
+    }
+    file << "\n]}\n";
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#define TOKEN_PASTE_SIMPLE(x, y) x##y
+#define TOKEN_PASTE(x, y) TOKEN_PASTE_SIMPLE(x, y)
+#define TOKEN_STRINGIZE_SIMPLE(x) #x
+#define TOKEN_STRINGIZE(x) TOKEN_STRINGIZE_SIMPLE(x)
+
+//The enclosing function's full signature, as a string literal or static array.
+#if defined(_MSC_VER)
+    #define RTIOW_FUNCTION_SIGNATURE __FUNCSIG__
+#elif defined(__GNUC__) || defined(__clang__)
+    #define RTIOW_FUNCTION_SIGNATURE __PRETTY_FUNCTION__
+#else
+    #define RTIOW_FUNCTION_SIGNATURE __func__
+#endif
+
+//RTIOW_PROFILER 0 compiles every PROFILE_SCOPE away. It defaults to 0 in
+//release builds (NDEBUG) and 1 otherwise; define it to override either way.
+#if !defined(RTIOW_PROFILER)
+    #if defined(NDEBUG)
+        #define RTIOW_PROFILER 0
+    #else
+        #define RTIOW_PROFILER 1
+    #endif
+#endif
+
+//One closed scope. Times are nanoseconds since the profiler's first use; self
+//time is the duration minus the time spent in scopes nested inside it.
+struct ProfileEvent {
+    const char* name{nullptr};
+    std::int64_t start_ns{0};
+    std::int64_t duration_ns{0};
+    std::int64_t self_ns{0};
+    std::uint32_t depth{0};
+};
+
+//Every scope with the same name, over all threads.
+struct ProfileSummary {
+    std::string name{};
+    std::uint64_t count{0};
+    std::int64_t total_ns{0};
+    std::int64_t self_ns{0};
+};
+
+//Times a scope on the calling thread. Each thread appends its closed scopes to
+//its own buffer without taking a lock, so scopes can be placed in render
+//workers; keep them at tile granularity or coarser, a scope costs two clock reads.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* scopeName) noexcept;
+    ~ProfileScope() noexcept;
+
+    ProfileScope() = delete;
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope(ProfileScope&&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+    ProfileScope& operator=(ProfileScope&&) = delete;
+
+protected:
+private:
+    const char* _scope_name = nullptr;
+    std::int64_t _start_ns{0};
+    bool _recording{false};
+};
+
+//Turns recording on or off, on every thread, for the scopes opened from now on.
+//On by default. Recorded scopes are kept until the process exits, so a process
+//that runs indefinitely and never exports them should turn it off.
+void profiler_set_recording(bool recording) noexcept;
+
+//Names the calling thread in exported traces.
+void profiler_set_thread_name(const std::string& name);
+
+//Aggregates the scopes recorded so far by name, longest total time first.
+//Safe to call while other threads are still recording.
+std::vector<ProfileSummary> profiler_summary();
+
+void print_profile_summary(std::ostream& out, const std::vector<ProfileSummary>& summary);
+
+//Writes every scope recorded so far as Chrome trace_event JSON, which
+//chrome://tracing and Perfetto open directly. Returns false if the write failed.
+bool write_chrome_trace(const std::string& path);
+
+#if defined PROFILE_SCOPE || defined PROFILE_SCOPE_FUNCTION || defined PROFILE_THREAD_NAME
+    #undef PROFILE_SCOPE
+    #undef PROFILE_SCOPE_FUNCTION
+    #undef PROFILE_THREAD_NAME
+#endif
+#if RTIOW_PROFILER
+    #define PROFILE_SCOPE(tag_str) ProfileScope TOKEN_PASTE(pscope_, __LINE__)(tag_str)
+    #define PROFILE_SCOPE_FUNCTION() PROFILE_SCOPE(RTIOW_FUNCTION_SIGNATURE)
+    #define PROFILE_THREAD_NAME(name) profiler_set_thread_name(name)
+#else
+    #define PROFILE_SCOPE(tag_str) static_cast<void>(0)
+    #define PROFILE_SCOPE_FUNCTION() static_cast<void>(0)
+    #define PROFILE_THREAD_NAME(name) static_cast<void>(0)
+#endif
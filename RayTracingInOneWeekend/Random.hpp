@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+//PCG32 (XSH-RR) generator: 16 bytes of state, a couple of cycles per number.
+//See https://www.pcg-random.org/
+class Pcg32 {
+public:
+    Pcg32() = default;
+    Pcg32(const Pcg32& other) = default;
+    Pcg32(Pcg32&& other) = default;
+    Pcg32& operator=(const Pcg32& other) = default;
+    Pcg32& operator=(Pcg32&& other) = default;
+    ~Pcg32() = default;
+
+    Pcg32(std::uint64_t seed, std::uint64_t stream) noexcept : state{0u}, increment{(stream << 1u) | 1u} {
+        next_uint();
+        state += seed;
+        next_uint();
+    }
+
+    std::uint32_t next_uint() noexcept {
+        const auto old_state = state;
+        state = old_state * 6364136223846793005ull + increment;
+        const auto xorshifted = static_cast<std::uint32_t>(((old_state >> 18u) ^ old_state) >> 27u);
+        const auto rotation = static_cast<std::uint32_t>(old_state >> 59u);
+        return (xorshifted >> rotation) | (xorshifted << ((32u - rotation) & 31u));
+    }
+
+    //Uniform in [0, 1) using the top 24 bits, so every value is exactly representable.
+    float next_float() noexcept {
+        return static_cast<float>(next_uint() >> 8u) * 0x1.0p-24f;
+    }
+
+    std::uint64_t state{0x853c49e6748fea9bull};
+    std::uint64_t increment{0xda3e39cb94b95bdbull};
+protected:
+private:
+};
+
+//SplitMix64 finalizer; decorrelates nearby integer keys.
+constexpr std::uint64_t mix_bits(std::uint64_t v) noexcept {
+    v ^= v >> 30u;
+    v *= 0xbf58476d1ce4e5b9ull;
+    v ^= v >> 27u;
+    v *= 0x94d049bb133111ebull;
+    v ^= v >> 31u;
+    return v;
+}
+
+//Identifies one path through the image. Every random number the path consumes
+//is derived from this key, so the result does not depend on which thread or
+//tile order rendered it.
+constexpr std::uint64_t make_path_key(std::uint64_t seed, std::uint64_t pixel_index, std::uint64_t sample_index) noexcept {
+    return mix_bits(mix_bits(seed ^ mix_bits(pixel_index)) ^ sample_index);
+}
+
+//The generator behind random_float() on the calling thread.
+inline Pcg32& thread_rng() noexcept {
+    static thread_local Pcg32 rng{};
+    return rng;
+}
+
+//Restarts the calling thread's generator for one bounce of the path.
+inline void seed_thread_rng(std::uint64_t path_key, std::uint32_t bounce) noexcept {
+    thread_rng() = Pcg32{mix_bits(path_key + bounce), path_key};
+}
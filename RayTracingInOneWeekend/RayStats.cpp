@@ -0,0 +1,90 @@
+#include "RayStats.hpp"
+
+#include <iomanip>
+#include <numeric>
+
+namespace {
+
+    double ratio(std::uint64_t numerator, std::uint64_t denominator) {
+        return denominator ? static_cast<double>(numerator) / static_cast<double>(denominator) : 0.0;
+    }
+
+    //The deepest bounce with any rays, so reports stop where the paths did.
+    std::size_t used_bounce_bins(const RayStats& stats) {
+        auto used = stats.secondary_rays.size();
+        while(used > 0 && stats.secondary_rays[used - 1] == 0) {
+            --used;
+        }
+        return used;
+    }
+
+}
+
+std::uint64_t RayStats::secondary_ray_count() const noexcept {
+    return std::accumulate(secondary_rays.begin(), secondary_rays.end(), std::uint64_t{0});
+}
+
+std::uint64_t RayStats::ray_count() const noexcept {
+    return camera_rays + secondary_ray_count();
+}
+
+RayStats& RayStats::operator+=(const RayStats& rhs) noexcept {
+    camera_rays += rhs.camera_rays;
+    for(std::size_t i = 0; i < secondary_rays.size(); ++i) {
+        secondary_rays[i] += rhs.secondary_rays[i];
+    }
+    primitive_tests += rhs.primitive_tests;
+    primitive_hits += rhs.primitive_hits;
+    max_depth_terminations += rhs.max_depth_terminations;
+    roulette_terminations += rhs.roulette_terminations;
+    absorbed += rhs.absorbed;
+    sky_misses += rhs.sky_misses;
+    return *this;
+}
+
+void print_ray_stats(std::ostream& out, const RayStats& stats, double seconds) {
+    const auto rays = stats.ray_count();
+    const auto paths = stats.max_depth_terminations + stats.roulette_terminations + stats.absorbed + stats.sky_misses;
+    out << std::fixed << std::setprecision(2)
+        << "Rays: " << rays << " (" << stats.camera_rays << " camera, " << stats.secondary_ray_count() << " secondary), "
+        << ratio(rays, stats.camera_rays) << " per camera ray, " << rays / seconds * 1e-6 << " Mrays/s\n"
+        << "Primitive tests: " << stats.primitive_tests << ", " << ratio(stats.primitive_tests, rays) << " per ray, "
+        << 100.0 * ratio(stats.primitive_hits, stats.primitive_tests) << "% hit\n"
+        << "Paths ended: " << 100.0 * ratio(stats.sky_misses, paths) << "% sky, " << 100.0 * ratio(stats.absorbed, paths) << "% absorbed, "
+        << 100.0 * ratio(stats.max_depth_terminations, paths) << "% at max_depth, " << 100.0 * ratio(stats.roulette_terminations, paths) << "% by roulette\n"
+        << "Rays per bounce:";
+    out << " 0:" << stats.camera_rays;
+    const auto used = used_bounce_bins(stats);
+    for(std::size_t i = 0; i < used; ++i) {
+        out << ' ' << i + 1 << (i + 1 == stats.secondary_rays.size() ? "+:" : ":") << stats.secondary_rays[i];
+    }
+    out << '\n' << std::defaultfloat;
+}
+
+void write_ray_stats_json(std::ostream& out, const RayStats& stats, double seconds, const std::vector<std::pair<std::string, std::string>>& context) {
+    const auto rays = stats.ray_count();
+    out << "{\n  \"context\": {";
+    for(std::size_t i = 0; i < context.size(); ++i) {
+        out << (i ? ", " : "") << '"' << context[i].first << "\": \"" << context[i].second << '"';
+    }
+    out << "},\n"
+        << std::setprecision(6) << std::fixed
+        << "  \"seconds\": " << seconds << ",\n"
+        << "  \"mrays_per_second\": " << rays / seconds * 1e-6 << ",\n"
+        << std::defaultfloat
+        << "  \"rays\": " << rays << ",\n"
+        << "  \"camera_rays\": " << stats.camera_rays << ",\n"
+        << "  \"secondary_rays_per_bounce\": [";
+    const auto used = used_bounce_bins(stats);
+    for(std::size_t i = 0; i < used; ++i) {
+        out << (i ? ", " : "") << stats.secondary_rays[i];
+    }
+    out << "],\n"
+        << "  \"primitive_tests\": " << stats.primitive_tests << ",\n"
+        << "  \"primitive_hits\": " << stats.primitive_hits << ",\n"
+        << "  \"max_depth_terminations\": " << stats.max_depth_terminations << ",\n"
+        << "  \"roulette_terminations\": " << stats.roulette_terminations << ",\n"
+        << "  \"absorbed\": " << stats.absorbed << ",\n"
+        << "  \"sky_misses\": " << stats.sky_misses << "\n"
+        << "}\n";
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+//RTIOW_RAY_STATS 0 compiles every RAY_STATS counter away.
+#if !defined(RTIOW_RAY_STATS)
+    #define RTIOW_RAY_STATS 1
+#endif
+
+//Secondary rays are counted per bounce up to this one; deeper bounces share the last bin.
+constexpr int ray_stats_max_bounce = 32;
+
+//Where the work of a render goes. Every render thread counts into its own
+//copy, see thread_ray_stats(), and render() adds them up when it finishes.
+struct RayStats {
+    std::uint64_t camera_rays{0};
+    //secondary_rays[b - 1] is the number of rays traced after b bounces.
+    std::array<std::uint64_t, ray_stats_max_bounce> secondary_rays{};
+    std::uint64_t primitive_tests{0};
+    std::uint64_t primitive_hits{0};
+    //How paths end: scattered past max_depth, ended by Russian roulette,
+    //absorbed by a material, or escaped to the sky.
+    std::uint64_t max_depth_terminations{0};
+    std::uint64_t roulette_terminations{0};
+    std::uint64_t absorbed{0};
+    std::uint64_t sky_misses{0};
+
+    std::uint64_t secondary_ray_count() const noexcept;
+    std::uint64_t ray_count() const noexcept;
+
+    //Rays traced after the given number of bounces; 0 for camera rays.
+    void count_rays(int bounce, std::uint64_t count = 1) noexcept {
+        if(bounce == 0) {
+            camera_rays += count;
+        } else {
+            secondary_rays[static_cast<std::size_t>((bounce < ray_stats_max_bounce ? bounce : ray_stats_max_bounce) - 1)] += count;
+        }
+    }
+
+    RayStats& operator+=(const RayStats& rhs) noexcept;
+};
+
+//The calling thread's counters. Plain, unsynchronized integers: only read
+//them from another thread once the counting thread has been joined or has
+//handed them over through a lock, as render() does.
+inline constinit thread_local RayStats tl_ray_stats{};
+
+inline RayStats& thread_ray_stats() noexcept {
+    return tl_ray_stats;
+}
+
+#if defined RAY_STATS
+    #undef RAY_STATS
+#endif
+#if RTIOW_RAY_STATS
+    #define RAY_STATS(statement) statement
+#else
+    #define RAY_STATS(statement) static_cast<void>(0)
+#endif
+
+//Counts, rates and the bounce histogram, with throughput over seconds.
+void print_ray_stats(std::ostream& out, const RayStats& stats, double seconds);
+
+//The same numbers as JSON, with context naming what they were measured on
+//(threads, SIMD kernels, render settings) as string members of "context".
+void write_ray_stats_json(std::ostream& out, const RayStats& stats, double seconds, const std::vector<std::pair<std::string, std::string>>& context);
@@ -0,0 +1,468 @@
+#include "RenderOptions.hpp"
+
+#include "ImageEncoders.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace {
+
+    int to_int(std::string_view name, const std::string& value) {
+        std::size_t parsed = 0;
+        const auto result = [&]() {
+            try {
+                return std::stoll(value, &parsed);
+            } catch(const std::exception&) {
+                throw std::invalid_argument("Invalid value '" + value + "' for " + std::string(name));
+            }
+        }();
+        if(parsed != value.size() || result < (std::numeric_limits<int>::min)() || result > (std::numeric_limits<int>::max)()) {
+            throw std::invalid_argument("Invalid value '" + value + "' for " + std::string(name));
+        }
+        return static_cast<int>(result);
+    }
+
+    //Any 64-bit unsigned value; std::stoull alone would wrap a leading minus
+    //sign around instead of rejecting it.
+    std::uint64_t to_uint64(std::string_view name, const std::string& value) {
+        std::size_t parsed = 0;
+        const auto result = [&]() {
+            try {
+                return std::stoull(value, &parsed);
+            } catch(const std::exception&) {
+                throw std::invalid_argument("Invalid value '" + value + "' for " + std::string(name));
+            }
+        }();
+        if(parsed != value.size() || value.find('-') != std::string::npos) {
+            throw std::invalid_argument("Invalid value '" + value + "' for " + std::string(name));
+        }
+        return result;
+    }
+
+    int to_positive_int(std::string_view name, const std::string& value) {
+        const auto result = to_int(name, value);
+        if(result <= 0) {
+            throw std::invalid_argument(std::string(name) + " must be greater than zero");
+        }
+        return result;
+    }
+
+    float to_float(std::string_view name, const std::string& value) {
+        std::size_t parsed = 0;
+        const auto result = [&]() {
+            try {
+                return std::stof(value, &parsed);
+            } catch(const std::exception&) {
+                throw std::invalid_argument("Invalid value '" + value + "' for " + std::string(name));
+            }
+        }();
+        if(parsed != value.size()) {
+            throw std::invalid_argument("Invalid value '" + value + "' for " + std::string(name));
+        }
+        return result;
+    }
+
+    float to_positive_float(std::string_view name, const std::string& value) {
+        const auto result = to_float(name, value);
+        if(!(result > 0.0f)) {
+            throw std::invalid_argument(std::string(name) + " must be greater than zero");
+        }
+        return result;
+    }
+
+    //"a-b" or a single "a", both ends inclusive.
+    std::pair<int, int> to_range(std::string_view name, const std::string& value) {
+        const auto dash = value.find('-');
+        const auto first = to_int(name, value.substr(0, dash));
+        const auto last = dash == std::string::npos ? first : to_int(name, value.substr(dash + 1));
+        if(first < 0 || last < first) {
+            throw std::invalid_argument("Invalid range '" + value + "' for " + std::string(name));
+        }
+        return {first, last};
+    }
+
+    RenderOptions parse_merge_command_line(int argc, char** argv) {
+        RenderOptions options{};
+        options.mode = RunMode::Merge;
+        for(int i = 2; i < argc; ++i) {
+            const auto arg = std::string_view{argv[i]};
+            if(arg == "--output") {
+                if(i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for --output");
+                }
+                auto path = std::string{argv[++i]};
+                image_format_from_path(path); //Reject unknown extensions before reading anything.
+                options.output_paths.emplace_back(std::move(path));
+            } else if(arg.starts_with("--")) {
+                throw std::invalid_argument("Unknown merge option " + std::string(arg));
+            } else {
+                options.merge_inputs.emplace_back(arg);
+            }
+        }
+        if(options.merge_inputs.empty()) {
+            throw std::invalid_argument("merge needs at least one partial file");
+        }
+        if(options.output_paths.empty()) {
+            options.output_paths.emplace_back("image_binary.ppm");
+        }
+        return options;
+    }
+
+    RenderOptions parse_compile_command_line(int argc, char** argv) {
+        RenderOptions options{};
+        options.mode = RunMode::Compile;
+        std::vector<std::string> paths{};
+        for(int i = 2; i < argc; ++i) {
+            const auto arg = std::string_view{argv[i]};
+            if(arg == "--no-bvh") {
+                options.compile_bvh = false;
+            } else if(arg.starts_with("--")) {
+                throw std::invalid_argument("Unknown compile option " + std::string(arg));
+            } else {
+                paths.emplace_back(arg);
+            }
+        }
+        if(paths.size() != 2) {
+            throw std::invalid_argument("compile needs an input scene and an output file");
+        }
+        options.compile_input = std::move(paths[0]);
+        options.compile_output = std::move(paths[1]);
+        return options;
+    }
+
+    RenderOptions parse_serve_command_line(int argc, char** argv) {
+        RenderOptions options{};
+        options.mode = RunMode::Serve;
+        for(int i = 2; i < argc; ++i) {
+            const auto arg = std::string_view{argv[i]};
+            const auto next_value = [&]() -> std::string {
+                if(i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for " + std::string(arg));
+                }
+                return argv[++i];
+            };
+            if(arg == "--threads") {
+                options.thread_count = static_cast<unsigned int>(to_positive_int(arg, next_value()));
+            } else if(arg == "--cache") {
+                options.scene_cache_size = static_cast<std::size_t>(to_positive_int(arg, next_value()));
+            } else if(arg == "--profile") {
+                options.profile_path = next_value();
+            } else if(arg.starts_with("--")) {
+                throw std::invalid_argument("Unknown serve option " + std::string(arg));
+            } else if(options.socket_path.empty()) {
+                options.socket_path = arg;
+            } else {
+                throw std::invalid_argument("Unexpected argument " + std::string(arg));
+            }
+        }
+        if(options.socket_path.empty()) {
+            throw std::invalid_argument("serve needs the socket to listen on");
+        }
+        return options;
+    }
+
+    RenderOptions parse_submit_command_line(int argc, char** argv) {
+        RenderOptions options{};
+        options.mode = RunMode::Submit;
+        bool height_given = false;
+        int positional = 0;
+        for(int i = 2; i < argc; ++i) {
+            const auto arg = std::string_view{argv[i]};
+            const auto next_value = [&]() -> std::string {
+                if(i + 1 >= argc) {
+                    throw std::invalid_argument("Missing value for " + std::string(arg));
+                }
+                return argv[++i];
+            };
+            const auto next_point = [&]() {
+                const auto x = to_float(arg, next_value());
+                const auto y = to_float(arg, next_value());
+                const auto z = to_float(arg, next_value());
+                return Point3{x, y, z};
+            };
+            if(arg == "--scene") {
+                options.scene_path = next_value();
+            } else if(arg == "--seed") {
+                options.seed = to_uint64(arg, next_value());
+            } else if(arg == "--priority") {
+                options.priority = to_int(arg, next_value());
+            } else if(arg == "--look-from") {
+                options.look_from = next_point();
+            } else if(arg == "--look-at") {
+                options.look_at = next_point();
+            } else if(arg == "--output") {
+                if(!options.output_paths.empty()) {
+                    throw std::invalid_argument("submit writes one --output");
+                }
+                auto path = next_value();
+                image_format_from_path(path); //Reject unknown extensions before sending anything.
+                options.output_paths.emplace_back(std::move(path));
+            } else if(arg == "--stop") {
+                options.stop_server = true;
+            } else if(arg.starts_with("--")) {
+                throw std::invalid_argument("Unknown submit option " + std::string(arg));
+            } else if(options.socket_path.empty()) {
+                options.socket_path = arg;
+            } else {
+                switch(positional++) {
+                case 0: options.image_width = to_positive_int("width", argv[i]); break;
+                case 1: options.image_height = to_positive_int("height", argv[i]); height_given = true; break;
+                case 2: options.samples_per_pixel = to_positive_int("samples_per_pixel", argv[i]); break;
+                case 3: options.max_depth = to_positive_int("max_depth", argv[i]); break;
+                default: throw std::invalid_argument("Unexpected argument " + std::string(arg));
+                }
+            }
+        }
+        if(options.socket_path.empty()) {
+            throw std::invalid_argument("submit needs the server's socket");
+        }
+        if(!height_given) {
+            options.image_height = (std::max)(1, static_cast<int>(options.image_width / options.aspect_ratio));
+        }
+        if(options.output_paths.empty()) {
+            options.output_paths.emplace_back("image_binary.ppm");
+        }
+        return options;
+    }
+
+}
+
+RenderOptions parse_command_line(int argc, char** argv) {
+    if(argc > 1 && std::string_view{argv[1]} == "merge") {
+        return parse_merge_command_line(argc, argv);
+    }
+    if(argc > 1 && std::string_view{argv[1]} == "compile") {
+        return parse_compile_command_line(argc, argv);
+    }
+    if(argc > 1 && std::string_view{argv[1]} == "serve") {
+        return parse_serve_command_line(argc, argv);
+    }
+    if(argc > 1 && std::string_view{argv[1]} == "submit") {
+        return parse_submit_command_line(argc, argv);
+    }
+    RenderOptions options{};
+    std::optional<std::pair<int, int>> sample_range{};
+    bool height_given = false;
+    int positional = 0;
+    for(int i = 1; i < argc; ++i) {
+        const auto arg = std::string_view{argv[i]};
+        const auto next_value = [&]() -> std::string {
+            if(i + 1 >= argc) {
+                throw std::invalid_argument("Missing value for " + std::string(arg));
+            }
+            return argv[++i];
+        };
+        if(arg.starts_with("--")) {
+            if(arg == "--threads") {
+                options.thread_count = static_cast<unsigned int>(to_positive_int(arg, next_value()));
+            } else if(arg == "--tile-size") {
+                options.tile_size = to_positive_int(arg, next_value());
+            } else if(arg == "--seed") {
+                options.seed = to_uint64(arg, next_value());
+            } else if(arg == "--no-bvh") {
+                options.use_bvh = false;
+            } else if(arg == "--no-sphere-batch") {
+                options.use_sphere_batch = false;
+            } else if(arg == "--integrator") {
+                const auto name = next_value();
+                if(name == "recursive") {
+                    options.integrator = Integrator::Recursive;
+                } else if(name == "wavefront") {
+                    options.integrator = Integrator::Wavefront;
+                } else {
+                    throw std::invalid_argument("Unknown integrator '" + name + "', expected recursive or wavefront");
+                }
+            } else if(arg == "--dispatch") {
+                const auto name = next_value();
+                if(name == "virtual") {
+                    options.dispatch = Dispatch::Virtual;
+                } else if(name == "static") {
+                    options.dispatch = Dispatch::Static;
+                } else {
+                    throw std::invalid_argument("Unknown dispatch '" + name + "', expected virtual or static");
+                }
+            } else if(arg == "--bvh-stats") {
+                options.report_bvh_traversal = true;
+            } else if(arg == "--adaptive") {
+                options.adaptive = true;
+            } else if(arg == "--min-spp") {
+                options.min_samples_per_pixel = to_positive_int(arg, next_value());
+            } else if(arg == "--max-spp") {
+                options.samples_per_pixel = to_positive_int(arg, next_value());
+            } else if(arg == "--error-threshold") {
+                options.error_threshold = to_positive_float(arg, next_value());
+            } else if(arg == "--roulette") {
+                options.roulette_min_depth = to_positive_int(arg, next_value());
+            } else if(arg == "--sampler") {
+                const auto name = next_value();
+                if(name == "independent") {
+                    options.sampler = SamplerType::Independent;
+                } else if(name == "stratified") {
+                    options.sampler = SamplerType::Stratified;
+                } else if(name == "sobol") {
+                    options.sampler = SamplerType::Sobol;
+                } else if(name == "blue-noise") {
+                    options.sampler = SamplerType::BlueNoise;
+                } else {
+                    throw std::invalid_argument("Unknown sampler '" + name + "', expected independent, stratified, sobol or blue-noise");
+                }
+            } else if(arg == "--fast-math") {
+                options.fast_math = true;
+            } else if(arg == "--denoise") {
+                options.denoise = true;
+            } else if(arg == "--aov") {
+                options.aov_prefix = next_value();
+            } else if(arg == "--output") {
+                auto path = next_value();
+                image_format_from_path(path); //Reject unknown extensions before rendering.
+                options.output_paths.emplace_back(std::move(path));
+            } else if(arg == "--checkpoint") {
+                options.checkpoint_path = next_value();
+            } else if(arg == "--checkpoint-interval") {
+                options.checkpoint_interval_seconds = to_positive_int(arg, next_value());
+            } else if(arg == "--resume") {
+                options.resume = true;
+            } else if(arg == "--tiles") {
+                std::tie(options.first_tile, options.last_tile) = to_range(arg, next_value());
+            } else if(arg == "--samples") {
+                sample_range = to_range(arg, next_value());
+            } else if(arg == "--profile") {
+                options.profile_path = next_value();
+            } else if(arg == "--stats") {
+                options.report_ray_stats = true;
+            } else if(arg == "--stats-json") {
+                options.ray_stats_json_path = next_value();
+            } else if(arg == "--scene") {
+                options.scene_path = next_value();
+            } else if(arg == "--frames") {
+                options.frame_count = to_positive_int(arg, next_value());
+            } else if(arg == "--bvh-update") {
+                const auto name = next_value();
+                if(name == "refit") {
+                    options.bvh_update = BvhUpdate::Refit;
+                } else if(name == "rebuild") {
+                    options.bvh_update = BvhUpdate::Rebuild;
+                } else {
+                    throw std::invalid_argument("Unknown BVH update '" + name + "', expected refit or rebuild");
+                }
+            } else if(arg == "--moving-spheres") {
+                options.moving_spheres = true;
+            } else if(arg == "--preview") {
+                options.preview_path = next_value();
+            } else if(arg == "--preview-fps") {
+                options.preview_fps = to_positive_float(arg, next_value());
+            } else if(arg == "--preview-lowres") {
+                options.preview_lowres = to_positive_int(arg, next_value());
+            } else if(arg == "--seed-offset") {
+                options.seed_offset = to_uint64(arg, next_value());
+            } else {
+                throw std::invalid_argument("Unknown option " + std::string(arg));
+            }
+            continue;
+        }
+        switch(positional++) {
+        case 0: options.image_width = to_positive_int("width", argv[i]); break;
+        case 1: options.image_height = to_positive_int("height", argv[i]); height_given = true; break;
+        case 2: options.samples_per_pixel = to_positive_int("samples_per_pixel", argv[i]); break;
+        case 3: options.max_depth = to_positive_int("max_depth", argv[i]); break;
+        default: throw std::invalid_argument("Unexpected argument " + std::string(arg));
+        }
+    }
+    if(height_given) {
+        options.aspect_ratio = options.image_width / static_cast<float>(options.image_height);
+    } else {
+        options.image_height = static_cast<int>(options.image_width / options.aspect_ratio);
+    }
+    if(sample_range) {
+        if(options.adaptive) {
+            throw std::invalid_argument("--adaptive cannot be combined with --samples: a pixel's error is only known to the process that has all its samples");
+        }
+        options.first_sample = sample_range->first;
+        options.samples_per_pixel = sample_range->second - sample_range->first + 1;
+    }
+    if(options.frame_count > 1 && (!options.checkpoint_path.empty() || options.first_tile > 0 || options.last_tile >= 0 || sample_range)) {
+        throw std::invalid_argument("--frames cannot be combined with --checkpoint, --tiles or --samples");
+    }
+    if(!options.preview_path.empty()) {
+        if(options.frame_count > 1 || !options.checkpoint_path.empty() || options.first_tile > 0 || options.last_tile >= 0 || sample_range || options.adaptive) {
+            throw std::invalid_argument("--preview cannot be combined with --frames, --checkpoint, --tiles, --samples or --adaptive");
+        }
+        if(options.sampler == SamplerType::Stratified || options.sampler == SamplerType::BlueNoise) {
+            throw std::invalid_argument("--preview needs --sampler independent or sobol: the others lay out all of a pixel's samples at once");
+        }
+    }
+    if(options.resume && options.checkpoint_path.empty()) {
+        throw std::invalid_argument("--resume needs the --checkpoint file to resume from");
+    }
+    if(options.output_paths.empty()) {
+        options.output_paths.emplace_back("image_binary.ppm");
+    }
+    if(options.adaptive && options.min_samples_per_pixel > options.samples_per_pixel) {
+        throw std::invalid_argument("--min-spp must not exceed the maximum samples per pixel");
+    }
+    return options;
+}
+
+void print_usage(std::ostream& out, const char* program_name) {
+    out << "Usage: " << program_name << " [width [height [samples_per_pixel [max_depth]]]] [options]\n"
+        << "Options:\n"
+        << "  --scene FILE     Render a text or compiled scene instead of the random cover scene\n"
+        << "  --threads N      Number of render threads (default: hardware concurrency)\n"
+        << "  --tile-size N    Edge length in pixels of a render tile (default: 16)\n"
+        << "  --seed N         Seed for the per-sample random sequences (default: 0)\n"
+        << "  --integrator NAME  recursive (default) or wavefront\n"
+        << "  --dispatch NAME  virtual (default) or static: spheres and material kernels bound at compile time\n"
+        << "  --no-bvh         Test every object for every ray instead of using a BVH\n"
+        << "  --no-sphere-batch  Intersect spheres one at a time instead of in SIMD batches\n"
+        << "  --bvh-stats      Report BVH node visits and primitive tests per ray\n"
+        << "  --adaptive       Stop sampling a pixel once its error is below the threshold\n"
+        << "  --min-spp N      Samples every pixel takes before the first test (default: 16)\n"
+        << "  --max-spp N      Sample budget per pixel; same as samples_per_pixel\n"
+        << "  --error-threshold X  95% confidence half-width in output units (default: 0.01)\n"
+        << "  --roulette N     Russian roulette: end dim paths at random once they have traced N rays\n"
+        << "  --sampler NAME   independent (default), stratified, sobol or blue-noise\n"
+        << "  --fast-math      Shade with the rsqrt and polynomial kernels; the image differs by float rounding\n"
+        << "  --denoise        Filter the image with an edge-aware a-trous denoiser guided by the AOVs\n"
+        << "  --aov PREFIX     Write the albedo, normal and depth AOVs to PREFIX_albedo.pfm, PREFIX_normal.pfm and PREFIX_depth.pfm\n"
+        << "  --output FILE    Write the image to FILE, .ppm, .pfm or .png; repeatable (default: image_binary.ppm)\n"
+        << "  --checkpoint FILE  Append finished tiles to FILE so the render can be resumed\n"
+        << "  --checkpoint-interval S  Seconds between checkpoint writes (default: 30)\n"
+        << "  --resume         Continue the render saved in the --checkpoint file\n"
+        << "  --tiles A-B      Render only tiles A through B (row-major, tile-size squares)\n"
+        << "  --samples A-B    Take samples A through B of every pixel\n"
+        << "  --seed-offset N  Added to the seed, for statistically independent partial renders\n"
+        << "  --profile FILE   Write a Chrome trace of the profiled scopes to FILE and print their totals\n"
+        << "  --stats          Report rays per bounce, primitive tests and how paths ended\n"
+        << "  --stats-json FILE  Write those counters and the Mrays/s to FILE as JSON\n"
+        << "  --frames N       Render N frames along the scene's keyframes (an orbit if it has none), numbering the outputs\n"
+        << "  --bvh-update NAME  refit (default) or rebuild the BVH when spheres move between frames\n"
+        << "  --moving-spheres Raise the small spheres of the cover scene over the frames\n"
+        << "  --preview FILE   Render one sample per pixel at a time and stream the image as PPM frames to FILE or a named pipe, - for stdout\n"
+        << "  --preview-fps X  Most preview frames per second (default: 4)\n"
+        << "  --preview-lowres N  Stream a one-sample pass at 1/N of the resolution first\n"
+        << "Merging partial renders written with --checkpoint:\n"
+        << "  " << program_name << " merge [--output FILE]... PARTIAL...\n"
+        << "Converting a scene (INPUT may be 'random'; OUTPUT ending in .rtsc is compiled, anything else is text):\n"
+        << "  " << program_name << " compile [--no-bvh] INPUT OUTPUT\n"
+        << "Serving render jobs on a Unix domain socket, keeping built scenes in memory:\n"
+        << "  " << program_name << " serve SOCKET [--threads N] [--cache N] [--profile FILE]\n"
+        << "  " << program_name << " submit SOCKET [width [height [samples_per_pixel [max_depth]]]] [--scene FILE] [--seed N]\n"
+        << "      [--priority N] [--look-from X Y Z] [--look-at X Y Z] [--output FILE]\n"
+        << "  " << program_name << " submit SOCKET --stop\n";
+}
+
+std::ostream& operator<<(std::ostream& out, Dispatch dispatch) {
+    switch(dispatch) {
+    case Dispatch::Virtual: return out << "virtual";
+    case Dispatch::Static: return out << "static";
+    default: return out << "unknown";
+    }
+}
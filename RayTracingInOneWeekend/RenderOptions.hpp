@@ -0,0 +1,103 @@
+#pragma once
+
+#include "Animation.hpp"
+#include "Renderer.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+enum class RunMode {
+    Render
+    ,Merge  //Combine partial accumulation files into one image.
+    ,Compile  //Convert a scene to the text or compiled format.
+    ,Serve  //Render jobs sent over a Unix domain socket, see RenderServer.
+    ,Submit  //Send one job to a server and write the image it returns.
+};
+
+//How the renderer reaches primitives and materials.
+enum class Dispatch {
+    Virtual  //Hittable::hit and Material::scatter, for any scene.
+    ,Static  //A StaticSphereScene and the material kernels, see StaticScene.hpp.
+};
+
+struct RenderOptions {
+    RunMode mode{RunMode::Render};
+    int image_width{400};
+    int image_height{266};
+    float aspect_ratio{3.0f / 2.0f};
+    int samples_per_pixel{100};
+    int max_depth{50};
+    unsigned int thread_count{0};
+    int tile_size{16};
+    std::uint64_t seed{0};
+    bool use_bvh{true};
+    bool use_sphere_batch{true};
+    bool report_bvh_traversal{false};
+    Integrator integrator{Integrator::Recursive};
+    Dispatch dispatch{Dispatch::Virtual};
+    bool adaptive{false};
+    int min_samples_per_pixel{16};
+    float error_threshold{0.01f};
+    int roulette_min_depth{0};
+    SamplerType sampler{SamplerType::Independent};
+    bool fast_math{false};
+    bool denoise{false};
+    //Write the albedo, normal and depth AOVs to PREFIX_albedo.pfm and so on.
+    std::string aov_prefix{};
+    std::vector<std::string> output_paths{};
+    std::string checkpoint_path{};
+    int checkpoint_interval_seconds{30};
+    bool resume{false};
+    //Part of a render split across processes: tiles [first_tile, last_tile] in
+    //make_tiles order (-1: through the last one), samples [first_sample,
+    //first_sample + samples_per_pixel), and an offset added to the seed.
+    int first_tile{0};
+    int last_tile{-1};
+    int first_sample{0};
+    std::uint64_t seed_offset{0};
+    std::vector<std::string> merge_inputs{};
+    std::string profile_path{};
+    bool report_ray_stats{false};
+    std::string ray_stats_json_path{};
+    //Empty: render random_scene.
+    std::string scene_path{};
+    //More than 1: render a sequence along the scene's keyframes, see render_sequence.
+    int frame_count{1};
+    BvhUpdate bvh_update{BvhUpdate::Refit};
+    //Move the spheres of radius 0.2 over the sequence, see cover_scene_motions.
+    bool moving_spheres{false};
+    //Non-empty: render one-sample passes and stream the running image to this
+    //file, "-" for stdout, see render_progressive.
+    std::string preview_path{};
+    float preview_fps{4.0f};
+    //More than 1: start with a one-sample pass at 1/preview_lowres of the resolution.
+    int preview_lowres{0};
+    //Compile mode: "random" or a scene file, and the file to write.
+    std::string compile_input{};
+    std::string compile_output{};
+    bool compile_bvh{true};
+    //Serve and submit modes: the server's socket. Submit sends the render
+    //options above that a RenderJob has, and the ones below.
+    std::string socket_path{};
+    std::size_t scene_cache_size{8};
+    int priority{0};
+    std::optional<Point3> look_from{};
+    std::optional<Point3> look_at{};
+    bool stop_server{false};
+};
+
+//Parses `[width [height [samples_per_pixel [max_depth]]]] [--option value]...`
+//or `merge [--output FILE]... PARTIAL...`
+//or `compile [--no-bvh] INPUT OUTPUT`
+//or `serve SOCKET [--threads N] [--cache N] [--profile FILE]`
+//or `submit SOCKET [width [height [samples_per_pixel [max_depth]]]] [--option value]...`.
+//Throws std::invalid_argument on unknown options or malformed values.
+RenderOptions parse_command_line(int argc, char** argv);
+
+void print_usage(std::ostream& out, const char* program_name);
+
+std::ostream& operator<<(std::ostream& out, Dispatch dispatch);
@@ -0,0 +1,731 @@
+#include "RenderServer.hpp"
+
+#include "Bvh.hpp"
+#include "Camera.hpp"
+#include "Framebuffer.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "Renderer.hpp"
+#include "SceneFile.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <WinSock2.h>
+    #include <afunix.h>
+    #pragma comment(lib, "Ws2_32.lib")
+#else
+    #include <cerrno>
+    #include <poll.h>
+    #include <sys/socket.h>
+    #include <sys/time.h>
+    #include <sys/un.h>
+    #include <unistd.h>
+#endif
+
+namespace {
+
+    constexpr std::intptr_t no_socket = -1;
+    //Longest request the listener reads before giving up on a client.
+    constexpr std::size_t max_request_bytes = 64 * 1024;
+    //How long a client may take, from accept, to send its whole request.
+    constexpr auto request_timeout = std::chrono::seconds{2};
+    //How long a client may take to read its reply.
+    constexpr int io_timeout_seconds = 10;
+    constexpr int max_image_size = 16384;
+    //Waits of the listener while accept keeps failing for want of descriptors or memory.
+    constexpr auto min_accept_backoff = std::chrono::milliseconds{10};
+    constexpr auto max_accept_backoff = std::chrono::milliseconds{1000};
+
+    //What a failed accept calls for: trying again at once, waiting for
+    //descriptors or memory to be freed, or giving up on a listener that no
+    //longer works.
+    enum class AcceptFailure {
+        Retry
+        ,BackOff
+        ,Fatal
+    };
+
+#if defined(_WIN32)
+    constexpr int send_flags = 0;
+
+    void close_socket(std::intptr_t socket) {
+        ::closesocket(static_cast<SOCKET>(socket));
+    }
+
+    //Winsock has to be started once per process before the first socket call.
+    void start_sockets() {
+        static const bool started = []() {
+            WSADATA data{};
+            return ::WSAStartup(MAKEWORD(2, 2), &data) == 0;
+        }();
+        if(!started) {
+            throw std::runtime_error("Could not start Winsock");
+        }
+    }
+
+    AcceptFailure last_accept_failure(std::string& description) {
+        const auto error = ::WSAGetLastError();
+        description = "error " + std::to_string(error);
+        switch(error) {
+        case WSAEINTR: case WSAECONNRESET: return AcceptFailure::Retry;
+        case WSAEMFILE: case WSAENOBUFS: return AcceptFailure::BackOff;
+        default: return AcceptFailure::Fatal;
+        }
+    }
+
+    pollfd make_poll_entry(std::intptr_t socket) {
+        pollfd entry{};
+        entry.fd = static_cast<SOCKET>(socket);
+        entry.events = POLLIN;
+        return entry;
+    }
+
+    //Waits up to timeout_milliseconds, or for good if it is negative, for one
+    //of sockets to be readable. False if the wait itself failed.
+    bool poll_sockets(std::vector<pollfd>& sockets, int timeout_milliseconds) {
+        return ::WSAPoll(sockets.data(), static_cast<ULONG>(sockets.size()), timeout_milliseconds) >= 0;
+    }
+
+    void set_timeouts(std::intptr_t socket, int seconds) {
+        const DWORD milliseconds = static_cast<DWORD>(seconds) * 1000;
+        ::setsockopt(static_cast<SOCKET>(socket), SOL_SOCKET, SO_RCVTIMEO, reinterpret_cast<const char*>(&milliseconds), sizeof(milliseconds));
+        ::setsockopt(static_cast<SOCKET>(socket), SOL_SOCKET, SO_SNDTIMEO, reinterpret_cast<const char*>(&milliseconds), sizeof(milliseconds));
+    }
+#else
+    //A client that hangs up early must fail the write, not end the server.
+    constexpr int send_flags = MSG_NOSIGNAL;
+
+    void close_socket(std::intptr_t socket) {
+        ::close(static_cast<int>(socket));
+    }
+
+    void start_sockets() {
+        /* DO NOTHING */
+    }
+
+    AcceptFailure last_accept_failure(std::string& description) {
+        const auto error = errno;
+        description = std::strerror(error);
+        switch(error) {
+        case EINTR: case ECONNABORTED: return AcceptFailure::Retry;
+        case EMFILE: case ENFILE: case ENOBUFS: case ENOMEM: return AcceptFailure::BackOff;
+        default: return AcceptFailure::Fatal;
+        }
+    }
+
+    pollfd make_poll_entry(std::intptr_t socket) {
+        pollfd entry{};
+        entry.fd = static_cast<int>(socket);
+        entry.events = POLLIN;
+        return entry;
+    }
+
+    bool poll_sockets(std::vector<pollfd>& sockets, int timeout_milliseconds) {
+        return ::poll(sockets.data(), static_cast<nfds_t>(sockets.size()), timeout_milliseconds) >= 0 || errno == EINTR;
+    }
+
+    void set_timeouts(std::intptr_t socket, int seconds) {
+        const timeval timeout{seconds, 0};
+        ::setsockopt(static_cast<int>(socket), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        ::setsockopt(static_cast<int>(socket), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    }
+#endif
+
+    sockaddr_un make_address(const std::string& path) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if(path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("A socket path needs 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " characters: " + path);
+        }
+        std::memcpy(address.sun_path, path.data(), path.size());
+        return address;
+    }
+
+    std::intptr_t open_socket() {
+        start_sockets();
+        const auto socket = static_cast<std::intptr_t>(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if(socket == no_socket) {
+            throw std::runtime_error("Could not create a Unix domain socket");
+        }
+        return socket;
+    }
+
+    //Returns a connected socket, or no_socket if nothing listens on path.
+    std::intptr_t try_connect(const std::string& path) {
+        const auto address = make_address(path);
+        const auto socket = open_socket();
+        if(::connect(socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            close_socket(socket);
+            return no_socket;
+        }
+        return socket;
+    }
+
+    bool send_all(std::intptr_t socket, const void* data, std::size_t size) {
+        const auto* bytes = static_cast<const char*>(data);
+        while(size > 0) {
+            const auto chunk = static_cast<int>((std::min)(size, std::size_t{1} << 20));
+            const auto sent = ::send(socket, bytes, chunk, send_flags);
+            if(sent <= 0) {
+                return false;
+            }
+            bytes += sent;
+            size -= static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+    bool send_text(std::intptr_t socket, const std::string& text) {
+        return send_all(socket, text.data(), text.size());
+    }
+
+    //Buffered reads of lines and byte counts from one connection.
+    class SocketReader {
+    public:
+        explicit SocketReader(std::intptr_t socket) noexcept
+        : _socket{socket} {
+            /* DO NOTHING */
+        }
+
+        //The next line without its '\n'. False once the peer hangs up, the
+        //read times out or limit bytes pass without a line break.
+        bool read_line(std::string& line, std::size_t limit) {
+            for(;;) {
+                const auto end = _buffer.find('\n', _offset);
+                if(end != std::string::npos) {
+                    line.assign(_buffer, _offset, end - _offset);
+                    _offset = end + 1;
+                    return true;
+                }
+                if(_buffer.size() - _offset >= limit || !fill()) {
+                    return false;
+                }
+            }
+        }
+
+        bool read_bytes(std::size_t count, std::vector<std::uint8_t>& bytes) {
+            while(_buffer.size() - _offset < count) {
+                if(!fill()) {
+                    return false;
+                }
+            }
+            bytes.assign(_buffer.begin() + static_cast<std::ptrdiff_t>(_offset), _buffer.begin() + static_cast<std::ptrdiff_t>(_offset + count));
+            _offset += count;
+            return true;
+        }
+
+    protected:
+    private:
+        bool fill() {
+            _buffer.erase(0, _offset);
+            _offset = 0;
+            char chunk[64 * 1024];
+            const auto received = ::recv(_socket, chunk, static_cast<int>(sizeof(chunk)), 0);
+            if(received <= 0) {
+                return false;
+            }
+            _buffer.append(chunk, static_cast<std::size_t>(received));
+            return true;
+        }
+
+        std::intptr_t _socket{no_socket};
+        std::string _buffer{};
+        std::size_t _offset{0};
+    };
+
+    template<typename... Values>
+    void parse_values(const std::string& key, const std::string& text, Values&... values) {
+        std::istringstream in{text};
+        if(!((in >> values) && ...) || !(in >> std::ws).eof()) {
+            throw std::invalid_argument("Invalid value '" + text + "' for " + key);
+        }
+    }
+
+    int parse_count(const std::string& key, const std::string& text, int maximum) {
+        int value = 0;
+        parse_values(key, text, value);
+        if(value <= 0 || value > maximum) {
+            throw std::invalid_argument(key + " must be between 1 and " + std::to_string(maximum));
+        }
+        return value;
+    }
+
+    Point3 parse_point(const std::string& key, const std::string& text) {
+        float x = 0.0f;
+        float y = 0.0f;
+        float z = 0.0f;
+        parse_values(key, text, x, y, z);
+        return Point3{x, y, z};
+    }
+
+    const char* format_name(ImageFormat format) {
+        switch(format) {
+        case ImageFormat::Ppm: return "ppm";
+        case ImageFormat::Pfm: return "pfm";
+        case ImageFormat::Png: return "png";
+        default: return "unknown";
+        }
+    }
+
+    double milliseconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    //"ok BYTES QUEUED_MS SCENE_MS RENDER_MS" and the image, or "error MESSAGE".
+    bool send_reply(std::intptr_t socket, const RenderReply& reply) {
+        if(!reply.error.empty()) {
+            auto message = reply.error;
+            std::replace(message.begin(), message.end(), '\n', ' ');
+            return send_text(socket, "error " + message + '\n');
+        }
+        std::ostringstream header{};
+        header << "ok " << reply.image.size() << ' ' << reply.queued_ms << ' ' << reply.scene_ms << ' ' << reply.render_ms << '\n';
+        return send_text(socket, header.str()) && send_all(socket, reply.image.data(), reply.image.size());
+    }
+
+    //A connection the listener has accepted but not yet read a whole request from.
+    struct PendingRequest {
+        std::intptr_t connection{no_socket};
+        std::chrono::steady_clock::time_point arrived{};
+        std::string bytes{};
+    };
+
+    //Appends what has arrived on socket to bytes. Only called once poll says
+    //the socket is readable, so it does not block. False once the peer hangs up.
+    bool receive_more(std::intptr_t socket, std::string& bytes) {
+        char chunk[4096];
+        const auto received = ::recv(socket, chunk, static_cast<int>(sizeof(chunk)), 0);
+        if(received <= 0) {
+            return false;
+        }
+        bytes.append(chunk, static_cast<std::size_t>(received));
+        return true;
+    }
+
+    //The request in bytes, its lines up to the blank one that ends it, or
+    //nothing while the blank line has yet to arrive.
+    std::optional<std::string> complete_request(const std::string& bytes) {
+        if(bytes.starts_with('\n')) {
+            return std::string{};
+        }
+        const auto end = bytes.find("\n\n");
+        if(end == std::string::npos) {
+            return std::nullopt;
+        }
+        return bytes.substr(0, end + 1);
+    }
+
+    void send_error(std::intptr_t socket, const std::string& message) {
+        RenderReply reply{};
+        reply.error = message;
+        send_reply(socket, reply);
+        close_socket(socket);
+    }
+
+}
+
+std::string encode_job(const RenderJob& job) {
+    std::ostringstream out{};
+    out << "render\n"
+        << "scene " << job.scene << '\n'
+        << "size " << job.image_width << ' ' << job.image_height << '\n'
+        << "samples " << job.samples_per_pixel << '\n'
+        << "depth " << job.max_depth << '\n'
+        << "seed " << job.seed << '\n'
+        << "priority " << job.priority << '\n'
+        << "format " << format_name(job.format) << '\n';
+    if(job.look_from) {
+        out << "look_from " << job.look_from->x() << ' ' << job.look_from->y() << ' ' << job.look_from->z() << '\n';
+    }
+    if(job.look_at) {
+        out << "look_at " << job.look_at->x() << ' ' << job.look_at->y() << ' ' << job.look_at->z() << '\n';
+    }
+    out << '\n';
+    return out.str();
+}
+
+RenderJob decode_job(const std::string& text) {
+    std::istringstream lines{text};
+    std::string line{};
+    if(!std::getline(lines, line) || line != "render") {
+        throw std::invalid_argument("Unknown request '" + line + "'");
+    }
+    RenderJob job{};
+    while(std::getline(lines, line) && !line.empty()) {
+        const auto space = line.find(' ');
+        const auto key = line.substr(0, space);
+        const auto value = space == std::string::npos ? std::string{} : line.substr(space + 1);
+        if(key == "scene") {
+            if(value.empty()) {
+                throw std::invalid_argument("scene needs a file or 'random'");
+            }
+            job.scene = value;
+        } else if(key == "size") {
+            parse_values(key, value, job.image_width, job.image_height);
+            if(job.image_width <= 0 || job.image_height <= 0 || job.image_width > max_image_size || job.image_height > max_image_size) {
+                throw std::invalid_argument("size must be between 1 and " + std::to_string(max_image_size) + " pixels each way");
+            }
+        } else if(key == "samples") {
+            job.samples_per_pixel = parse_count(key, value, 1 << 20);
+        } else if(key == "depth") {
+            job.max_depth = parse_count(key, value, 1 << 10);
+        } else if(key == "seed") {
+            parse_values(key, value, job.seed);
+        } else if(key == "priority") {
+            parse_values(key, value, job.priority);
+        } else if(key == "format") {
+            if(value == "ppm") {
+                job.format = ImageFormat::Ppm;
+            } else if(value == "pfm") {
+                job.format = ImageFormat::Pfm;
+            } else if(value == "png") {
+                job.format = ImageFormat::Png;
+            } else {
+                throw std::invalid_argument("Unknown format '" + value + "', expected ppm, pfm or png");
+            }
+        } else if(key == "look_from") {
+            job.look_from = parse_point(key, value);
+        } else if(key == "look_at") {
+            job.look_at = parse_point(key, value);
+        } else {
+            throw std::invalid_argument("Unknown job field '" + key + "'");
+        }
+    }
+    return job;
+}
+
+SceneCache::SceneCache(std::size_t capacity)
+: _capacity{(std::max)(capacity, std::size_t{1})} {
+    /* DO NOTHING */
+}
+
+std::shared_ptr<const CachedScene> SceneCache::get(const std::string& reference, bool& was_cached) {
+    std::filesystem::file_time_type modified{};
+    if(reference != "random") {
+        //A file that can't be read fails in load_scene, with its own message.
+        std::error_code error{};
+        modified = std::filesystem::last_write_time(reference, error);
+    }
+    auto found = _entries.find(reference);
+    if(found != _entries.end() && found->second.modified == modified) {
+        found->second.last_used = ++_clock;
+        was_cached = true;
+        return found->second.scene;
+    }
+    was_cached = false;
+    if(found != _entries.end()) {
+        _entries.erase(found);
+    }
+    auto scene = build(reference);
+    if(_entries.size() >= _capacity) {
+        const auto oldest = std::min_element(_entries.begin(), _entries.end(), [](const auto& a, const auto& b) { return a.second.last_used < b.second.last_used; });
+        _entries.erase(oldest);
+    }
+    _entries.emplace(reference, Entry{scene, modified, ++_clock});
+    return scene;
+}
+
+std::size_t SceneCache::size() const noexcept {
+    return _entries.size();
+}
+
+//Built in place: the BVH points into the scene's arena and spheres.
+std::shared_ptr<const CachedScene> SceneCache::build(const std::string& reference) {
+    PROFILE_SCOPE_FUNCTION();
+    auto cached = std::make_shared<CachedScene>();
+    if(reference == "random") {
+        //random_scene lays the spheres out with this thread's generator; start
+        //it where a fresh process does, so the server renders the CLI's scene.
+        thread_rng() = Pcg32{};
+        cached->scene = random_scene();
+    } else {
+        cached->scene = load_scene(reference);
+    }
+    const auto& scene = cached->scene;
+    const bool from_file = scene.world.objects().empty() && scene.spheres.size() > 0;
+    if(scene.bvh) {
+        cached->accelerator = scene.bvh;
+    } else if(from_file) {
+        cached->accelerator = std::make_shared<const Bvh>(scene.spheres);
+    } else {
+        cached->accelerator = std::make_shared<const Bvh>(scene.world, BvhLeafFormat::SphereBatch);
+    }
+    return cached;
+}
+
+RenderServer::RenderServer(const std::string& socket_path, unsigned int thread_count, std::size_t cache_size)
+: _socket_path{socket_path}
+, _pool{thread_count}
+, _cache{cache_size} {
+    const auto address = make_address(socket_path);
+    if(std::filesystem::exists(socket_path)) {
+        const auto live = try_connect(socket_path);
+        if(live != no_socket) {
+            close_socket(live);
+            throw std::runtime_error("A server is already listening on " + socket_path);
+        }
+        //Left behind by a server that did not shut down cleanly.
+        std::filesystem::remove(socket_path);
+    }
+    _listener = open_socket();
+    if(::bind(_listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || ::listen(_listener, SOMAXCONN) != 0) {
+        close_socket(_listener);
+        _listener = no_socket;
+        throw std::runtime_error("Could not listen on " + socket_path);
+    }
+}
+
+RenderServer::~RenderServer() noexcept {
+    if(_listener != no_socket) {
+        close_socket(_listener);
+        std::error_code error{};
+        std::filesystem::remove(_socket_path, error);
+    }
+}
+
+void RenderServer::run() {
+    std::thread dispatcher{[this]() { dispatch_loop(); }};
+    listen_loop();
+    {
+        std::scoped_lock lock(_mutex);
+        _stopping = true;
+    }
+    _job_ready.notify_one();
+    dispatcher.join();
+}
+
+unsigned int RenderServer::thread_count() const noexcept {
+    return _pool.thread_count();
+}
+
+//Reads the requests on this thread, so the dispatcher only ever renders. It
+//polls the listener and every connection still sending its request together,
+//so a slow or idle client holds up no one else; each gets request_timeout from
+//accept, which is also where its queued time starts. An accept that fails for
+//good stops the server as a stop request does.
+void RenderServer::listen_loop() {
+    PROFILE_THREAD_NAME("Render Server Listener");
+    std::vector<PendingRequest> pending{};
+    std::vector<pollfd> sockets{};
+    auto backoff = std::chrono::milliseconds{0};
+    auto accept_after = std::chrono::steady_clock::now();
+    for(;;) {
+        auto now = std::chrono::steady_clock::now();
+        const bool accepting = now >= accept_after;
+        auto wake = accepting ? std::chrono::steady_clock::time_point::max() : accept_after;
+        sockets.clear();
+        for(const auto& request : pending) {
+            sockets.push_back(make_poll_entry(request.connection));
+            wake = (std::min)(wake, request.arrived + request_timeout);
+        }
+        if(accepting) {
+            sockets.push_back(make_poll_entry(_listener));
+        }
+        int timeout = -1;
+        if(wake != std::chrono::steady_clock::time_point::max()) {
+            timeout = static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>((std::max)(wake - now, std::chrono::steady_clock::duration::zero())).count());
+        }
+        if(!poll_sockets(sockets, timeout)) {
+            std::cerr << "Could not wait for requests, stopping\n";
+            break;
+        }
+        now = std::chrono::steady_clock::now();
+
+        bool stop = false;
+        std::vector<PendingRequest> still_pending{};
+        for(std::size_t i = 0; i < pending.size(); ++i) {
+            auto& request = pending[i];
+            if(sockets[i].revents == 0) {
+                if(now >= request.arrived + request_timeout) {
+                    send_error(request.connection, "The request took too long to arrive");
+                } else {
+                    still_pending.push_back(std::move(request));
+                }
+                continue;
+            }
+            if(!receive_more(request.connection, request.bytes)) {
+                send_error(request.connection, "The request was cut short");
+                continue;
+            }
+            const auto text = complete_request(request.bytes);
+            if(!text) {
+                if(request.bytes.size() > max_request_bytes) {
+                    send_error(request.connection, "The request was too long");
+                } else {
+                    still_pending.push_back(std::move(request));
+                }
+                continue;
+            }
+            if(*text == "stop\n") {
+                send_text(request.connection, "stopping\n");
+                close_socket(request.connection);
+                stop = true;
+                continue;
+            }
+            try {
+                auto job = decode_job(*text);
+                {
+                    std::scoped_lock lock(_mutex);
+                    _queue.push(QueuedJob{std::move(job), request.connection, _next_sequence++, request.arrived});
+                }
+                _job_ready.notify_one();
+            } catch(const std::exception& e) {
+                send_error(request.connection, e.what());
+            }
+        }
+        pending = std::move(still_pending);
+        if(stop) {
+            break;
+        }
+
+        if(!accepting || sockets.back().revents == 0) {
+            continue;
+        }
+        const auto connection = static_cast<std::intptr_t>(::accept(_listener, nullptr, nullptr));
+        if(connection == no_socket) {
+            std::string description{};
+            const auto failure = last_accept_failure(description);
+            if(failure == AcceptFailure::Retry) {
+                continue;
+            }
+            if(failure == AcceptFailure::BackOff) {
+                if(backoff.count() == 0) {
+                    std::cerr << "Could not accept a connection (" << description << "), retrying\n";
+                }
+                backoff = std::clamp(backoff * 2, min_accept_backoff, max_accept_backoff);
+                //Keep serving the connections already accepted in the meantime.
+                accept_after = now + backoff;
+                continue;
+            }
+            std::cerr << "Could not accept a connection (" << description << "), stopping\n";
+            break;
+        }
+        backoff = std::chrono::milliseconds{0};
+        set_timeouts(connection, io_timeout_seconds);
+        pending.push_back(PendingRequest{connection, std::chrono::steady_clock::now(), {}});
+    }
+    for(const auto& request : pending) {
+        send_error(request.connection, "The server is stopping");
+    }
+}
+
+void RenderServer::dispatch_loop() {
+    PROFILE_THREAD_NAME("Render Server Dispatcher");
+    for(;;) {
+        QueuedJob queued{};
+        std::size_t waiting = 0;
+        {
+            std::unique_lock lock(_mutex);
+            _job_ready.wait(lock, [this]() { return !_queue.empty() || _stopping; });
+            if(_queue.empty()) {
+                return;
+            }
+            queued = _queue.top();
+            _queue.pop();
+            waiting = _queue.size();
+        }
+        const auto reply = render_job(queued);
+        if(!send_reply(queued.connection, reply)) {
+            std::cerr << "Job " << queued.sequence << ": the client hung up before the reply was sent\n";
+        }
+        close_socket(queued.connection);
+        const auto& job = queued.job;
+        std::cerr << "Job " << queued.sequence << " (" << job.scene << ", " << job.image_width << 'x' << job.image_height << ", " << job.samples_per_pixel
+                  << " spp, priority " << job.priority << "): ";
+        if(reply.error.empty()) {
+            std::cerr << "queued " << reply.queued_ms << " ms, ";
+            if(reply.scene_ms > 0.0) {
+                std::cerr << "scene built in " << reply.scene_ms << " ms, ";
+            } else {
+                std::cerr << "scene cached, ";
+            }
+            std::cerr << "render " << reply.render_ms << " ms; " << waiting << " waiting\n";
+        } else {
+            std::cerr << reply.error << '\n';
+        }
+    }
+}
+
+RenderReply RenderServer::render_job(const QueuedJob& queued) {
+    PROFILE_SCOPE_FUNCTION();
+    const auto& job = queued.job;
+    RenderReply reply{};
+    reply.queued_ms = milliseconds_since(queued.arrived);
+    try {
+        const auto start = std::chrono::steady_clock::now();
+        bool was_cached = false;
+        const auto cached = _cache.get(job.scene, was_cached);
+        reply.scene_ms = was_cached ? 0.0 : milliseconds_since(start);
+
+        auto camera_desc = cached->scene.camera;
+        camera_desc.look_from = job.look_from.value_or(camera_desc.look_from);
+        camera_desc.look_at = job.look_at.value_or(camera_desc.look_at);
+        const auto camera = make_camera(camera_desc, job.image_width / static_cast<float>(job.image_height));
+        RenderSettings settings{};
+        settings.image_width = job.image_width;
+        settings.image_height = job.image_height;
+        settings.samples_per_pixel = job.samples_per_pixel;
+        settings.max_depth = job.max_depth;
+        settings.seed = job.seed;
+        settings.report_progress = false;
+        Framebuffer framebuffer{job.image_width, job.image_height};
+        const auto tiles = make_tiles(job.image_width, job.image_height, settings.tile_size);
+        const auto result = render(*cached->accelerator, cached->scene.materials, camera, settings, _pool, tiles, framebuffer);
+        reply.render_ms = result.seconds * 1e3;
+        reply.image = encode_image(framebuffer, job.format);
+    } catch(const std::exception& e) {
+        reply.error = e.what();
+    }
+    return reply;
+}
+
+RenderReply submit_job(const std::string& socket_path, const RenderJob& job) {
+    const auto socket = try_connect(socket_path);
+    if(socket == no_socket) {
+        throw std::runtime_error("No render server is listening on " + socket_path);
+    }
+    RenderReply reply{};
+    SocketReader reader{socket};
+    std::string status{};
+    const auto received = send_text(socket, encode_job(job)) && reader.read_line(status, max_request_bytes);
+    if(received && status.starts_with("error ")) {
+        reply.error = status.substr(6);
+    } else if(received && status.starts_with("ok ")) {
+        std::istringstream fields{status.substr(3)};
+        std::size_t bytes = 0;
+        fields >> bytes >> reply.queued_ms >> reply.scene_ms >> reply.render_ms;
+        if(!fields || !reader.read_bytes(bytes, reply.image)) {
+            close_socket(socket);
+            throw std::runtime_error("The render server at " + socket_path + " sent a broken reply");
+        }
+    } else {
+        close_socket(socket);
+        throw std::runtime_error("The render server at " + socket_path + " hung up without a reply");
+    }
+    close_socket(socket);
+    return reply;
+}
+
+void stop_server(const std::string& socket_path) {
+    const auto socket = try_connect(socket_path);
+    if(socket == no_socket) {
+        throw std::runtime_error("No render server is listening on " + socket_path);
+    }
+    SocketReader reader{socket};
+    std::string status{};
+    const auto stopped = send_text(socket, "stop\n\n") && reader.read_line(status, max_request_bytes) && status == "stopping";
+    close_socket(socket);
+    if(!stopped) {
+        throw std::runtime_error("The render server at " + socket_path + " did not confirm the stop");
+    }
+}
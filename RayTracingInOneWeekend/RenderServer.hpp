@@ -0,0 +1,149 @@
+#pragma once
+
+#include "Hittable.hpp"
+#include "ImageEncoders.hpp"
+#include "Scene.hpp"
+#include "ThreadPool.hpp"
+#include "Vector3.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+
+//One image for the render server to make.
+struct RenderJob {
+    //A scene file on the server's machine, or "random" for the cover scene.
+    std::string scene{"random"};
+    int image_width{400};
+    int image_height{266};
+    int samples_per_pixel{100};
+    int max_depth{50};
+    std::uint64_t seed{0};
+    //Higher runs first; jobs of equal priority run in the order they arrived.
+    int priority{0};
+    //Unset: the scene's own camera.
+    std::optional<Point3> look_from{};
+    std::optional<Point3> look_at{};
+    ImageFormat format{ImageFormat::Ppm};
+};
+
+//What the server sends back: the encoded image, or why there is none.
+struct RenderReply {
+    std::string error{};
+    std::vector<std::uint8_t> image{};
+    double queued_ms{0.0};
+    //0 when the scene came from the cache.
+    double scene_ms{0.0};
+    double render_ms{0.0};
+};
+
+//The request is "key value" lines ending with an empty line. Throws
+//std::invalid_argument on unknown keys and malformed values.
+std::string encode_job(const RenderJob& job);
+RenderJob decode_job(const std::string& text);
+
+//A built scene and its acceleration structure, shared by every job that renders it.
+struct CachedScene {
+    Scene scene{};
+    std::shared_ptr<const Hittable> accelerator{};
+};
+
+//The scenes of the most recent jobs, least recently used evicted first. A
+//scene file is loaded again once its modification time changes. Only the
+//server's dispatcher thread uses it.
+class SceneCache {
+public:
+    explicit SceneCache(std::size_t capacity);
+
+    //The scene the reference names, loaded and its BVH built on a miss; see
+    //RenderJob::scene. was_cached tells which it was. Throws what load_scene
+    //throws.
+    std::shared_ptr<const CachedScene> get(const std::string& reference, bool& was_cached);
+
+    std::size_t size() const noexcept;
+
+protected:
+private:
+    struct Entry {
+        std::shared_ptr<const CachedScene> scene{};
+        std::filesystem::file_time_type modified{};
+        std::uint64_t last_used{0};
+    };
+
+    static std::shared_ptr<const CachedScene> build(const std::string& reference);
+
+    std::size_t _capacity{1};
+    std::uint64_t _clock{0};
+    std::map<std::string, Entry> _entries{};
+};
+
+//Renders jobs sent over a Unix domain socket, for callers that make many
+//small images and would otherwise pay for process startup and scene
+//construction on every one. A listener thread reads each request into a
+//priority queue; one dispatcher takes the most urgent job, renders it with
+//all of the shared pool's threads and writes the reply on the job's
+//connection. Scenes stay in a SceneCache between jobs.
+class RenderServer {
+public:
+    //Binds and listens on socket_path, replacing a stale socket file there.
+    //Throws std::runtime_error if it cannot.
+    RenderServer(const std::string& socket_path, unsigned int thread_count, std::size_t cache_size);
+    ~RenderServer() noexcept;
+
+    RenderServer() = delete;
+    RenderServer(const RenderServer&) = delete;
+    RenderServer(RenderServer&&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+    RenderServer& operator=(RenderServer&&) = delete;
+
+    //Serves until a client sends a stop request, then finishes the queued
+    //jobs and returns.
+    void run();
+
+    unsigned int thread_count() const noexcept;
+
+protected:
+private:
+    struct QueuedJob {
+        RenderJob job{};
+        std::intptr_t connection{-1};
+        std::uint64_t sequence{0};
+        std::chrono::steady_clock::time_point arrived{};
+    };
+    struct RunsLater {
+        bool operator()(const QueuedJob& a, const QueuedJob& b) const noexcept {
+            return a.job.priority != b.job.priority ? a.job.priority < b.job.priority : a.sequence > b.sequence;
+        }
+    };
+
+    void listen_loop();
+    void dispatch_loop();
+    RenderReply render_job(const QueuedJob& queued);
+
+    std::string _socket_path{};
+    std::intptr_t _listener{-1};
+    ThreadPool _pool;
+    SceneCache _cache;
+    std::mutex _mutex{};
+    std::condition_variable _job_ready{};
+    std::priority_queue<QueuedJob, std::vector<QueuedJob>, RunsLater> _queue{};
+    std::uint64_t _next_sequence{0};
+    bool _stopping{false};
+};
+
+//Sends the job to the server listening on socket_path and waits for its reply.
+//Throws std::runtime_error if the server cannot be reached or hangs up early.
+RenderReply submit_job(const std::string& socket_path, const RenderJob& job);
+
+//Asks the server to stop once its queued jobs are done.
+//Throws std::runtime_error if the server cannot be reached.
+void stop_server(const std::string& socket_path);
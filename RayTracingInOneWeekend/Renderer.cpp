@@ -0,0 +1,253 @@
+#include "Renderer.hpp"
+
+#include "MaterialKernels.hpp"
+#include "MathUtils.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "ThreadPool.hpp"
+#include "WavefrontIntegrator.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <type_traits>
+
+namespace {
+
+    //Hittable: virtual hits and Material::scatter. Anything else: World::hit
+    //called directly, and the scatter kernel of the hit's material type.
+    template<typename World>
+    constexpr bool static_dispatch = !std::is_same_v<World, Hittable>;
+
+    template<typename World, ShadingMath math>
+    Color trace_path(const Ray3& r, const World& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count);
+
+    template<typename World, ShadingMath math>
+    std::uint64_t render_tile_with(const Tile& tile, const World& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer);
+
+    //The two above in settings.shading_math, chosen once per tile or path.
+    template<typename World>
+    Color trace_path_with_math(const Ray3& r, const World& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count);
+
+    template<typename World>
+    std::uint64_t render_tile_with_math(const Tile& tile, const World& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer);
+
+    template<typename World>
+    RenderResult render_with(const World& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer, const TileDoneCallback& tile_done);
+
+}
+
+std::unique_ptr<Sampler> make_sampler(const RenderSettings& settings) {
+    switch(settings.sampler) {
+    case SamplerType::Stratified: return std::make_unique<StratifiedSampler>(settings.seed, settings.samples_per_pixel);
+    case SamplerType::Sobol: return std::make_unique<SobolSampler>(settings.seed);
+    case SamplerType::BlueNoise: return std::make_unique<BlueNoiseSampler>(settings.seed, settings.image_width, settings.samples_per_pixel);
+    default: return nullptr;
+    }
+}
+
+std::vector<Tile> make_tiles(int image_width, int image_height, int tile_size) {
+    std::vector<Tile> tiles{};
+    tiles.reserve(static_cast<std::size_t>(((image_width + tile_size - 1) / tile_size) * ((image_height + tile_size - 1) / tile_size)));
+    for(int y = 0; y < image_height; y += tile_size) {
+        for(int x = 0; x < image_width; x += tile_size) {
+            tiles.emplace_back(Tile{x, y, (std::min)(x + tile_size, image_width), (std::min)(y + tile_size, image_height)});
+        }
+    }
+    return tiles;
+}
+
+RenderResult render(const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer, const TileDoneCallback& tile_done) {
+    return render_with(world, materials, camera, settings, pool, tiles, framebuffer, tile_done);
+}
+
+RenderResult render(const StaticSphereScene& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer, const TileDoneCallback& tile_done) {
+    return render_with(world, materials, camera, settings, pool, tiles, framebuffer, tile_done);
+}
+
+std::uint64_t render_tile(const Tile& tile, const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer) {
+    return render_tile_with_math(tile, world, materials, camera, settings, framebuffer);
+}
+
+std::uint64_t render_tile(const Tile& tile, const StaticSphereScene& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer) {
+    return render_tile_with_math(tile, world, materials, camera, settings, framebuffer);
+}
+
+bool sampling_done(const PixelStatistics& stats, const RenderSettings& settings) {
+    const auto count = static_cast<int>(stats.count());
+    if(count >= settings.samples_per_pixel) {
+        return true;
+    }
+    if(!settings.adaptive || count < settings.min_samples_per_pixel || (count - settings.min_samples_per_pixel) % adaptive_sample_batch != 0) {
+        return false;
+    }
+    return stats.error() <= settings.error_threshold;
+}
+
+Color ray_color(const Ray3& r, const Hittable& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count) {
+    return trace_path_with_math(r, world, materials, depth, settings, throughput, path, ray_count);
+}
+
+Color ray_color(const Ray3& r, const StaticSphereScene& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count) {
+    return trace_path_with_math(r, world, materials, depth, settings, throughput, path, ray_count);
+}
+
+float roulette_weight(const Color& throughput, int rays_traced, int roulette_min_depth) {
+    if(roulette_min_depth <= 0 || rays_traced < roulette_min_depth) {
+        return 1.0f;
+    }
+    const auto survival = (std::min)(1.0f, (std::max)({throughput.x(), throughput.y(), throughput.z()}));
+    if(random_float() >= survival) {
+        RAY_STATS(++thread_ray_stats().roulette_terminations);
+        return 0.0f;
+    }
+    return 1.0f / survival;
+}
+
+Color background_color(const Ray3& r) {
+    Vector3 direction = unit_vector(r.direction());
+    auto t = 0.5f * (direction.y() + 1.0f);
+    return (1.0f - t) * Color(1.0f, 1.0f, 1.0f) + t * Color(0.5f, 0.7f, 1.0f);
+}
+
+std::ostream& operator<<(std::ostream& out, Integrator integrator) {
+    switch(integrator) {
+    case Integrator::Recursive: return out << "recursive";
+    case Integrator::Wavefront: return out << "wavefront";
+    default: return out << "unknown";
+    }
+}
+
+namespace {
+
+    template<typename World>
+    RenderResult render_with(const World& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer, const TileDoneCallback& tile_done) {
+        const auto start = std::chrono::steady_clock::now();
+        RenderResult result{};
+        const auto tile_count = static_cast<int>(tiles.size());
+        std::atomic<int> tiles_done{0};
+        std::atomic<std::uint64_t> ray_count{0};
+        std::mutex stats_mutex{};
+
+        for(const auto& tile : tiles) {
+            pool.submit([&tile, &world, &materials, &camera, &settings, &framebuffer, &tile_done, &tiles_done, &ray_count, &stats_mutex, &result]() {
+                PROFILE_SCOPE("Render Tile");
+                RAY_STATS(thread_ray_stats() = RayStats{});
+                const auto rays = settings.integrator == Integrator::Wavefront
+                    ? render_tile_wavefront(tile, world, materials, camera, settings, framebuffer)
+                    : render_tile_with_math(tile, world, materials, camera, settings, framebuffer);
+                ray_count += rays;
+                {
+                    //Once per tile, so the lock is never contended enough to matter.
+                    std::scoped_lock lock(stats_mutex);
+                    result.stats += thread_ray_stats();
+                }
+                if(tile_done) {
+                    tile_done(tile);
+                }
+                ++tiles_done;
+            });
+        }
+
+        //Only this thread touches std::cerr; the workers just bump the counter.
+        if(settings.report_progress) {
+            using namespace std::chrono_literals;
+            while(!pool.wait_for(250ms)) {
+                std::cerr << "\rTiles remaining: " << (tile_count - tiles_done.load()) << ' ' << std::flush;
+            }
+            std::cerr << "\rTiles remaining: 0 \n";
+        } else {
+            pool.wait();
+        }
+        result.ray_count = ray_count.load();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+    template<typename World>
+    Color trace_path_with_math(const Ray3& r, const World& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count) {
+        if(settings.shading_math == ShadingMath::Fast) {
+            return trace_path<World, ShadingMath::Fast>(r, world, materials, depth, settings, throughput, path, ray_count);
+        }
+        return trace_path<World, ShadingMath::Reference>(r, world, materials, depth, settings, throughput, path, ray_count);
+    }
+
+    template<typename World>
+    std::uint64_t render_tile_with_math(const Tile& tile, const World& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer) {
+        if(settings.shading_math == ShadingMath::Fast) {
+            return render_tile_with<World, ShadingMath::Fast>(tile, world, materials, camera, settings, framebuffer);
+        }
+        return render_tile_with<World, ShadingMath::Reference>(tile, world, materials, camera, settings, framebuffer);
+    }
+
+    template<typename World, ShadingMath math>
+    std::uint64_t render_tile_with(const Tile& tile, const World& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer) {
+        std::uint64_t ray_count = 0;
+        const auto sampler = make_sampler(settings);
+        for(int y = tile.y_begin; y < tile.y_end; ++y) {
+            for(int x = tile.x_begin; x < tile.x_end; ++x) {
+                const auto pixel_index = static_cast<std::uint64_t>(y) * settings.image_width + x;
+                Color pixel_color{0.0f, 0.0f, 0.0f};
+                PixelStatistics stats{};
+                for(std::uint64_t sample = 0; !sampling_done(stats, settings); ++sample) {
+                    const auto sample_index = settings.first_sample + sample;
+                    const auto path = SamplePath{sampler.get(), make_path_key(settings.seed, pixel_index, sample_index), pixel_index, sample_index};
+                    seed_sample_path(path, 0);
+                    const auto u = (x + random_float()) / (settings.image_width - 1);
+                    const auto v = (y + random_float()) / (settings.image_height - 1);
+                    const auto r = camera.get_ray(u, v);
+                    const auto sample_color = trace_path<World, math>(r, world, materials, settings.max_depth, settings, Color{1.0f, 1.0f, 1.0f}, path, ray_count);
+                    pixel_color += sample_color;
+                    stats.add(sample_color);
+                }
+                framebuffer.store(framebuffer.index(x, y), pixel_color, stats.count());
+            }
+        }
+        end_sample_path();
+        return ray_count;
+    }
+
+    template<typename World, ShadingMath math>
+    Color trace_path(const Ray3& r, const World& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count) {
+        hit_record rec{};
+
+        //If we've exceeded the ray bounce limit, no more light is gathered.
+        if(depth <= 0) {
+            RAY_STATS(++thread_ray_stats().max_depth_terminations);
+            return Color{0.0f, 0.0f, 0.0f};
+        }
+        ++ray_count;
+        const auto rays_traced = settings.max_depth - depth + 1;
+        RAY_STATS(thread_ray_stats().count_rays(rays_traced - 1));
+        if(world.hit(r, 0.001f, infinity, rec)) {
+            //The hit is final; this is the only place its material is read.
+            const auto& material = materials[rec.material_id];
+            Ray3 scattered{};
+            seed_sample_path(path, static_cast<std::uint32_t>(rays_traced));
+            const auto scattered_ok = [&]() {
+                //Material::scatter is the reference math, so fast math always takes the kernels.
+                if constexpr(static_dispatch<World> || math == ShadingMath::Fast) {
+                    return visit_material_type(material.type, [&](auto type) { return scatter_kernel<decltype(type)::value, math>(material, r, rec, scattered); });
+                } else {
+                    return material.scatter(r, rec, scattered);
+                }
+            }();
+            if(scattered_ok) {
+                const auto next_throughput = throughput * material.color;
+                const auto weight = roulette_weight(next_throughput, rays_traced, settings.roulette_min_depth);
+                if(weight == 0.0f) {
+                    return Color{0.0f, 0.0f, 0.0f};
+                }
+                //weight is exactly 1 without roulette, leaving the product unchanged.
+                return material.color * trace_path<World, math>(scattered, world, materials, depth - 1, settings, next_throughput * weight, path, ray_count) * weight;
+            }
+            return Color{0.0f, 0.0f, 0.0f};
+        }
+
+        RAY_STATS(++thread_ray_stats().sky_misses);
+        return background_color(r);
+    }
+
+}
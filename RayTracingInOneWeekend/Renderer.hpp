@@ -0,0 +1,117 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "Framebuffer.hpp"
+#include "Hittable.hpp"
+#include "Material.hpp"
+#include "PixelStatistics.hpp"
+#include "Ray3.hpp"
+#include "RayStats.hpp"
+#include "Sampler.hpp"
+#include "ShadingMath.hpp"
+#include "StaticScene.hpp"
+#include "Vector3.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+class ThreadPool;
+
+struct Tile {
+    int x_begin{0};
+    int y_begin{0};
+    int x_end{0};
+    int y_end{0};
+};
+
+enum class Integrator {
+    Recursive   //ray_color: one path at a time, depth first.
+    ,Wavefront  //Batches of paths advanced one bounce at a time, see WavefrontIntegrator.hpp.
+};
+
+struct RenderSettings {
+    int image_width{400};
+    int image_height{266};
+    int samples_per_pixel{100};
+    int max_depth{50};
+    int tile_size{16};
+    std::uint64_t seed{0};
+    Integrator integrator{Integrator::Recursive};
+    //Index of the first sample of every pixel. Samples are keyed by index, so
+    //renders of disjoint sample ranges add up to one render of their union.
+    std::uint64_t first_sample{0};
+    //Adaptive sampling: samples_per_pixel becomes the maximum and a pixel stops
+    //early once PixelStatistics::error() falls to error_threshold.
+    bool adaptive{false};
+    int min_samples_per_pixel{16};
+    float error_threshold{0.01f};
+    //Russian roulette: once a path has traced this many rays it may end at any
+    //bounce, see roulette_weight. 0 turns it off.
+    int roulette_min_depth{0};
+    SamplerType sampler{SamplerType::Independent};
+    //Fast trades a few ulps in the material kernels for speed; see ShadingMath.hpp.
+    ShadingMath shading_math{ShadingMath::Reference};
+    //Print the tiles remaining to std::cerr while render waits for them.
+    bool report_progress{true};
+};
+
+//Samples taken between two convergence tests of an adaptively sampled pixel.
+constexpr int adaptive_sample_batch = 8;
+
+struct RenderResult {
+    std::uint64_t ray_count{0};
+    double seconds{0.0};
+    //Every worker's counters, added up. Empty if built without RTIOW_RAY_STATS.
+    RayStats stats{};
+};
+
+//The sampler the settings ask for; nullptr for SamplerType::Independent.
+std::unique_ptr<Sampler> make_sampler(const RenderSettings& settings);
+
+std::vector<Tile> make_tiles(int image_width, int image_height, int tile_size);
+
+//Called on the worker that finished a tile, once all of its pixels are stored.
+using TileDoneCallback = std::function<void(const Tile& tile)>;
+
+//Renders the tiles on the pool into the framebuffer, which holds the summed
+//radiance and sample count of every pixel. Pixels outside the tiles are left
+//as they are, so a framebuffer restored from a checkpoint can be finished.
+RenderResult render(const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer, const TileDoneCallback& tile_done = {});
+
+//Returns the number of rays traced.
+std::uint64_t render_tile(const Tile& tile, const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer);
+
+//The same for a world whose primitive types are known at compile time: hits
+//are direct calls into inlined primitive tests and each bounce runs the
+//material kernel for its type, see StaticScene.hpp and MaterialKernels.hpp.
+//The images match up to how the compiler fuses the inlined arithmetic. The
+//wavefront integrator renders it through the Hittable overloads.
+RenderResult render(const StaticSphereScene& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer, const TileDoneCallback& tile_done = {});
+std::uint64_t render_tile(const Tile& tile, const StaticSphereScene& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer);
+
+//True once a pixel has all the samples it is going to get. Without adaptive
+//sampling that is samples_per_pixel; with it, convergence is tested after
+//min_samples_per_pixel and then every adaptive_sample_batch samples, so both
+//integrators stop every pixel at the same sample.
+bool sampling_done(const PixelStatistics& stats, const RenderSettings& settings);
+
+//path selects the random numbers of this path, see seed_sample_path.
+//depth is the number of rays the path may still trace, out of settings.max_depth,
+//and throughput the product of the attenuations of the bounces before r.
+Color ray_color(const Ray3& r, const Hittable& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count);
+Color ray_color(const Ray3& r, const StaticSphereScene& world, const MaterialTable& materials, int depth, const RenderSettings& settings, const Color& throughput, const SamplePath& path, std::uint64_t& ray_count);
+
+//Russian roulette for a path that has traced rays_traced rays and would carry
+//throughput into its next ray. From roulette_min_depth rays on, the path
+//survives with probability p, the largest channel of throughput capped at 1,
+//and 1/p is returned so the survivors make up for the paths that ended; 0
+//means the path ends. Draws one number with random_float() when it plays,
+//so call it after the bounce's scatter. Returns 1 otherwise.
+float roulette_weight(const Color& throughput, int rays_traced, int roulette_min_depth);
+
+Color background_color(const Ray3& r);
+
+std::ostream& operator<<(std::ostream& out, Integrator integrator);
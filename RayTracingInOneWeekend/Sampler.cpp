@@ -0,0 +1,246 @@
+#include "Sampler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace {
+
+    //The largest float below 1.
+    constexpr float one_minus_epsilon = 0x1.fffffep-1f;
+
+    float to_unit_float(std::uint32_t bits) noexcept {
+        return static_cast<float>(bits >> 8u) * 0x1.0p-24f;
+    }
+
+    //Boost's hash_combine: cheap, for deriving the seeds of a set from one good hash.
+    constexpr std::uint32_t hash_combine(std::uint32_t seed, std::uint32_t v) noexcept {
+        return seed ^ (v + 0x9e3779b9u + (seed << 6u) + (seed >> 2u));
+    }
+
+    constexpr std::uint32_t reverse_bits(std::uint32_t x) noexcept {
+        x = ((x >> 1u) & 0x55555555u) | ((x & 0x55555555u) << 1u);
+        x = ((x >> 2u) & 0x33333333u) | ((x & 0x33333333u) << 2u);
+        x = ((x >> 4u) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4u);
+        x = ((x >> 8u) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8u);
+        return (x >> 16u) | (x << 16u);
+    }
+
+    //Kensler's hash-based permutation of [0, length): cycle-walks a bijection
+    //on the next power of two until it lands inside the range.
+    std::uint32_t permute(std::uint32_t i, std::uint32_t length, std::uint32_t pattern) noexcept {
+        auto w = length - 1u;
+        w |= w >> 1u;
+        w |= w >> 2u;
+        w |= w >> 4u;
+        w |= w >> 8u;
+        w |= w >> 16u;
+        do {
+            i ^= pattern;
+            i *= 0xe170893du;
+            i ^= pattern >> 16u;
+            i ^= (i & w) >> 4u;
+            i ^= pattern >> 8u;
+            i *= 0x0929eb3fu;
+            i ^= pattern >> 23u;
+            i ^= (i & w) >> 1u;
+            i *= 1u | pattern >> 27u;
+            i *= 0x6935fa69u;
+            i ^= (i & w) >> 11u;
+            i *= 0x74dcb303u;
+            i ^= (i & w) >> 2u;
+            i *= 0x9e501cc3u;
+            i ^= (i & w) >> 2u;
+            i *= 0xc860a3dfu;
+            i &= w;
+            i ^= i >> 5u;
+        } while(i >= length);
+        return (i + pattern) % length;
+    }
+
+    //Kensler's jitter: a float in [0, 1) from a sample index and a pattern.
+    float jitter(std::uint32_t i, std::uint32_t pattern) noexcept {
+        i ^= pattern;
+        i ^= i >> 17u;
+        i ^= i >> 10u;
+        i *= 0xb36534e5u;
+        i ^= i >> 12u;
+        i ^= i >> 21u;
+        i *= 0x93fc4795u;
+        i ^= 0xdf6e307fu;
+        i ^= i >> 17u;
+        i *= 1u | pattern >> 18u;
+        return to_unit_float(i);
+    }
+
+    //Direction numbers of the first four Sobol dimensions, from the primitive
+    //polynomials and initial numbers of Joe and Kuo's new-joe-kuo-6.21201.
+    //Dimension 0 is the van der Corput sequence.
+    using SobolMatrix = std::array<std::uint32_t, 32>;
+
+    constexpr SobolMatrix make_sobol_matrix(std::uint32_t degree, std::uint32_t coefficients, std::array<std::uint32_t, 3> initial) {
+        SobolMatrix v{};
+        for(std::uint32_t i = 0; i < 32u; ++i) {
+            if(degree == 0u) {
+                v[i] = 1u << (31u - i);
+            } else if(i < degree) {
+                v[i] = initial[i] << (31u - i);
+            } else {
+                v[i] = v[i - degree] ^ (v[i - degree] >> degree);
+                for(std::uint32_t k = 1; k < degree; ++k) {
+                    if((coefficients >> (degree - 1u - k)) & 1u) {
+                        v[i] ^= v[i - k];
+                    }
+                }
+            }
+        }
+        return v;
+    }
+
+    constexpr std::array<SobolMatrix, 4> sobol_matrices{
+        make_sobol_matrix(0u, 0u, {})
+        ,make_sobol_matrix(1u, 0u, {1u})
+        ,make_sobol_matrix(2u, 1u, {1u, 3u})
+        ,make_sobol_matrix(3u, 1u, {1u, 3u, 1u})
+    };
+    static_assert(sobol_matrices[1][1] == 0xc0000000u, "Sobol dimension 1 starts 0, 1/2, 3/4, 1/4.");
+
+    //The matrix-vector product of a Sobol dimension a byte of the index at a
+    //time, with the index and the result bit-reversed, the form the Owen
+    //scramble below works in: table[dimension][byte][b] is the XOR of the
+    //reversed direction numbers of the set bits of b, read as bits
+    //31 - 8 * byte down of the index. 16 KB, built at compile time.
+    using SobolTable = std::array<std::array<std::array<std::uint32_t, 256>, 4>, 4>;
+
+    constexpr SobolTable make_sobol_table() {
+        SobolTable table{};
+        for(std::size_t d = 0; d < 4; ++d) {
+            for(std::size_t byte = 0; byte < 4; ++byte) {
+                for(std::uint32_t b = 0; b < 256u; ++b) {
+                    std::uint32_t x = 0;
+                    for(std::uint32_t bit = 0; bit < 8u; ++bit) {
+                        if((b >> bit) & 1u) {
+                            x ^= reverse_bits(sobol_matrices[d][31u - (byte * 8u + bit)]);
+                        }
+                    }
+                    table[d][byte][b] = x;
+                }
+            }
+        }
+        return table;
+    }
+
+    constexpr SobolTable sobol_table = make_sobol_table();
+
+    std::uint32_t reversed_sobol(std::uint32_t reversed_index, std::uint32_t dimension) noexcept {
+        const auto& t = sobol_table[dimension];
+        return t[0][reversed_index & 0xffu] ^ t[1][(reversed_index >> 8u) & 0xffu] ^ t[2][(reversed_index >> 16u) & 0xffu] ^ t[3][reversed_index >> 24u];
+    }
+
+    //Nested uniform (Owen) scramble of a bit-reversed value: flipping each
+    //bit may only depend on the bits above it in the original order, which is
+    //a hash in which every bit only affects higher ones once reversed.
+    //Laine-Karras style, constants by Nathan Vegdahl.
+    std::uint32_t reversed_owen_scramble(std::uint32_t x, std::uint32_t seed) noexcept {
+        x ^= x * 0x3d20adeau;
+        x += seed;
+        x *= (seed >> 16u) | 1u;
+        x ^= x * 0x05526c56u;
+        x ^= x * 0x53a22864u;
+        return x;
+    }
+
+    //Dimension `dimension` of the point at `index` of a scrambled 4D Sobol set.
+    //The index is shuffled with the set's seed, each dimension scrambled with
+    //its own. Everything in between stays bit-reversed.
+    float scrambled_sobol(std::uint32_t index, std::uint32_t dimension, std::uint64_t seed) noexcept {
+        const auto component = dimension % sample_dimensions_per_event;
+        const auto shuffled = reversed_owen_scramble(reverse_bits(index), static_cast<std::uint32_t>(seed));
+        const auto point = reversed_owen_scramble(reversed_sobol(shuffled, component), hash_combine(static_cast<std::uint32_t>(seed >> 32u), component));
+        return to_unit_float(reverse_bits(point));
+    }
+
+    //Interleaves the low 32 bits of x and y, x in the even bits.
+    std::uint64_t morton_index(std::uint64_t x, std::uint64_t y) noexcept {
+        const auto spread = [](std::uint64_t v) {
+            v &= 0xffffffffull;
+            v = (v | (v << 16u)) & 0x0000ffff0000ffffull;
+            v = (v | (v << 8u)) & 0x00ff00ff00ff00ffull;
+            v = (v | (v << 4u)) & 0x0f0f0f0f0f0f0f0full;
+            v = (v | (v << 2u)) & 0x3333333333333333ull;
+            v = (v | (v << 1u)) & 0x5555555555555555ull;
+            return v;
+        };
+        return spread(x) | (spread(y) << 1u);
+    }
+
+}
+
+StratifiedSampler::StratifiedSampler(std::uint64_t seed, int samples_per_pixel) noexcept
+    : _seed{seed}
+    , _sample_count{static_cast<std::uint32_t>((std::max)(samples_per_pixel, 1))}
+{
+    _columns = (std::max)(1u, static_cast<std::uint32_t>(std::sqrt(static_cast<float>(_sample_count))));
+    _rows = (_sample_count + _columns - 1u) / _columns;
+}
+
+float StratifiedSampler::get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept {
+    //Sample indices wrap at 2^32.
+    const auto sample = static_cast<std::uint32_t>(sample_index);
+    const auto run = sample / _sample_count;
+    const auto pattern = static_cast<std::uint32_t>(mix_bits(_seed ^ (pixel_index * 0x9e3779b97f4a7c15ull) ^ (static_cast<std::uint64_t>(run) << 32u) ^ (dimension / 2u)));
+    const auto s = permute(sample - run * _sample_count, _sample_count, pattern * 0x51633e2du);
+    const auto column = s % _columns;
+    const auto row = s / _columns;
+    //The sample's cell in the grid is (column, row); within it, each axis is
+    //offset to the stratum the other axis's permutation assigns.
+    const auto value = dimension % 2u == 0u
+        ? (column + (permute(row, _rows, pattern * 0x02e5be93u) + jitter(s, pattern * 0x967a889bu)) / _rows) / _columns
+        : (row + (permute(column, _columns, pattern * 0x68bc21ebu) + jitter(s, pattern * 0x368cc8b7u)) / _columns) / _rows;
+    return (std::min)(value, one_minus_epsilon);
+}
+
+SobolSampler::SobolSampler(std::uint64_t seed) noexcept
+    : _seed{seed} {
+    /* DO NOTHING */
+}
+
+float SobolSampler::get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept {
+    //Sample indices past 2^32 start an independently scrambled copy.
+    const auto set = mix_bits(_seed ^ (pixel_index * 0x9e3779b97f4a7c15ull) ^ ((sample_index >> 32u) * 0xbf58476d1ce4e5b9ull) ^ (dimension / sample_dimensions_per_event));
+    return scrambled_sobol(static_cast<std::uint32_t>(sample_index), dimension, set);
+}
+
+BlueNoiseSampler::BlueNoiseSampler(std::uint64_t seed, int image_width, int samples_per_pixel) noexcept
+    : _seed{seed}
+    , _image_width{static_cast<std::uint64_t>((std::max)(image_width, 1))}
+{
+    while((1ull << _block_bits) < static_cast<std::uint64_t>(samples_per_pixel)) {
+        ++_block_bits;
+    }
+}
+
+float BlueNoiseSampler::get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept {
+    const auto block_size = 1ull << _block_bits;
+    //32-bit division where it will do; it is several times faster.
+    const auto morton = pixel_index <= 0xffffffffull
+        ? morton_index(static_cast<std::uint32_t>(pixel_index) % static_cast<std::uint32_t>(_image_width), static_cast<std::uint32_t>(pixel_index) / static_cast<std::uint32_t>(_image_width))
+        : morton_index(pixel_index % _image_width, pixel_index / _image_width);
+    const auto index = (morton << _block_bits) | (sample_index & (block_size - 1u));
+    //The Owen scramble maps aligned blocks of the index to aligned blocks, so
+    //every 2^k by 2^k square of pixels keeps a contiguous, well-stratified run
+    //of the sequence. Bits past 32 and samples past the block only pick the
+    //scramble; they are far apart on the image or in the sample order.
+    const auto set = mix_bits(_seed ^ ((index >> 32u) * 0x9e3779b97f4a7c15ull) ^ ((sample_index >> _block_bits) * 0xbf58476d1ce4e5b9ull) ^ (dimension / sample_dimensions_per_event));
+    return scrambled_sobol(static_cast<std::uint32_t>(index), dimension, set);
+}
+
+std::ostream& operator<<(std::ostream& out, SamplerType type) {
+    switch(type) {
+    case SamplerType::Independent: return out << "independent";
+    case SamplerType::Stratified: return out << "stratified";
+    case SamplerType::Sobol: return out << "sobol";
+    case SamplerType::BlueNoise: return out << "blue-noise";
+    default: return out << "unknown";
+    }
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "Random.hpp"
+
+#include <cstdint>
+#include <ostream>
+
+//Where the random numbers of a sample come from.
+enum class SamplerType : std::uint32_t {
+    Independent   //Every number from the path's PCG32 stream, see seed_thread_rng.
+    ,Stratified   //Correlated multi-jittered strata over each run of samples_per_pixel samples.
+    ,Sobol        //Owen-scrambled Sobol points, scrambled independently for every pixel.
+    ,BlueNoise    //Owen-scrambled Sobol points shared out among neighboring pixels.
+};
+
+//A path draws its numbers event by event: event 0 is the camera ray (pixel
+//jitter, then the lens), event k the scatter at the end of the path's k-th ray
+//(the new direction, then roulette). Each event reads its own run of
+//dimensions, so dimension d of every sample answers the same question and the
+//sampler can stratify it.
+constexpr std::uint32_t sample_dimensions_per_event = 4;
+
+//A sequence of points in [0, 1)^n for every pixel. get() is a pure function
+//of its arguments, so images stay independent of thread count and tile order.
+class Sampler {
+public:
+    virtual float get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept = 0;
+    virtual ~Sampler() noexcept = default;
+protected:
+private:
+};
+
+//Dimensions are stratified in pairs (2d, 2d + 1) with Kensler's correlated
+//multi-jittered pattern: every run of samples_per_pixel samples of a pixel
+//falls one per cell of a jittered 2D grid and one per 1D stratum of either axis.
+//Each run and each pair has its own permutation.
+class StratifiedSampler : public Sampler {
+public:
+    StratifiedSampler(std::uint64_t seed, int samples_per_pixel) noexcept;
+    float get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept override;
+protected:
+private:
+    std::uint64_t _seed{0};
+    std::uint32_t _sample_count{1};
+    std::uint32_t _columns{1};
+    std::uint32_t _rows{1};
+};
+
+//The first four dimensions of the Sobol sequence, Owen-scrambled with a hash
+//(Burley, "Practical Hash-based Owen Scrambling", 2020). Every event reads a
+//fresh 4D set with its own scramble, and sample indices are shuffled by a
+//nested uniform scramble too. Any power-of-two prefix of a pixel's samples is
+//well stratified, so the sampler suits adaptive and progressive sampling.
+class SobolSampler : public Sampler {
+public:
+    explicit SobolSampler(std::uint64_t seed) noexcept;
+    float get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept override;
+protected:
+private:
+    std::uint64_t _seed{0};
+};
+
+//Scrambled Sobol points as SobolSampler draws them, but with one scramble for
+//the whole image: the pixels take consecutive blocks of one sequence in Morton
+//order (Ahmed and Wonka, "Screen-Space Blue-Noise Diffusion of Monte Carlo
+//Sampling Error via Hierarchical Ordering of Pixels", 2020). Neighboring pixels
+//then hold complementary parts of a well-stratified set, which pushes the error
+//left at low sample counts towards high frequencies that the eye and the
+//denoiser average away.
+class BlueNoiseSampler : public Sampler {
+public:
+    BlueNoiseSampler(std::uint64_t seed, int image_width, int samples_per_pixel) noexcept;
+    float get(std::uint64_t pixel_index, std::uint64_t sample_index, std::uint32_t dimension) const noexcept override;
+protected:
+private:
+    std::uint64_t _seed{0};
+    std::uint64_t _image_width{1};
+    //Each pixel's block of the sequence is samples_per_pixel rounded up to a power of two.
+    std::uint32_t _block_bits{0};
+};
+
+//Identifies one path and where its random numbers come from.
+struct SamplePath {
+    const Sampler* sampler{nullptr}; //nullptr: SamplerType::Independent.
+    std::uint64_t key{0};            //See make_path_key.
+    std::uint64_t pixel_index{0};
+    std::uint64_t sample_index{0};
+};
+
+//The dimensions random_float() reads on the calling thread before it falls
+//back to the thread's generator.
+struct SampleStream {
+    const Sampler* sampler{nullptr};
+    std::uint64_t pixel_index{0};
+    std::uint64_t sample_index{0};
+    std::uint32_t dimension{0};
+    std::uint32_t dimension_end{0};
+};
+
+inline SampleStream& thread_sample_stream() noexcept {
+    static thread_local SampleStream stream{};
+    return stream;
+}
+
+//Restarts random_float() on the calling thread for one event of the path. The
+//first sample_dimensions_per_event numbers come from the path's sampler, if it
+//has one, and the rest from a PCG32 stream keyed on the path and event.
+inline void seed_sample_path(const SamplePath& path, std::uint32_t event) noexcept {
+    seed_thread_rng(path.key, event);
+    const auto first = event * sample_dimensions_per_event;
+    thread_sample_stream() = SampleStream{path.sampler, path.pixel_index, path.sample_index, first, path.sampler ? first + sample_dimensions_per_event : first};
+}
+
+//Points random_float() on the calling thread back at its generator alone. Call
+//before the sampler a path used goes away.
+inline void end_sample_path() noexcept {
+    thread_sample_stream() = SampleStream{};
+}
+
+std::ostream& operator<<(std::ostream& out, SamplerType type);
@@ -0,0 +1,153 @@
+#include "Scene.hpp"
+
+#include "MathUtils.hpp"
+#include "Sphere3.hpp"
+#include "TriangleMesh.hpp"
+
+#include <bit>
+#include <cstddef>
+
+namespace {
+
+    //64-bit FNV-1a, fed a word at a time.
+    class Fingerprint {
+    public:
+        void add(std::uint32_t word) noexcept {
+            for(int byte = 0; byte < 4; ++byte) {
+                _hash = (_hash ^ ((word >> (8 * byte)) & 0xFFu)) * 0x100000001B3ull;
+            }
+        }
+        void add(float value) noexcept {
+            add(std::bit_cast<std::uint32_t>(value));
+        }
+        void add(const Vector3& v) noexcept {
+            add(v.x());
+            add(v.y());
+            add(v.z());
+        }
+        std::uint64_t value() const noexcept {
+            return _hash;
+        }
+
+    protected:
+    private:
+        std::uint64_t _hash{0xCBF29CE484222325ull};
+    };
+
+}
+
+std::size_t primitive_count(const Scene& scene) {
+    return scene.world.objects().size() + scene.spheres.size();
+}
+
+std::uint64_t scene_fingerprint(const Scene& scene) {
+    Fingerprint fingerprint{};
+    const auto& camera = scene.camera;
+    fingerprint.add(camera.look_from);
+    fingerprint.add(camera.look_at);
+    fingerprint.add(camera.up);
+    fingerprint.add(camera.vfov_degrees);
+    fingerprint.add(camera.aperture);
+    fingerprint.add(camera.focus_distance);
+    fingerprint.add(static_cast<std::uint32_t>(scene.materials.size()));
+    for(std::size_t i = 0; i < scene.materials.size(); ++i) {
+        const auto& material = scene.materials[static_cast<MaterialId>(i)];
+        fingerprint.add(static_cast<std::uint32_t>(material.type));
+        fingerprint.add(material.color);
+        fingerprint.add(material.roughness);
+        fingerprint.add(material.metallic);
+        fingerprint.add(material.refractionIndex);
+    }
+    //Objects other than spheres and meshes only count by their position in the list.
+    fingerprint.add(static_cast<std::uint32_t>(scene.world.objects().size()));
+    for(const auto* object : scene.world.objects()) {
+        if(const auto* sphere = dynamic_cast<const Sphere3*>(object)) {
+            fingerprint.add(sphere->center);
+            fingerprint.add(sphere->radius);
+            fingerprint.add(sphere->material_id);
+        } else if(const auto* mesh = dynamic_cast<const TriangleMesh*>(object)) {
+            fingerprint.add(static_cast<std::uint32_t>(mesh->vertex_count()));
+            for(std::uint32_t v = 0; v < mesh->vertex_count(); ++v) {
+                fingerprint.add(mesh->vertex(v));
+            }
+            for(const auto index : mesh->indices()) {
+                fingerprint.add(index);
+            }
+            fingerprint.add(mesh->material_id());
+        }
+    }
+    fingerprint.add(static_cast<std::uint32_t>(scene.spheres.size()));
+    for(std::size_t i = 0; i < scene.spheres.size(); ++i) {
+        fingerprint.add(scene.spheres.center(i));
+        fingerprint.add(scene.spheres.radius(i));
+        fingerprint.add(scene.spheres.material_id(i));
+    }
+    return fingerprint.value();
+}
+
+StaticSphereScene make_static_scene(const SphereBatch& spheres, bool build_bvh) {
+    StaticSphereScene scene{};
+    scene.reserve<Sphere3>(spheres.size());
+    for(std::size_t i = 0; i < spheres.size(); ++i) {
+        scene.add<Sphere3>(spheres.center(i), spheres.radius(i), spheres.material_id(i));
+    }
+    if(build_bvh) {
+        scene.build_bvh();
+    }
+    return scene;
+}
+
+Scene random_scene() {
+    Scene scene{};
+    auto& world = scene.world;
+    auto& materials = scene.materials;
+    //The ground, at most 22 x 22 small spheres and the three large ones.
+    constexpr std::size_t max_sphere_count = 1 + 22 * 22 + 3;
+    scene.arena.reserve<Sphere3>(max_sphere_count);
+    world.reserve(max_sphere_count);
+
+    const auto ground_material = materials.add(make_lambertian(MaterialDesc{ Color{0.5f, 0.5f, 0.5f} }));
+    world.add(scene.arena.create<Sphere3>(Point3{0.0f, -1000.0f, 0.0f}, 1000.0f, ground_material));
+
+    for(int a = -11; a < 11; ++a) {
+        for(int b = -11; b < 11; ++b) {
+            const auto choose_mat = random_float();
+            const auto center = Point3{a + 0.9f * random_float(), 0.2f, b + 0.9f * random_float()};
+
+            if((center - Point3{4.0f, 0.2f, 0.0f}).length() > 0.9f) {
+                Material material{};
+                MaterialDesc desc{};
+                if(choose_mat < 0.8f) {
+                    desc.color = Color::random() * Color::random();
+                    material = make_lambertian(desc);
+                } else if(choose_mat < 0.95f) {
+                    desc.color = Color::random(0.5f, 1.0f);
+                    desc.roughness = random_float(0.0f, 0.5f);
+                    desc.metallic = 1.0f;
+                    material = make_metal(desc);
+                } else {
+                    desc.refractionIndex = 1.5f;
+                    desc.color = Color{1.0f, 1.0f, 1.0f};
+                    desc.roughness = 0.0f;
+                    material = make_dielectric(desc);
+                }
+                world.add(scene.arena.create<Sphere3>(center, 0.2f, materials.add(material)));
+            }
+        }
+    }
+
+    const auto glass = materials.add(make_dielectric(MaterialDesc{ Color{1.0f, 1.0f, 1.0f}, 0.0f, 0.0f, 1.5f }));
+    const auto lambertian = materials.add(make_lambertian(MaterialDesc{ Color{0.4f, 0.2f, 0.1f}}));
+    const auto metal = materials.add(make_metal(MaterialDesc{ Color{0.7f, 0.6f, 0.5f}, 0.0f, 1.0f}));
+
+    world.add(scene.arena.create<Sphere3>(Point3{0.0f, 1.0f, 0.0f}, 1.0f, glass));
+    world.add(scene.arena.create<Sphere3>(Point3{-4.0f, 1.0f, 0.0f}, 1.0f, lambertian));
+    world.add(scene.arena.create<Sphere3>(Point3{4.0f, 1.0f, 0.0f}, 1.0f, metal));
+
+    return scene;
+}
+
+//CameraDesc's defaults are this camera.
+Camera random_scene_camera(float aspect_ratio) {
+    return make_camera(CameraDesc{}, aspect_ratio);
+}
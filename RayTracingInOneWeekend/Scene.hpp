@@ -0,0 +1,57 @@
+#pragma once
+
+#include "Animation.hpp"
+#include "Bvh.hpp"
+#include "Camera.hpp"
+#include "HittableList.hpp"
+#include "Material.hpp"
+#include "SceneArena.hpp"
+#include "SphereBatch.hpp"
+#include "StaticScene.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class MappedFile;
+
+//Everything a render needs to know about the world: its objects, the
+//materials they refer to by MaterialId, and where the camera stands. The
+//objects in world live in arena, declared first so it is destroyed last.
+//
+//Scenes read from files hold their spheres in `spheres` instead of as objects
+//in `world`, which stays empty. A compiled scene's spheres and prebuilt BVH
+//are used in place from the mapped file that `storage` keeps alive.
+struct Scene {
+    SceneArena arena{};
+    HittableList world{};
+    MaterialTable materials{};
+    CameraDesc camera{};
+    SphereBatch spheres{};
+    std::shared_ptr<const Bvh> bvh{};
+    std::shared_ptr<const MappedFile> storage{};
+    //What a sequence render animates, sorted by time and by sphere.
+    std::vector<CameraKey> camera_keys{};
+    std::vector<SphereMotion> sphere_motions{};
+};
+
+//Objects in world plus spheres.
+std::size_t primitive_count(const Scene& scene);
+
+//A hash of what the scene renders: its camera, materials, spheres and mesh
+//triangles. Two loads of the same file give the same fingerprint, and any edit
+//that changes the image almost surely changes it. Reads every primitive, so
+//for a compiled scene it pages the whole file in.
+std::uint64_t scene_fingerprint(const Scene& scene);
+
+//The spheres in a StaticSphereScene, with its BVH built if build_bvh is set.
+StaticSphereScene make_static_scene(const SphereBatch& spheres, bool build_bvh);
+
+//The cover scene of the book: a large ground sphere, three feature spheres and
+//a field of small random ones. The layout comes from random_float(), so it is
+//the same on every run as long as nothing draws random numbers before it.
+Scene random_scene();
+
+//The camera the cover image is rendered with.
+Camera random_scene_camera(float aspect_ratio);
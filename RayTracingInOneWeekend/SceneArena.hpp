@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <typeindex>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+//Owns the primitives of a scene. Objects of each type are placed back to back
+//in large blocks, so a million spheres are a handful of allocations with no
+//reference counts or control blocks between them. Objects never move once
+//created: HittableList and Bvh refer to them by plain pointer, and the arena
+//must outlive them. Everything is destroyed and freed with the arena.
+class SceneArena {
+public:
+    SceneArena() = default;
+    SceneArena(const SceneArena& other) = delete;
+    SceneArena(SceneArena&& other) noexcept = default;
+    SceneArena& operator=(const SceneArena& other) = delete;
+    SceneArena& operator=(SceneArena&& other) noexcept = default;
+    ~SceneArena() = default;
+
+    template<typename T, typename... Args>
+    T* create(Args&&... args);
+
+    //Makes room for count more objects of type T in one block, so that the
+    //next count calls to create<T> place them contiguously.
+    template<typename T>
+    void reserve(std::size_t count);
+
+    std::size_t object_count() const noexcept;
+    //Bytes of all blocks, used or not.
+    std::size_t bytes_reserved() const noexcept;
+    std::size_t block_count() const noexcept;
+
+protected:
+private:
+    class PoolBase {
+    public:
+        explicit PoolBase(std::type_index type) noexcept
+        : type{type} {
+            /* DO NOTHING */
+        }
+        virtual ~PoolBase() noexcept = default;
+
+        virtual std::size_t object_count() const noexcept = 0;
+        virtual std::size_t bytes_reserved() const noexcept = 0;
+        virtual std::size_t block_count() const noexcept = 0;
+
+        std::type_index type;
+    protected:
+    private:
+    };
+
+    template<typename T>
+    class Pool : public PoolBase {
+    public:
+        Pool() noexcept
+        : PoolBase{typeid(T)} {
+            /* DO NOTHING */
+        }
+        Pool(const Pool& other) = delete;
+        Pool(Pool&& other) = delete;
+        Pool& operator=(const Pool& other) = delete;
+        Pool& operator=(Pool&& other) = delete;
+
+        ~Pool() noexcept {
+            std::allocator<T> allocator{};
+            for(auto block = m_blocks.rbegin(); block != m_blocks.rend(); ++block) {
+                std::destroy_n(block->data, block->size);
+                allocator.deallocate(block->data, block->capacity);
+            }
+        }
+
+        template<typename... Args>
+        T* create(Args&&... args) {
+            if(m_blocks.empty() || m_blocks.back().size == m_blocks.back().capacity) {
+                //Geometric growth keeps small scenes small and large ones at few blocks.
+                add_block(m_blocks.empty() ? min_block_objects : (std::min)((std::max)(m_blocks.back().capacity * 2, min_block_objects), max_block_objects));
+            }
+            auto& block = m_blocks.back();
+            auto* object = std::construct_at(block.data + block.size, std::forward<Args>(args)...);
+            ++block.size;
+            return object;
+        }
+
+        void reserve(std::size_t count) {
+            if(count == 0) {
+                return;
+            }
+            if(m_blocks.empty() || m_blocks.back().capacity - m_blocks.back().size < count) {
+                add_block(count);
+            }
+        }
+
+        std::size_t object_count() const noexcept override {
+            std::size_t count = 0;
+            for(const auto& block : m_blocks) {
+                count += block.size;
+            }
+            return count;
+        }
+
+        std::size_t bytes_reserved() const noexcept override {
+            std::size_t bytes = 0;
+            for(const auto& block : m_blocks) {
+                bytes += block.capacity * sizeof(T);
+            }
+            return bytes;
+        }
+
+        std::size_t block_count() const noexcept override {
+            return m_blocks.size();
+        }
+
+    protected:
+    private:
+        static constexpr std::size_t min_block_objects = 64;
+        static constexpr std::size_t max_block_objects = std::size_t{1} << 16u;
+
+        struct Block {
+            T* data{nullptr};
+            std::size_t size{0};
+            std::size_t capacity{0};
+        };
+
+        void add_block(std::size_t capacity) {
+            m_blocks.reserve(m_blocks.size() + 1);
+            m_blocks.emplace_back(Block{std::allocator<T>{}.allocate(capacity), 0, capacity});
+        }
+
+        std::vector<Block> m_blocks{};
+    };
+
+    template<typename T>
+    Pool<T>& pool();
+
+    //One per type; scenes have a few, so a linear search beats a map.
+    std::vector<std::unique_ptr<PoolBase>> m_pools{};
+};
+
+template<typename T, typename... Args>
+T* SceneArena::create(Args&&... args) {
+    return pool<T>().create(std::forward<Args>(args)...);
+}
+
+template<typename T>
+void SceneArena::reserve(std::size_t count) {
+    pool<T>().reserve(count);
+}
+
+template<typename T>
+SceneArena::Pool<T>& SceneArena::pool() {
+    const auto type = std::type_index{typeid(T)};
+    for(const auto& pool : m_pools) {
+        if(pool->type == type) {
+            return static_cast<Pool<T>&>(*pool);
+        }
+    }
+    return static_cast<Pool<T>&>(*m_pools.emplace_back(std::make_unique<Pool<T>>()));
+}
+
+inline std::size_t SceneArena::object_count() const noexcept {
+    std::size_t count = 0;
+    for(const auto& pool : m_pools) {
+        count += pool->object_count();
+    }
+    return count;
+}
+
+inline std::size_t SceneArena::bytes_reserved() const noexcept {
+    std::size_t bytes = 0;
+    for(const auto& pool : m_pools) {
+        bytes += pool->bytes_reserved();
+    }
+    return bytes;
+}
+
+inline std::size_t SceneArena::block_count() const noexcept {
+    std::size_t count = 0;
+    for(const auto& pool : m_pools) {
+        count += pool->block_count();
+    }
+    return count;
+}
@@ -0,0 +1,598 @@
+#include "SceneFile.hpp"
+
+#include "MappedFile.hpp"
+#include "ObjLoader.hpp"
+#include "Sphere3.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleMesh.hpp"
+
+#include <array>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+    constexpr std::uint64_t array_alignment = 64;
+
+    struct MaterialRecord {
+        std::uint32_t type{0};
+        float color[3]{};
+        float roughness{0.0f};
+        float metallic{0.0f};
+        float refraction_index{0.0f};
+    };
+    static_assert(sizeof(MaterialRecord) == 28, "MaterialRecord is written to disk as is.");
+
+    struct NodeRecord {
+        float minimum[3]{};
+        float maximum[3]{};
+        std::uint32_t offset{0};
+        std::uint16_t count{0};
+        std::uint16_t axis{0};
+    };
+    static_assert(sizeof(NodeRecord) == 32, "NodeRecord is written to disk as is.");
+
+    Material make_material_of_type(Material::Type type, const MaterialDesc& desc) {
+        switch(type) {
+        case Material::Type::Lambertian: return make_lambertian(desc);
+        case Material::Type::Metal: return make_metal(desc);
+        case Material::Type::Glass: return make_dielectric(desc);
+        default: return make_material(desc);
+        }
+    }
+
+    const char* material_type_name(Material::Type type) {
+        switch(type) {
+        case Material::Type::Lambertian: return "lambertian";
+        case Material::Type::Metal: return "metal";
+        case Material::Type::Glass: return "dielectric";
+        default: return "none";
+        }
+    }
+
+    //All spheres of the scene in one batch it owns, world's first.
+    SphereBatch collect_spheres(const Scene& scene) {
+        SphereBatch from_world{};
+        if(!make_sphere_batch(scene.world, from_world)) {
+            throw std::runtime_error("Only scenes made of spheres can be written to a file");
+        }
+        if(scene.spheres.size() == 0) {
+            return from_world;
+        }
+        from_world.reserve(from_world.size() + scene.spheres.size());
+        for(std::size_t i = 0; i < scene.spheres.size(); ++i) {
+            from_world.add(scene.spheres.center(i), scene.spheres.radius(i), scene.spheres.material_id(i));
+        }
+        return from_world;
+    }
+
+    //Splits a line into whitespace-separated words and parses them in order,
+    //reporting errors with the file and line they came from.
+    class LineReader {
+    public:
+        LineReader(std::string_view line, const std::string& path, std::size_t line_number)
+        : _rest{line}
+        , _path{path}
+        , _line_number{line_number} {
+            /* DO NOTHING */
+        }
+
+        bool done() {
+            skip_space();
+            return _rest.empty();
+        }
+
+        std::string_view word() {
+            skip_space();
+            if(_rest.empty()) {
+                fail("unexpected end of line");
+            }
+            auto end = std::size_t{0};
+            while(end < _rest.size() && _rest[end] != ' ' && _rest[end] != '\t' && _rest[end] != '\r') {
+                ++end;
+            }
+            const auto result = _rest.substr(0, end);
+            _rest.remove_prefix(end);
+            return result;
+        }
+
+        float number() {
+            const auto text = word();
+            float value{};
+            const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if(error != std::errc{} || end != text.data() + text.size()) {
+                fail("'" + std::string{text} + "' is not a number");
+            }
+            return value;
+        }
+
+        Vector3 vector() {
+            const auto x = number();
+            const auto y = number();
+            const auto z = number();
+            return Vector3{x, y, z};
+        }
+
+        [[noreturn]] void fail(const std::string& message) const {
+            throw std::runtime_error(_path + ':' + std::to_string(_line_number) + ": " + message);
+        }
+
+    protected:
+    private:
+        void skip_space() {
+            while(!_rest.empty() && (_rest.front() == ' ' || _rest.front() == '\t' || _rest.front() == '\r')) {
+                _rest.remove_prefix(1);
+            }
+        }
+
+        std::string_view _rest{};
+        const std::string& _path;
+        std::size_t _line_number{0};
+    };
+
+    //Shortest text that reads back as the same float.
+    void append_number(std::string& out, float value) {
+        std::array<char, 32> buffer{};
+        const auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+        out.append(buffer.data(), end);
+    }
+
+    void append_vector(std::string& out, const Vector3& v) {
+        append_number(out, v.x());
+        out += ' ';
+        append_number(out, v.y());
+        out += ' ';
+        append_number(out, v.z());
+    }
+
+    std::uint64_t align_up(std::uint64_t offset) {
+        return (offset + array_alignment - 1) / array_alignment * array_alignment;
+    }
+
+    template<typename T>
+    void write_array_at(std::ofstream& file, std::uint64_t& position, std::uint64_t offset, const std::vector<T>& values) {
+        static constexpr char zeros[array_alignment]{};
+        file.write(zeros, static_cast<std::streamsize>(offset - position));
+        file.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+        position = offset + values.size() * sizeof(T);
+    }
+
+    template<typename T>
+    const T* array_in(const MappedFile& file, std::uint64_t offset, std::uint64_t count, const std::string& path) {
+        if(offset % alignof(T) != 0 || offset > file.size() || count > (file.size() - offset) / sizeof(T)) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+        return reinterpret_cast<const T*>(file.data() + offset);
+    }
+
+    //Checks in one pass that the nodes form a tree traverse_bvh can walk: every
+    //child comes after its parent and has no other parent, leaves stay inside
+    //the spheres, split axes are axes, and no path is deeper than the
+    //traversal stack. Throws std::runtime_error as array_in does.
+    void check_bvh_nodes(const NodeRecord* records, std::uint64_t node_count, std::uint64_t sphere_count, const std::string& path) {
+        //Interior nodes above each node: at most the stack entries a walk holds on reaching it.
+        std::vector<std::uint8_t> depths(static_cast<std::size_t>(node_count), 0);
+        std::vector<bool> has_parent(static_cast<std::size_t>(node_count), false);
+        const auto adopt = [&](std::uint64_t child, std::uint8_t depth) {
+            if(child >= node_count || has_parent[child]) {
+                return false;
+            }
+            has_parent[child] = true;
+            depths[child] = depth;
+            return true;
+        };
+        for(std::uint64_t i = 0; i < node_count; ++i) {
+            const auto& record = records[i];
+            const auto depth = static_cast<std::uint8_t>(depths[i] + 1u);
+            const auto valid = record.count == 0
+                             ? record.axis < 3 && depth <= bvh_max_depth && record.offset > i + 1 && adopt(i + 1, depth) && adopt(record.offset, depth)
+                             : record.offset + std::uint64_t{record.count} <= sphere_count;
+            if(!valid) {
+                throw std::runtime_error(path + " is truncated or corrupt");
+            }
+        }
+    }
+
+}
+
+Scene load_scene(const std::string& path) {
+    char magic[4]{};
+    {
+        std::ifstream file(path, std::ios_base::binary);
+        if(!file) {
+            throw std::runtime_error("Could not open scene " + path);
+        }
+        file.read(magic, sizeof(magic));
+    }
+    if(std::memcmp(magic, CompiledSceneHeader{}.magic, sizeof(magic)) == 0) {
+        return read_compiled_scene(path);
+    }
+    return read_scene_text(path);
+}
+
+Scene read_scene_text(const std::string& path) {
+    std::ifstream file(path, std::ios_base::binary);
+    if(!file) {
+        throw std::runtime_error("Could not open scene " + path);
+    }
+    const std::string text{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    Scene scene{};
+    std::unordered_map<std::string, MaterialId> material_ids{};
+    //Started by the first mesh statement; OBJ files are parsed on it.
+    std::unique_ptr<ThreadPool> pool{};
+    std::size_t line_number = 0;
+    for(std::size_t line_start = 0; line_start < text.size();) {
+        auto line_end = text.find('\n', line_start);
+        if(line_end == std::string::npos) {
+            line_end = text.size();
+        }
+        auto line = std::string_view{text}.substr(line_start, line_end - line_start);
+        line_start = line_end + 1;
+        ++line_number;
+        if(const auto comment = line.find('#'); comment != std::string_view::npos) {
+            line = line.substr(0, comment);
+        }
+        LineReader reader{line, path, line_number};
+        if(reader.done()) {
+            continue;
+        }
+        const auto statement = reader.word();
+        if(statement == "sphere") {
+            const auto center = reader.vector();
+            const auto radius = reader.number();
+            const auto name = std::string{reader.word()};
+            const auto found = material_ids.find(name);
+            if(found == material_ids.end()) {
+                reader.fail("unknown material '" + name + "'");
+            }
+            while(!reader.done()) {
+                const auto key = reader.word();
+                if(key == "move") {
+                    if(!scene.sphere_motions.empty() && scene.sphere_motions.back().sphere == scene.spheres.size()) {
+                        reader.fail("a sphere moves once");
+                    }
+                    scene.sphere_motions.emplace_back(SphereMotion{static_cast<std::uint32_t>(scene.spheres.size()), reader.vector()});
+                } else {
+                    reader.fail("unknown sphere key '" + std::string{key} + "'");
+                }
+            }
+            scene.spheres.add(center, radius, found->second);
+        } else if(statement == "mesh") {
+            const auto file_name = std::filesystem::path{reader.word()};
+            const auto name = std::string{reader.word()};
+            const auto found = material_ids.find(name);
+            if(found == material_ids.end()) {
+                reader.fail("unknown material '" + name + "'");
+            }
+            auto offset = Vector3{};
+            auto scale = 1.0f;
+            while(!reader.done()) {
+                const auto key = reader.word();
+                if(key == "translate") {
+                    offset = reader.vector();
+                } else if(key == "scale") {
+                    scale = reader.number();
+                } else {
+                    reader.fail("unknown mesh key '" + std::string{key} + "'");
+                }
+            }
+            if(!pool) {
+                pool = std::make_unique<ThreadPool>(ThreadPool::default_thread_count());
+            }
+            //Relative to the scene file, not the working directory.
+            const auto obj_path = file_name.is_absolute() ? file_name : std::filesystem::path{path}.parent_path() / file_name;
+            MeshBuffers buffers{};
+            try {
+                buffers = load_obj(obj_path.string(), *pool);
+            } catch(const std::runtime_error& e) {
+                reader.fail(e.what());
+            }
+            if(buffers.indices.empty()) {
+                reader.fail(obj_path.string() + " has no faces");
+            }
+            for(std::size_t i = 0; i < buffers.positions.size(); i += 3) {
+                buffers.positions[i + 0] = buffers.positions[i + 0] * scale + offset.x();
+                buffers.positions[i + 1] = buffers.positions[i + 1] * scale + offset.y();
+                buffers.positions[i + 2] = buffers.positions[i + 2] * scale + offset.z();
+            }
+            scene.world.add(scene.arena.create<TriangleMesh>(std::move(buffers), found->second));
+        } else if(statement == "material") {
+            auto name = std::string{reader.word()};
+            const auto type_name = reader.word();
+            const auto type = type_name == "lambertian" ? Material::Type::Lambertian
+                            : type_name == "metal" ? Material::Type::Metal
+                            : type_name == "dielectric" ? Material::Type::Glass
+                            : Material::Type::None;
+            if(type == Material::Type::None) {
+                reader.fail("unknown material type '" + std::string{type_name} + "', expected lambertian, metal or dielectric");
+            }
+            MaterialDesc desc{};
+            while(!reader.done()) {
+                const auto key = reader.word();
+                if(key == "color") {
+                    desc.color = reader.vector();
+                } else if(key == "roughness") {
+                    desc.roughness = reader.number();
+                } else if(key == "metallic") {
+                    desc.metallic = reader.number();
+                } else if(key == "ior") {
+                    desc.refractionIndex = reader.number();
+                } else {
+                    reader.fail("unknown material key '" + std::string{key} + "'");
+                }
+            }
+            if(!material_ids.emplace(std::move(name), scene.materials.add(make_material_of_type(type, desc))).second) {
+                reader.fail("material declared twice");
+            }
+        } else if(statement == "keyframe") {
+            auto key = scene.camera_keys.empty() ? CameraKey{0.0f, scene.camera.look_from, scene.camera.look_at} : scene.camera_keys.back();
+            key.time = reader.number();
+            if(!scene.camera_keys.empty() && key.time <= scene.camera_keys.back().time) {
+                reader.fail("keyframes must come in time order");
+            }
+            while(!reader.done()) {
+                const auto name = reader.word();
+                if(name == "look_from") {
+                    key.look_from = reader.vector();
+                } else if(name == "look_at") {
+                    key.look_at = reader.vector();
+                } else {
+                    reader.fail("unknown keyframe key '" + std::string{name} + "'");
+                }
+            }
+            scene.camera_keys.emplace_back(key);
+        } else if(statement == "camera") {
+            auto& camera = scene.camera;
+            while(!reader.done()) {
+                const auto key = reader.word();
+                if(key == "look_from") {
+                    camera.look_from = reader.vector();
+                } else if(key == "look_at") {
+                    camera.look_at = reader.vector();
+                } else if(key == "up") {
+                    camera.up = reader.vector();
+                } else if(key == "vfov") {
+                    camera.vfov_degrees = reader.number();
+                } else if(key == "aperture") {
+                    camera.aperture = reader.number();
+                } else if(key == "focus_distance") {
+                    camera.focus_distance = reader.number();
+                } else {
+                    reader.fail("unknown camera key '" + std::string{key} + "'");
+                }
+            }
+        } else {
+            reader.fail("unknown statement '" + std::string{statement} + "'");
+        }
+    }
+    //Meshes are objects in world, so the spheres join them there.
+    if(!scene.world.objects().empty()) {
+        const auto spheres = make_sphere_list(scene.spheres, scene.arena);
+        for(const auto* sphere : spheres.objects()) {
+            scene.world.add(sphere);
+        }
+        scene.spheres = SphereBatch{};
+    }
+    return scene;
+}
+
+Scene read_compiled_scene(const std::string& path) {
+    auto file = std::make_shared<const MappedFile>(path);
+    if(file->size() < sizeof(CompiledSceneHeader)) {
+        throw std::runtime_error(path + " is not a compiled scene");
+    }
+    CompiledSceneHeader header{};
+    std::memcpy(&header, file->data(), sizeof(header));
+    if(std::memcmp(header.magic, CompiledSceneHeader{}.magic, sizeof(header.magic)) != 0 || header.version != CompiledSceneHeader{}.version) {
+        throw std::runtime_error(path + " is not a compiled scene");
+    }
+    if(header.byte_order != CompiledSceneHeader{}.byte_order) {
+        throw std::runtime_error(path + " was compiled on a machine with the other byte order");
+    }
+    if(header.padding_entries < SphereBatch::lane_count) {
+        throw std::runtime_error(path + " was compiled for a narrower sphere kernel");
+    }
+
+    //The sphere geometry is only checked against the file's bounds: reading it
+    //here would page the whole file in, which is what mapping it avoids. The
+    //materials, material ids and nodes are read, as a bad index in them
+    //would have the render read out of bounds.
+    Scene scene{};
+    const auto padded = header.sphere_count + header.padding_entries;
+    const auto* materials = array_in<MaterialRecord>(*file, header.materials_offset, header.material_count, path);
+    const auto* center_x = array_in<float>(*file, header.center_x_offset, padded, path);
+    const auto* center_y = array_in<float>(*file, header.center_y_offset, padded, path);
+    const auto* center_z = array_in<float>(*file, header.center_z_offset, padded, path);
+    const auto* radius = array_in<float>(*file, header.radius_offset, padded, path);
+    const auto* material_ids = array_in<MaterialId>(*file, header.material_ids_offset, header.sphere_count, path);
+
+    for(std::uint64_t i = 0; i < header.sphere_count; ++i) {
+        if(material_ids[i] >= header.material_count) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+    }
+    for(std::uint64_t i = 0; i < header.material_count; ++i) {
+        const auto& record = materials[i];
+        if(record.type > static_cast<std::uint32_t>(Material::Type::Glass)) {
+            throw std::runtime_error(path + " is truncated or corrupt");
+        }
+        const auto desc = MaterialDesc{Color{record.color[0], record.color[1], record.color[2]}, record.roughness, record.metallic, record.refraction_index};
+        scene.materials.add(make_material_of_type(static_cast<Material::Type>(record.type), desc));
+    }
+    const auto* c = header.camera;
+    scene.camera = CameraDesc{Point3{c[0], c[1], c[2]}, Point3{c[3], c[4], c[5]}, Vector3{c[6], c[7], c[8]}, c[9], c[10], c[11]};
+    scene.spheres = SphereBatch::view(center_x, center_y, center_z, radius, material_ids, static_cast<std::size_t>(header.sphere_count));
+
+    if(header.node_count > 0) {
+        const auto* records = array_in<NodeRecord>(*file, header.nodes_offset, header.node_count, path);
+        check_bvh_nodes(records, header.node_count, header.sphere_count, path);
+        BvhBuildStats stats{};
+        stats.primitive_count = static_cast<std::size_t>(header.sphere_count);
+        stats.node_count = static_cast<std::size_t>(header.node_count);
+        stats.leaf_count = static_cast<std::size_t>(header.bvh_leaf_count);
+        stats.max_depth = static_cast<std::size_t>(header.bvh_max_depth);
+        stats.max_leaf_size = static_cast<std::size_t>(header.bvh_max_leaf_size);
+#if !defined(RTIOW_VECTOR3_SIMD)
+        //With three-float vectors a BvhNode is laid out exactly like a NodeRecord.
+        static_assert(sizeof(BvhNode) == sizeof(NodeRecord));
+        const auto nodes = std::span<const BvhNode>{reinterpret_cast<const BvhNode*>(records), static_cast<std::size_t>(header.node_count)};
+        scene.bvh = std::make_shared<const Bvh>(nodes, scene.spheres, stats);
+#else
+        std::vector<BvhNode> nodes(static_cast<std::size_t>(header.node_count));
+        for(std::size_t i = 0; i < nodes.size(); ++i) {
+            const auto& record = records[i];
+            nodes[i].bounds = Aabb{Point3{record.minimum[0], record.minimum[1], record.minimum[2]}, Point3{record.maximum[0], record.maximum[1], record.maximum[2]}};
+            nodes[i].offset = record.offset;
+            nodes[i].count = record.count;
+            nodes[i].axis = record.axis;
+        }
+        scene.bvh = std::make_shared<const Bvh>(std::move(nodes), scene.spheres, stats);
+#endif
+    }
+    scene.storage = std::move(file);
+    return scene;
+}
+
+bool write_scene_text(const Scene& scene, const std::string& path) {
+    const auto spheres = collect_spheres(scene);
+    std::string out{};
+    out.reserve(64 * (spheres.size() + scene.materials.size()) + 256);
+    const auto& camera = scene.camera;
+    out += "camera look_from ";
+    append_vector(out, camera.look_from);
+    out += " look_at ";
+    append_vector(out, camera.look_at);
+    out += " up ";
+    append_vector(out, camera.up);
+    out += " vfov ";
+    append_number(out, camera.vfov_degrees);
+    out += " aperture ";
+    append_number(out, camera.aperture);
+    out += " focus_distance ";
+    append_number(out, camera.focus_distance);
+    out += '\n';
+    for(std::size_t i = 0; i < scene.materials.size(); ++i) {
+        const auto& material = scene.materials[static_cast<MaterialId>(i)];
+        out += "material m" + std::to_string(i) + ' ' + material_type_name(material.type) + " color ";
+        append_vector(out, material.color);
+        out += " roughness ";
+        append_number(out, material.roughness);
+        out += " metallic ";
+        append_number(out, material.metallic);
+        out += " ior ";
+        append_number(out, material.refractionIndex);
+        out += '\n';
+    }
+    for(const auto& key : scene.camera_keys) {
+        out += "keyframe ";
+        append_number(out, key.time);
+        out += " look_from ";
+        append_vector(out, key.look_from);
+        out += " look_at ";
+        append_vector(out, key.look_at);
+        out += '\n';
+    }
+    auto motion = scene.sphere_motions.begin();
+    for(std::size_t i = 0; i < spheres.size(); ++i) {
+        out += "sphere ";
+        append_vector(out, spheres.center(i));
+        out += ' ';
+        append_number(out, spheres.radius(i));
+        out += " m" + std::to_string(spheres.material_id(i));
+        if(motion != scene.sphere_motions.end() && motion->sphere == i) {
+            out += " move ";
+            append_vector(out, motion->offset);
+            ++motion;
+        }
+        out += '\n';
+    }
+    std::ofstream file(path, std::ios_base::binary);
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    return static_cast<bool>(file);
+}
+
+bool write_compiled_scene(const Scene& scene, const std::string& path, bool include_bvh) {
+    if(!scene.camera_keys.empty() || !scene.sphere_motions.empty()) {
+        throw std::runtime_error("Compiled scenes hold no keyframes or moving spheres; write the scene as text");
+    }
+    const auto collected = collect_spheres(scene);
+    std::unique_ptr<Bvh> bvh{};
+    if(include_bvh && collected.size() > 0) {
+        bvh = std::make_unique<Bvh>(collected);
+    }
+    //With a BVH the spheres are stored in its leaf order.
+    const auto& spheres = bvh ? bvh->spheres() : collected;
+    const auto count = spheres.size();
+
+    CompiledSceneHeader header{};
+    header.padding_entries = static_cast<std::uint32_t>(SphereBatch::max_lane_count);
+    header.sphere_count = count;
+    header.material_count = scene.materials.size();
+    const auto& camera = scene.camera;
+    const float camera_values[12]{camera.look_from.x(), camera.look_from.y(), camera.look_from.z(), camera.look_at.x(), camera.look_at.y(), camera.look_at.z(),
+                                  camera.up.x(), camera.up.y(), camera.up.z(), camera.vfov_degrees, camera.aperture, camera.focus_distance};
+    std::memcpy(header.camera, camera_values, sizeof(camera_values));
+
+    std::vector<MaterialRecord> materials{};
+    materials.reserve(scene.materials.size());
+    for(std::size_t i = 0; i < scene.materials.size(); ++i) {
+        const auto& m = scene.materials[static_cast<MaterialId>(i)];
+        materials.emplace_back(MaterialRecord{static_cast<std::uint32_t>(m.type), {m.color.x(), m.color.y(), m.color.z()}, m.roughness, m.metallic, m.refractionIndex});
+    }
+    const auto padded = count + header.padding_entries;
+    std::vector<float> center_x(padded, 0.0f);
+    std::vector<float> center_y(padded, 0.0f);
+    std::vector<float> center_z(padded, 0.0f);
+    std::vector<float> radius(padded, 0.0f);
+    std::vector<MaterialId> material_ids(count);
+    for(std::size_t i = 0; i < count; ++i) {
+        const auto center = spheres.center(i);
+        center_x[i] = center.x();
+        center_y[i] = center.y();
+        center_z[i] = center.z();
+        radius[i] = spheres.radius(i);
+        material_ids[i] = spheres.material_id(i);
+    }
+    std::vector<NodeRecord> nodes{};
+    if(bvh) {
+        const auto& stats = bvh->build_stats();
+        header.bvh_leaf_count = stats.leaf_count;
+        header.bvh_max_depth = stats.max_depth;
+        header.bvh_max_leaf_size = stats.max_leaf_size;
+        nodes.reserve(bvh->nodes().size());
+        for(const auto& node : bvh->nodes()) {
+            const auto& b = node.bounds;
+            nodes.emplace_back(NodeRecord{{b.minimum.x(), b.minimum.y(), b.minimum.z()}, {b.maximum.x(), b.maximum.y(), b.maximum.z()}, node.offset, node.count, node.axis});
+        }
+    }
+    header.node_count = nodes.size();
+
+    header.materials_offset = align_up(sizeof(CompiledSceneHeader));
+    header.center_x_offset = align_up(header.materials_offset + materials.size() * sizeof(MaterialRecord));
+    header.center_y_offset = align_up(header.center_x_offset + padded * sizeof(float));
+    header.center_z_offset = align_up(header.center_y_offset + padded * sizeof(float));
+    header.radius_offset = align_up(header.center_z_offset + padded * sizeof(float));
+    header.material_ids_offset = align_up(header.radius_offset + padded * sizeof(float));
+    header.nodes_offset = align_up(header.material_ids_offset + count * sizeof(MaterialId));
+
+    std::ofstream file(path, std::ios_base::binary | std::ios_base::trunc);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    std::uint64_t position = sizeof(header);
+    write_array_at(file, position, header.materials_offset, materials);
+    write_array_at(file, position, header.center_x_offset, center_x);
+    write_array_at(file, position, header.center_y_offset, center_y);
+    write_array_at(file, position, header.center_z_offset, center_z);
+    write_array_at(file, position, header.radius_offset, radius);
+    write_array_at(file, position, header.material_ids_offset, material_ids);
+    write_array_at(file, position, header.nodes_offset, nodes);
+    return static_cast<bool>(file);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <cstdint>
+#include <string>
+
+//Text scenes are for authoring. One statement per line; '#' starts a comment.
+//
+//  camera [look_from X Y Z] [look_at X Y Z] [up X Y Z] [vfov DEGREES] [aperture A] [focus_distance D]
+//  material NAME lambertian|metal|dielectric [color R G B] [roughness R] [metallic M] [ior N]
+//  sphere X Y Z RADIUS MATERIAL_NAME [move DX DY DZ]
+//  mesh OBJ_FILE MATERIAL_NAME [translate X Y Z] [scale S]
+//  keyframe TIME [look_from X Y Z] [look_at X Y Z]
+//
+//Camera keys left out keep the cover image's values, material keys left out
+//keep MaterialDesc's defaults. A material is declared before the spheres and
+//meshes that use it. A mesh's OBJ file is found relative to the scene file
+//and scaled, then translated; scenes with meshes keep their spheres as
+//objects in world next to them, and cannot be written back out.
+//
+//Keyframes and moves animate sequence renders (see Animation.hpp): TIME runs
+//from 0 at the first frame to 1 at the last, and a moving sphere's center is
+//TIME * (DX, DY, DZ) away from X Y Z. Keyframes come in time order, after the
+//camera statement; keys left out keep the previous keyframe's, or the
+//camera's.
+//
+//Compiled scenes are for rendering: a CompiledSceneHeader followed by the
+//materials, the spheres as structure-of-arrays in SphereBatch layout, and
+//optionally the nodes of a BVH over them, every array starting on a 64-byte
+//boundary. Loading maps the file and uses the arrays in place.
+struct CompiledSceneHeader {
+    char magic[4]{'R', 'T', 'S', 'C'};
+    std::uint32_t version{1};
+    //Written as 0x01020304; anything else means the file has the wrong byte order.
+    std::uint32_t byte_order{0x01020304u};
+    //Unused entries after the last sphere in each float array, see SphereBatch::view.
+    std::uint32_t padding_entries{0};
+    std::uint64_t sphere_count{0};
+    std::uint64_t material_count{0};
+    //Nodes of the prebuilt BVH; 0 if the file has none. Leaves index the sphere arrays.
+    std::uint64_t node_count{0};
+    float camera[12]{}; //look_from, look_at, up, vfov_degrees, aperture, focus_distance
+    //Byte offsets from the start of the file.
+    std::uint64_t materials_offset{0};
+    std::uint64_t center_x_offset{0};
+    std::uint64_t center_y_offset{0};
+    std::uint64_t center_z_offset{0};
+    std::uint64_t radius_offset{0};
+    std::uint64_t material_ids_offset{0};
+    std::uint64_t nodes_offset{0};
+    //Build statistics of the prebuilt BVH.
+    std::uint64_t bvh_leaf_count{0};
+    std::uint64_t bvh_max_depth{0};
+    std::uint64_t bvh_max_leaf_size{0};
+};
+static_assert(sizeof(CompiledSceneHeader) == 168, "CompiledSceneHeader is written to disk as is.");
+
+//Reads a text or compiled scene, telling them apart by the compiled magic.
+//Throws std::runtime_error naming the file, and the line for text scenes.
+Scene load_scene(const std::string& path);
+
+Scene read_scene_text(const std::string& path);
+Scene read_compiled_scene(const std::string& path);
+
+//Both throw std::runtime_error if the scene has objects other than spheres,
+//and return false if the file cannot be written. Compiled scenes hold no
+//animation, so write_compiled_scene also throws for a scene with keyframes or
+//moving spheres.
+bool write_scene_text(const Scene& scene, const std::string& path);
+bool write_compiled_scene(const Scene& scene, const std::string& path, bool include_bvh);
@@ -0,0 +1,9 @@
+#include "ShadingMath.hpp"
+
+std::ostream& operator<<(std::ostream& out, ShadingMath math) {
+    switch(math) {
+    case ShadingMath::Reference: return out << "reference";
+    case ShadingMath::Fast: return out << "fast";
+    default: return out << "unknown";
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Vector3.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+
+//Which versions of their math functions the material kernels call.
+enum class ShadingMath : std::uint32_t {
+    Reference  //std::pow and the glass test and refraction as the book writes them.
+    ,Fast      //Schlick without std::pow and a leaner glass kernel: see the fast_ functions below.
+};
+
+//Schlick's approximation of the Fresnel reflectance at an interface with
+//relative index of refraction ref_idx, for the cosine of the incident angle.
+inline float schlick_reflectance(float cosine, float ref_idx) {
+    auto r0 = (1.0f - ref_idx) / (1.0f + ref_idx);
+    r0 = r0 * r0;
+    return r0 + (1.0f - r0) * std::pow((1.0f - cosine), 5.0f);
+}
+
+//The same polynomial with the fifth power as three multiplications, where
+//std::pow takes a general exp/log path.
+inline float fast_schlick_reflectance(float cosine, float ref_idx) noexcept {
+    auto r0 = (1.0f - ref_idx) / (1.0f + ref_idx);
+    r0 = r0 * r0;
+    const auto x = 1.0f - cosine;
+    const auto x2 = x * x;
+    return r0 + (1.0f - r0) * (x2 * x2 * x);
+}
+
+//refract for a ray that is known to refract, with cos_theta = dot(-uv, n)
+//already at hand. 1 - |perpendicular|^2 is then positive in exact arithmetic,
+//so the fabs goes; the clamp at 0 stays for the rounding that can take it
+//just below 0 near grazing angles. The square root stays a square root: one
+//sqrtss is cheaper than a reciprocal square root estimate with the Newton
+//step it needs and the extra multiplication.
+inline Vector3 fast_refract(const Vector3& uv, const Vector3& n, float eta_over_etaprime, float cos_theta) noexcept {
+    const auto perpendicular = eta_over_etaprime * (uv + cos_theta * n);
+    return perpendicular - std::sqrt((std::max)(0.0f, 1.0f - perpendicular.length_squared())) * n;
+}
+
+std::ostream& operator<<(std::ostream& out, ShadingMath math);
@@ -3,6 +3,7 @@
 #include "Hittable.hpp"
 #include "Vector3.hpp"
 #include "Material.hpp"
+#include "RayStats.hpp"
 
 #include <cmath>
 
@@ -15,20 +16,22 @@ public:
     Sphere3& operator=(Sphere3&& other) = default;
     virtual ~Sphere3() = default;
 
-    Sphere3(const Point3& c, float r, Material m) : center{ c }, radius{ r }, material{m} {};
+    Sphere3(const Point3& c, float r, MaterialId m) : center{ c }, radius{ r }, material_id{m} {};
 
     bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override;
+    bool bounding_box(Aabb& output_box) const override;
 
     Point3 center{};
     float radius{1.0f};
-    Material material{};
+    MaterialId material_id{};
 protected:
 private:
     
 };
 
 
-bool Sphere3::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+inline bool Sphere3::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+    RAY_STATS(++thread_ray_stats().primitive_tests);
     const auto oc = r.origin() - center;
     const auto a = r.direction().length_squared();
     const auto half_b = dot(oc, r.direction());
@@ -48,12 +51,19 @@ bool Sphere3::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) cons
         }
     }
     
+    RAY_STATS(++thread_ray_stats().primitive_hits);
     rec.hit = true;
     rec.t = root;
     rec.p = r.at(rec.t);
     Vector3 outward_normal = (rec.p - center) / radius;
     rec.set_face_normal(r, outward_normal);
-    rec.material = material;
+    rec.material_id = material_id;
 
     return true;
 }
+
+inline bool Sphere3::bounding_box(Aabb& output_box) const {
+    const auto extent = Vector3{radius, radius, radius};
+    output_box = Aabb{center - extent, center + extent};
+    return true;
+}
@@ -0,0 +1,344 @@
+#include "SphereBatch.hpp"
+
+#include "RayStats.hpp"
+#include "Sphere3.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(RTIOW_SPHERE_BATCH_AVX512) || defined(RTIOW_SPHERE_BATCH_AVX2)
+    #include <immintrin.h>
+#elif defined(RTIOW_SPHERE_BATCH_SSE)
+    #include <emmintrin.h>
+#endif
+
+namespace {
+
+    //Thin wrappers giving every instruction set the same vocabulary so the
+    //intersection kernel below is written once.
+#if defined(RTIOW_SPHERE_BATCH_AVX512)
+    struct Lanes {
+        using vec_t = __m512;
+        using mask_t = __mmask16;
+        static vec_t load(const float* p) { return _mm512_loadu_ps(p); }
+        static void store(float* p, vec_t v) { _mm512_storeu_ps(p, v); }
+        static vec_t set1(float v) { return _mm512_set1_ps(v); }
+        static vec_t add(vec_t a, vec_t b) { return _mm512_add_ps(a, b); }
+        static vec_t sub(vec_t a, vec_t b) { return _mm512_sub_ps(a, b); }
+        static vec_t mul(vec_t a, vec_t b) { return _mm512_mul_ps(a, b); }
+        static vec_t div(vec_t a, vec_t b) { return _mm512_div_ps(a, b); }
+        static vec_t sqrt(vec_t a) { return _mm512_sqrt_ps(a); }
+        static mask_t ge(vec_t a, vec_t b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+        static mask_t le(vec_t a, vec_t b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+        static mask_t both(mask_t a, mask_t b) { return static_cast<mask_t>(a & b); }
+        static mask_t either(mask_t a, mask_t b) { return static_cast<mask_t>(a | b); }
+        static mask_t first(std::size_t n) { return static_cast<mask_t>(n >= 16 ? 0xFFFFu : (1u << n) - 1u); }
+        static vec_t select(mask_t m, vec_t a, vec_t b) { return _mm512_mask_blend_ps(m, b, a); }
+        static unsigned int bits(mask_t m) { return m; }
+    };
+#elif defined(RTIOW_SPHERE_BATCH_AVX2)
+    struct Lanes {
+        using vec_t = __m256;
+        using mask_t = __m256;
+        static vec_t load(const float* p) { return _mm256_loadu_ps(p); }
+        static void store(float* p, vec_t v) { _mm256_storeu_ps(p, v); }
+        static vec_t set1(float v) { return _mm256_set1_ps(v); }
+        static vec_t add(vec_t a, vec_t b) { return _mm256_add_ps(a, b); }
+        static vec_t sub(vec_t a, vec_t b) { return _mm256_sub_ps(a, b); }
+        static vec_t mul(vec_t a, vec_t b) { return _mm256_mul_ps(a, b); }
+        static vec_t div(vec_t a, vec_t b) { return _mm256_div_ps(a, b); }
+        static vec_t sqrt(vec_t a) { return _mm256_sqrt_ps(a); }
+        static mask_t ge(vec_t a, vec_t b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        static mask_t le(vec_t a, vec_t b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+        static mask_t both(mask_t a, mask_t b) { return _mm256_and_ps(a, b); }
+        static mask_t either(mask_t a, mask_t b) { return _mm256_or_ps(a, b); }
+        static mask_t first(std::size_t n) { return _mm256_cmp_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(static_cast<float>(n)), _CMP_LT_OQ); }
+        static vec_t select(mask_t m, vec_t a, vec_t b) { return _mm256_blendv_ps(b, a, m); }
+        static unsigned int bits(mask_t m) { return static_cast<unsigned int>(_mm256_movemask_ps(m)); }
+    };
+#elif defined(RTIOW_SPHERE_BATCH_SSE)
+    struct Lanes {
+        using vec_t = __m128;
+        using mask_t = __m128;
+        static vec_t load(const float* p) { return _mm_loadu_ps(p); }
+        static void store(float* p, vec_t v) { _mm_storeu_ps(p, v); }
+        static vec_t set1(float v) { return _mm_set1_ps(v); }
+        static vec_t add(vec_t a, vec_t b) { return _mm_add_ps(a, b); }
+        static vec_t sub(vec_t a, vec_t b) { return _mm_sub_ps(a, b); }
+        static vec_t mul(vec_t a, vec_t b) { return _mm_mul_ps(a, b); }
+        static vec_t div(vec_t a, vec_t b) { return _mm_div_ps(a, b); }
+        static vec_t sqrt(vec_t a) { return _mm_sqrt_ps(a); }
+        static mask_t ge(vec_t a, vec_t b) { return _mm_cmpge_ps(a, b); }
+        static mask_t le(vec_t a, vec_t b) { return _mm_cmple_ps(a, b); }
+        static mask_t both(mask_t a, mask_t b) { return _mm_and_ps(a, b); }
+        static mask_t either(mask_t a, mask_t b) { return _mm_or_ps(a, b); }
+        static mask_t first(std::size_t n) { return _mm_cmplt_ps(_mm_setr_ps(0, 1, 2, 3), _mm_set1_ps(static_cast<float>(n))); }
+        static vec_t select(mask_t m, vec_t a, vec_t b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+        static unsigned int bits(mask_t m) { return static_cast<unsigned int>(_mm_movemask_ps(m)); }
+    };
+#else
+    struct Lanes {
+        using vec_t = float;
+        using mask_t = bool;
+        static vec_t load(const float* p) { return *p; }
+        static void store(float* p, vec_t v) { *p = v; }
+        static vec_t set1(float v) { return v; }
+        static vec_t add(vec_t a, vec_t b) { return a + b; }
+        static vec_t sub(vec_t a, vec_t b) { return a - b; }
+        static vec_t mul(vec_t a, vec_t b) { return a * b; }
+        static vec_t div(vec_t a, vec_t b) { return a / b; }
+        static vec_t sqrt(vec_t a) { return std::sqrt(a); }
+        static mask_t ge(vec_t a, vec_t b) { return a >= b; }
+        static mask_t le(vec_t a, vec_t b) { return a <= b; }
+        static mask_t both(mask_t a, mask_t b) { return a && b; }
+        static mask_t either(mask_t a, mask_t b) { return a || b; }
+        static mask_t first(std::size_t n) { return n > 0; }
+        static vec_t select(mask_t m, vec_t a, vec_t b) { return m ? a : b; }
+        static unsigned int bits(mask_t m) { return m ? 1u : 0u; }
+    };
+#endif
+
+}
+
+SphereBatch::SphereBatch(const SphereBatch& other)
+: m_center_x{other.m_center_x}
+, m_center_y{other.m_center_y}
+, m_center_z{other.m_center_z}
+, m_radius{other.m_radius}
+, m_material_id{other.m_material_id}
+, m_arrays{other.m_arrays}
+, m_count{other.m_count} {
+    if(other.owns_arrays()) {
+        point_at_owned_arrays();
+    }
+}
+
+//Moving a vector keeps its buffer, so the arrays stay valid in the new batch.
+SphereBatch::SphereBatch(SphereBatch&& other) noexcept
+: m_center_x{std::move(other.m_center_x)}
+, m_center_y{std::move(other.m_center_y)}
+, m_center_z{std::move(other.m_center_z)}
+, m_radius{std::move(other.m_radius)}
+, m_material_id{std::move(other.m_material_id)}
+, m_arrays{other.m_arrays}
+, m_count{other.m_count} {
+    other.m_arrays = Arrays{};
+    other.m_count = 0;
+}
+
+SphereBatch& SphereBatch::operator=(const SphereBatch& other) {
+    if(this != &other) {
+        *this = SphereBatch{other};
+    }
+    return *this;
+}
+
+SphereBatch& SphereBatch::operator=(SphereBatch&& other) noexcept {
+    if(this != &other) {
+        m_center_x = std::move(other.m_center_x);
+        m_center_y = std::move(other.m_center_y);
+        m_center_z = std::move(other.m_center_z);
+        m_radius = std::move(other.m_radius);
+        m_material_id = std::move(other.m_material_id);
+        m_arrays = other.m_arrays;
+        m_count = other.m_count;
+        other.m_arrays = Arrays{};
+        other.m_count = 0;
+    }
+    return *this;
+}
+
+SphereBatch SphereBatch::view(const float* center_x, const float* center_y, const float* center_z, const float* radius, const MaterialId* material_ids, std::size_t count) {
+    SphereBatch batch{};
+    batch.m_arrays = Arrays{center_x, center_y, center_z, radius, material_ids};
+    batch.m_count = count;
+    return batch;
+}
+
+void SphereBatch::reserve(std::size_t count) {
+    m_center_x.reserve(count + lane_count);
+    m_center_y.reserve(count + lane_count);
+    m_center_z.reserve(count + lane_count);
+    m_radius.reserve(count + lane_count);
+    m_material_id.reserve(count);
+}
+
+void SphereBatch::add(const Point3& center, float radius, MaterialId material_id) {
+    m_center_x.resize(m_count);
+    m_center_y.resize(m_count);
+    m_center_z.resize(m_count);
+    m_radius.resize(m_count);
+    m_center_x.emplace_back(center.x());
+    m_center_y.emplace_back(center.y());
+    m_center_z.emplace_back(center.z());
+    m_radius.emplace_back(radius);
+    m_material_id.emplace_back(material_id);
+    ++m_count;
+    pad();
+    point_at_owned_arrays();
+}
+
+void SphereBatch::set_center(std::size_t index, const Point3& center) {
+    m_center_x[index] = center.x();
+    m_center_y[index] = center.y();
+    m_center_z[index] = center.z();
+}
+
+std::size_t SphereBatch::size() const noexcept {
+    return m_count;
+}
+
+bool SphereBatch::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+    return hit_range(r, 0, m_count, t_min, t_max, rec);
+}
+
+bool SphereBatch::bounding_box(Aabb& output_box) const {
+    if(m_count == 0) {
+        return false;
+    }
+    output_box = Aabb::empty();
+    for(std::size_t i = 0; i < m_count; ++i) {
+        output_box.expand(sphere_bounds(i));
+    }
+    return true;
+}
+
+bool SphereBatch::hit_range(const Ray3& r, std::size_t first, std::size_t count, float t_min, float t_max, hit_record& rec) const {
+    using L = Lanes;
+    const auto origin = r.origin();
+    const auto direction = r.direction();
+    const auto ox = L::set1(origin.x());
+    const auto oy = L::set1(origin.y());
+    const auto oz = L::set1(origin.z());
+    const auto dx = L::set1(direction.x());
+    const auto dy = L::set1(direction.y());
+    const auto dz = L::set1(direction.z());
+    const auto a = L::set1(direction.length_squared());
+    const auto zero = L::set1(0.0f);
+    const auto lower = L::set1(t_min);
+
+    RAY_STATS(thread_ray_stats().primitive_tests += count);
+    auto closest = t_max;
+    auto best = m_count;
+    for(std::size_t i = first; i < first + count; i += lane_count) {
+        const auto ocx = L::sub(ox, L::load(&m_arrays.center_x[i]));
+        const auto ocy = L::sub(oy, L::load(&m_arrays.center_y[i]));
+        const auto ocz = L::sub(oz, L::load(&m_arrays.center_z[i]));
+        const auto radius = L::load(&m_arrays.radius[i]);
+        const auto half_b = L::add(L::add(L::mul(ocx, dx), L::mul(ocy, dy)), L::mul(ocz, dz));
+        const auto c = L::sub(L::add(L::add(L::mul(ocx, ocx), L::mul(ocy, ocy)), L::mul(ocz, ocz)), L::mul(radius, radius));
+        const auto discriminant = L::sub(L::mul(half_b, half_b), L::mul(a, c));
+        const auto valid = L::both(L::ge(discriminant, zero), L::first(first + count - i));
+        if(!L::bits(valid)) {
+            continue;
+        }
+
+        //Same root selection as Sphere3::hit: the near root if it is in range, else the far one.
+        const auto upper = L::set1(closest);
+        const auto sqrtd = L::sqrt(discriminant);
+        const auto neg_half_b = L::sub(zero, half_b);
+        const auto near_root = L::div(L::sub(neg_half_b, sqrtd), a);
+        const auto far_root = L::div(L::add(neg_half_b, sqrtd), a);
+        const auto near_ok = L::both(L::ge(near_root, lower), L::le(near_root, upper));
+        const auto far_ok = L::both(L::ge(far_root, lower), L::le(far_root, upper));
+        auto hits = L::bits(L::both(valid, L::either(near_ok, far_ok)));
+        if(!hits) {
+            continue;
+        }
+        RAY_STATS(thread_ray_stats().primitive_hits += static_cast<std::uint64_t>(std::popcount(hits)));
+        float roots[lane_count];
+        L::store(roots, L::select(near_ok, near_root, far_root));
+        while(hits) {
+            const auto lane = static_cast<std::size_t>(std::countr_zero(hits));
+            hits &= hits - 1u;
+            if(roots[lane] <= closest) {
+                closest = roots[lane];
+                best = i + lane;
+            }
+        }
+    }
+    if(best == m_count) {
+        return false;
+    }
+
+    const auto center = Point3{m_arrays.center_x[best], m_arrays.center_y[best], m_arrays.center_z[best]};
+    rec.hit = true;
+    rec.t = closest;
+    rec.p = r.at(rec.t);
+    const auto outward_normal = (rec.p - center) / m_arrays.radius[best];
+    rec.set_face_normal(r, outward_normal);
+    rec.material_id = m_arrays.material_id[best];
+    return true;
+}
+
+Aabb SphereBatch::sphere_bounds(std::size_t index) const {
+    const auto center = Point3{m_arrays.center_x[index], m_arrays.center_y[index], m_arrays.center_z[index]};
+    const auto extent = Vector3{m_arrays.radius[index], m_arrays.radius[index], m_arrays.radius[index]};
+    return Aabb{center - extent, center + extent};
+}
+
+Point3 SphereBatch::center(std::size_t index) const {
+    return Point3{m_arrays.center_x[index], m_arrays.center_y[index], m_arrays.center_z[index]};
+}
+
+float SphereBatch::radius(std::size_t index) const {
+    return m_arrays.radius[index];
+}
+
+MaterialId SphereBatch::material_id(std::size_t index) const {
+    return m_arrays.material_id[index];
+}
+
+const char* SphereBatch::kernel_name() noexcept {
+#if defined(RTIOW_SPHERE_BATCH_AVX512)
+    return "AVX-512";
+#elif defined(RTIOW_SPHERE_BATCH_AVX2)
+    return "AVX2";
+#elif defined(RTIOW_SPHERE_BATCH_SSE)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+
+void SphereBatch::pad() {
+    m_center_x.resize(m_count + lane_count, 0.0f);
+    m_center_y.resize(m_count + lane_count, 0.0f);
+    m_center_z.resize(m_count + lane_count, 0.0f);
+    m_radius.resize(m_count + lane_count, 0.0f);
+}
+
+void SphereBatch::point_at_owned_arrays() noexcept {
+    m_arrays = Arrays{m_center_x.data(), m_center_y.data(), m_center_z.data(), m_radius.data(), m_material_id.data()};
+}
+
+bool SphereBatch::owns_arrays() const noexcept {
+    return m_arrays.center_x == m_center_x.data();
+}
+
+bool make_sphere_batch(const HittableList& list, SphereBatch& batch) {
+    const auto& objects = list.objects();
+    const auto all_spheres = std::all_of(objects.begin(), objects.end(), [](const Hittable* object) {
+        return dynamic_cast<const Sphere3*>(object) != nullptr;
+    });
+    if(!all_spheres) {
+        return false;
+    }
+    batch = SphereBatch{};
+    batch.reserve(objects.size());
+    for(const auto* object : objects) {
+        const auto& sphere = static_cast<const Sphere3&>(*object);
+        batch.add(sphere.center, sphere.radius, sphere.material_id);
+    }
+    return true;
+}
+
+HittableList make_sphere_list(const SphereBatch& batch, SceneArena& arena) {
+    HittableList list{};
+    list.reserve(batch.size());
+    arena.reserve<Sphere3>(batch.size());
+    for(std::size_t i = 0; i < batch.size(); ++i) {
+        list.add(arena.create<Sphere3>(batch.center(i), batch.radius(i), batch.material_id(i)));
+    }
+    return list;
+}
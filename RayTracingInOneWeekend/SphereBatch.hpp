@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "Hittable.hpp"
+#include "HittableList.hpp"
+#include "Material.hpp"
+#include "Ray3.hpp"
+#include "SceneArena.hpp"
+#include "Vector3.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Define RTIOW_SPHERE_BATCH_SCALAR to force the portable kernel.
+#if !defined(RTIOW_SPHERE_BATCH_SCALAR) && defined(__AVX512F__)
+    #define RTIOW_SPHERE_BATCH_AVX512
+#elif !defined(RTIOW_SPHERE_BATCH_SCALAR) && defined(__AVX2__)
+    #define RTIOW_SPHERE_BATCH_AVX2
+#elif !defined(RTIOW_SPHERE_BATCH_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #define RTIOW_SPHERE_BATCH_SSE
+#endif
+
+//Spheres stored as structure-of-arrays so one ray is tested against a full
+//SIMD register of spheres at a time (16 with AVX-512, 8 with AVX2, 4 with SSE).
+class SphereBatch : public Hittable {
+public:
+#if defined(RTIOW_SPHERE_BATCH_AVX512)
+    static constexpr std::size_t lane_count = 16;
+#elif defined(RTIOW_SPHERE_BATCH_AVX2)
+    static constexpr std::size_t lane_count = 8;
+#elif defined(RTIOW_SPHERE_BATCH_SSE)
+    static constexpr std::size_t lane_count = 4;
+#else
+    static constexpr std::size_t lane_count = 1;
+#endif
+
+    //Trailing entries every array handed to view() must carry, enough for the widest kernel.
+    static constexpr std::size_t max_lane_count = 16;
+    static_assert(lane_count <= max_lane_count);
+
+    SphereBatch() = default;
+    SphereBatch(const SphereBatch& other);
+    SphereBatch(SphereBatch&& other) noexcept;
+    SphereBatch& operator=(const SphereBatch& other);
+    SphereBatch& operator=(SphereBatch&& other) noexcept;
+    virtual ~SphereBatch() = default;
+
+    //Wraps arrays owned elsewhere, such as a mapped scene file, without copying
+    //them. The float arrays hold count + max_lane_count entries; all of them
+    //must outlive the batch and every copy of it.
+    static SphereBatch view(const float* center_x, const float* center_y, const float* center_z, const float* radius, const MaterialId* material_ids, std::size_t count);
+
+    //Not for views.
+    void reserve(std::size_t count);
+    void add(const Point3& center, float radius, MaterialId material_id);
+    void set_center(std::size_t index, const Point3& center);
+    std::size_t size() const noexcept;
+
+    bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override;
+    bool bounding_box(Aabb& output_box) const override;
+
+    //Closest hit among spheres [first, first + count).
+    bool hit_range(const Ray3& r, std::size_t first, std::size_t count, float t_min, float t_max, hit_record& rec) const;
+
+    Aabb sphere_bounds(std::size_t index) const;
+    Point3 center(std::size_t index) const;
+    float radius(std::size_t index) const;
+    MaterialId material_id(std::size_t index) const;
+
+    //Name of the instruction set the intersection kernel was compiled for.
+    static const char* kernel_name() noexcept;
+
+protected:
+private:
+    struct Arrays {
+        const float* center_x{nullptr};
+        const float* center_y{nullptr};
+        const float* center_z{nullptr};
+        const float* radius{nullptr};
+        const MaterialId* material_id{nullptr};
+    };
+
+    void pad();
+    void point_at_owned_arrays() noexcept;
+    bool owns_arrays() const noexcept;
+
+    //Each array carries lane_count unused trailing entries so a full register
+    //can always be loaded from the last valid sphere.
+    std::vector<float> m_center_x{};
+    std::vector<float> m_center_y{};
+    std::vector<float> m_center_z{};
+    std::vector<float> m_radius{};
+    std::vector<MaterialId> m_material_id{};
+    //What the kernel reads: the vectors above, or the arrays given to view().
+    Arrays m_arrays{};
+    std::size_t m_count{0};
+};
+
+//Returns true and fills batch if every object in the list is a Sphere3.
+bool make_sphere_batch(const HittableList& list, SphereBatch& batch);
+
+//The reverse of make_sphere_batch: one Sphere3 per sphere in the batch,
+//placed contiguously in the arena.
+HittableList make_sphere_list(const SphereBatch& batch, SceneArena& arena);
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "Bvh.hpp"
+#include "Hittable.hpp"
+#include "Ray3.hpp"
+#include "Sphere3.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+//A scene whose primitive types are a compile-time list: one vector per type,
+//each with its own BVH. Traversal and leaf tests are instantiated per type
+//and call each primitive's hit qualified, so a Sphere3 is tested by a direct
+//call the compiler can inline, where HittableList and Bvh's Objects leaves
+//make a virtual call per primitive. It is still a Hittable, so code written
+//against the virtual interface takes it as it is; Renderer.hpp has overloads
+//that keep the static type down to the material kernels.
+//
+//Every type in Primitives needs hit and bounding_box with Hittable's
+//signatures, and must appear only once.
+template<typename... Primitives>
+class StaticScene final : public Hittable {
+public:
+    static_assert(sizeof...(Primitives) > 0, "A StaticScene needs at least one primitive type.");
+
+    template<typename T>
+    void reserve(std::size_t count);
+
+    //Drops the BVHs; call build_bvh again once every primitive is added.
+    template<typename T, typename... Args>
+    T& add(Args&&... args);
+
+    //In leaf order once build_bvh has run.
+    template<typename T>
+    const std::vector<T>& primitives() const noexcept;
+
+    std::size_t size() const noexcept;
+
+    //Builds one BVH per primitive type and reorders that type's primitives to
+    //match its leaves. Without one, hit tests every primitive.
+    void build_bvh(int max_leaf_size = 4);
+    bool has_bvh() const noexcept;
+
+    bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override;
+    bool bounding_box(Aabb& output_box) const override;
+
+protected:
+private:
+    template<typename T>
+    struct Storage {
+        std::vector<T> primitives{};
+        std::vector<BvhNode> nodes{};
+    };
+
+    template<typename T>
+    static bool hit_range(const std::vector<T>& primitives, std::uint32_t first, std::uint32_t count, const Ray3& r, float t_min, float& closest, hit_record& rec);
+
+    template<typename T>
+    static bool hit_storage(const Storage<T>& storage, const Ray3& r, float t_min, float& closest, hit_record& rec);
+
+    template<typename T>
+    static void build_storage_bvh(Storage<T>& storage, int max_leaf_size);
+
+    template<typename T>
+    static bool expand_bounds(const Storage<T>& storage, Aabb& bounds);
+
+    std::tuple<Storage<Primitives>...> m_storage{};
+    bool m_has_bvh{false};
+};
+
+//The scene `--dispatch static` renders; Renderer.hpp has overloads for it.
+using StaticSphereScene = StaticScene<Sphere3>;
+
+template<typename... Primitives>
+template<typename T>
+void StaticScene<Primitives...>::reserve(std::size_t count) {
+    std::get<Storage<T>>(m_storage).primitives.reserve(count);
+}
+
+template<typename... Primitives>
+template<typename T, typename... Args>
+T& StaticScene<Primitives...>::add(Args&&... args) {
+    if(m_has_bvh) {
+        (std::get<Storage<Primitives>>(m_storage).nodes.clear(), ...);
+        m_has_bvh = false;
+    }
+    return std::get<Storage<T>>(m_storage).primitives.emplace_back(std::forward<Args>(args)...);
+}
+
+template<typename... Primitives>
+template<typename T>
+const std::vector<T>& StaticScene<Primitives...>::primitives() const noexcept {
+    return std::get<Storage<T>>(m_storage).primitives;
+}
+
+template<typename... Primitives>
+std::size_t StaticScene<Primitives...>::size() const noexcept {
+    return (std::get<Storage<Primitives>>(m_storage).primitives.size() + ...);
+}
+
+template<typename... Primitives>
+void StaticScene<Primitives...>::build_bvh(int max_leaf_size) {
+    (build_storage_bvh(std::get<Storage<Primitives>>(m_storage), max_leaf_size), ...);
+    m_has_bvh = true;
+}
+
+template<typename... Primitives>
+bool StaticScene<Primitives...>::has_bvh() const noexcept {
+    return m_has_bvh;
+}
+
+template<typename... Primitives>
+bool StaticScene<Primitives...>::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+    //Each type's primitives are searched from the closest hit among the types before it.
+    auto closest = t_max;
+    bool hit_anything = false;
+    ((hit_anything = hit_storage(std::get<Storage<Primitives>>(m_storage), r, t_min, closest, rec) || hit_anything), ...);
+    return hit_anything;
+}
+
+template<typename... Primitives>
+bool StaticScene<Primitives...>::bounding_box(Aabb& output_box) const {
+    if(size() == 0) {
+        return false;
+    }
+    output_box = Aabb::empty();
+    return (expand_bounds(std::get<Storage<Primitives>>(m_storage), output_box) && ...);
+}
+
+template<typename... Primitives>
+template<typename T>
+bool StaticScene<Primitives...>::hit_range(const std::vector<T>& primitives, std::uint32_t first, std::uint32_t count, const Ray3& r, float t_min, float& closest, hit_record& rec) {
+    hit_record temp_rec{};
+    bool hit_anything = false;
+    for(auto i = first; i < first + count; ++i) {
+        if(primitives[i].T::hit(r, t_min, closest, temp_rec)) {
+            hit_anything = true;
+            closest = temp_rec.t;
+            rec = temp_rec;
+        }
+    }
+    return hit_anything;
+}
+
+template<typename... Primitives>
+template<typename T>
+bool StaticScene<Primitives...>::hit_storage(const Storage<T>& storage, const Ray3& r, float t_min, float& closest, hit_record& rec) {
+    if(storage.nodes.empty()) {
+        return hit_range(storage.primitives, 0, static_cast<std::uint32_t>(storage.primitives.size()), r, t_min, closest, rec);
+    }
+    return traverse_bvh(storage.nodes, r, t_min, closest, [&](std::uint32_t first, std::uint32_t count, float& leaf_closest) {
+        if(hit_range(storage.primitives, first, count, r, t_min, leaf_closest, rec)) {
+            closest = leaf_closest;
+            return true;
+        }
+        return false;
+    });
+}
+
+template<typename... Primitives>
+template<typename T>
+void StaticScene<Primitives...>::build_storage_bvh(Storage<T>& storage, int max_leaf_size) {
+    std::vector<Aabb> bounds{};
+    bounds.reserve(storage.primitives.size());
+    for(const auto& primitive : storage.primitives) {
+        Aabb box{};
+        if(!primitive.T::bounding_box(box)) {
+            //Unbounded primitives can't be culled; give them a box that every ray enters.
+            box = Aabb{Point3{-infinity, -infinity, -infinity}, Point3{infinity, infinity, infinity}};
+        }
+        bounds.emplace_back(box);
+    }
+    std::vector<std::uint32_t> order{};
+    build_bvh_nodes(bounds, max_leaf_size, storage.nodes, order);
+    std::vector<T> ordered{};
+    ordered.reserve(order.size());
+    for(const auto index : order) {
+        ordered.emplace_back(std::move(storage.primitives[index]));
+    }
+    storage.primitives = std::move(ordered);
+}
+
+template<typename... Primitives>
+template<typename T>
+bool StaticScene<Primitives...>::expand_bounds(const Storage<T>& storage, Aabb& bounds) {
+    for(const auto& primitive : storage.primitives) {
+        Aabb box{};
+        if(!primitive.T::bounding_box(box)) {
+            return false;
+        }
+        bounds.expand(box);
+    }
+    return true;
+}
@@ -0,0 +1,122 @@
+#include "ThreadPool.hpp"
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+    //Index of the pool worker running on this thread, or -1 for outside threads.
+    thread_local int tl_worker_index = -1;
+}
+
+ThreadPool::ThreadPool(unsigned int thread_count) {
+    thread_count = (std::max)(1u, thread_count);
+    _queues.reserve(thread_count);
+    for(unsigned int i = 0; i < thread_count; ++i) {
+        _queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+    _workers.reserve(thread_count);
+    for(unsigned int i = 0; i < thread_count; ++i) {
+        _workers.emplace_back([this, i]() { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() noexcept {
+    {
+        std::scoped_lock lock(_state_mutex);
+        _stopping = true;
+    }
+    _work_available.notify_all();
+    for(auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(task_t task) {
+    //Tasks spawned by a worker stay on that worker's deque; everything else is dealt out round-robin.
+    const auto count = static_cast<unsigned int>(_queues.size());
+    const auto index = tl_worker_index >= 0 ? static_cast<unsigned int>(tl_worker_index) : _next_queue.fetch_add(1, std::memory_order_relaxed) % count;
+    {
+        std::scoped_lock lock(_state_mutex);
+        ++_pending;
+        ++_queued;
+    }
+    {
+        auto& queue = *_queues[index];
+        std::scoped_lock lock(queue.mutex);
+        queue.tasks.emplace_back(std::move(task));
+    }
+    _work_available.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock lock(_state_mutex);
+    _all_done.wait(lock, [this]() { return _pending.load() == 0; });
+}
+
+bool ThreadPool::wait_for(std::chrono::milliseconds timeout) {
+    std::unique_lock lock(_state_mutex);
+    return _all_done.wait_for(lock, timeout, [this]() { return _pending.load() == 0; });
+}
+
+unsigned int ThreadPool::thread_count() const noexcept {
+    return static_cast<unsigned int>(_workers.size());
+}
+
+unsigned int ThreadPool::default_thread_count() noexcept {
+    const auto hardware = std::thread::hardware_concurrency();
+    return hardware ? hardware : 1u;
+}
+
+void ThreadPool::worker_loop(unsigned int index) {
+    tl_worker_index = static_cast<int>(index);
+    PROFILE_THREAD_NAME("Worker " + std::to_string(index));
+    for(;;) {
+        task_t task{};
+        if(try_pop(index, task) || try_steal(index, task)) {
+            --_queued;
+            task();
+            finish_task();
+            continue;
+        }
+        std::unique_lock lock(_state_mutex);
+        _work_available.wait(lock, [this]() { return _stopping || _queued.load() > 0; });
+        if(_stopping && _queued.load() == 0) {
+            return;
+        }
+    }
+}
+
+bool ThreadPool::try_pop(unsigned int index, task_t& task) {
+    auto& queue = *_queues[index];
+    std::scoped_lock lock(queue.mutex);
+    if(queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::try_steal(unsigned int thief, task_t& task) {
+    const auto count = static_cast<unsigned int>(_queues.size());
+    for(unsigned int offset = 1; offset < count; ++offset) {
+        auto& victim = *_queues[(thief + offset) % count];
+        std::unique_lock lock(victim.mutex, std::try_to_lock);
+        if(!lock.owns_lock() || victim.tasks.empty()) {
+            continue;
+        }
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::finish_task() {
+    if(_pending.fetch_sub(1) == 1) {
+        std::scoped_lock lock(_state_mutex);
+        _all_done.notify_all();
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed-size pool of workers, each owning a task deque.
+//Workers pop their own work newest-first and steal the oldest work from
+//other workers when they run dry, so uneven tasks still balance out.
+class ThreadPool {
+public:
+    using task_t = std::function<void()>;
+
+    explicit ThreadPool(unsigned int thread_count);
+    ~ThreadPool() noexcept;
+
+    ThreadPool() = delete;
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool(ThreadPool&&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ThreadPool& operator=(ThreadPool&&) = delete;
+
+    void submit(task_t task);
+
+    //Blocks until every submitted task has finished.
+    void wait();
+
+    //Returns true if every submitted task finished before the timeout.
+    bool wait_for(std::chrono::milliseconds timeout);
+
+    unsigned int thread_count() const noexcept;
+
+    static unsigned int default_thread_count() noexcept;
+
+protected:
+private:
+    struct WorkQueue {
+        std::mutex mutex{};
+        std::deque<task_t> tasks{};
+    };
+
+    void worker_loop(unsigned int index);
+    bool try_pop(unsigned int index, task_t& task);
+    bool try_steal(unsigned int thief, task_t& task);
+    void finish_task();
+
+    std::vector<std::unique_ptr<WorkQueue>> _queues{};
+    std::vector<std::thread> _workers{};
+    std::mutex _state_mutex{};
+    std::condition_variable _work_available{};
+    std::condition_variable _all_done{};
+    std::atomic<std::size_t> _queued{0};
+    std::atomic<std::size_t> _pending{0};
+    std::atomic<unsigned int> _next_queue{0};
+    bool _stopping{false};
+};
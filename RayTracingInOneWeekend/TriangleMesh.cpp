@@ -0,0 +1,197 @@
+#include "TriangleMesh.hpp"
+
+#include "RayStats.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace {
+
+    //A ray in the frame of Woop, Benthin and Wald's watertight test: axes
+    //permuted so z is the dominant direction, then sheared so the ray runs
+    //along +z from the origin. Edge functions in that frame are exact about
+    //which side of a shared edge a ray passes, so it never slips between two
+    //triangles of a closed mesh.
+    struct WatertightRay {
+        explicit WatertightRay(const Ray3& r) noexcept
+        : origin{r.origin()} {
+            const auto d = r.direction();
+            const auto ax = std::fabs(d.x());
+            const auto ay = std::fabs(d.y());
+            const auto az = std::fabs(d.z());
+            kz = ax > ay ? (ax > az ? 0 : 2) : (ay > az ? 1 : 2);
+            kx = (kz + 1) % 3;
+            ky = (kx + 1) % 3;
+            //Keep the winding of the projected triangle.
+            if(d[kz] < 0.0f) {
+                std::swap(kx, ky);
+            }
+            sz = 1.0f / d[kz];
+            sx = d[kx] * sz;
+            sy = d[ky] * sz;
+        }
+
+        Point3 origin{};
+        int kx{0};
+        int ky{1};
+        int kz{2};
+        float sx{0.0f};
+        float sy{0.0f};
+        float sz{1.0f};
+    };
+
+    //Up to lane_count triangles in the ray's frame, one array per coordinate.
+    struct TriangleLanes {
+        using Lane = std::array<float, TriangleMesh::lane_count>;
+        Lane ax{}, ay{}, az{};
+        Lane bx{}, by{}, bz{};
+        Lane cx{}, cy{}, cz{};
+    };
+
+}
+
+TriangleMesh::TriangleMesh(MeshBuffers buffers, MaterialId material_id, int max_leaf_size)
+: m_positions{std::move(buffers.positions)}
+, m_indices{std::move(buffers.indices)}
+, m_material_id{material_id} {
+    if(m_positions.size() % 3 != 0 || m_indices.size() % 3 != 0) {
+        throw std::invalid_argument("A mesh needs three floats per vertex and three indices per triangle");
+    }
+    const auto vertices = static_cast<std::uint32_t>(vertex_count());
+    std::vector<Aabb> bounds{};
+    bounds.reserve(triangle_count());
+    for(std::size_t i = 0; i < m_indices.size(); i += 3) {
+        auto box = Aabb::empty();
+        for(std::size_t corner = 0; corner < 3; ++corner) {
+            if(m_indices[i + corner] >= vertices) {
+                throw std::invalid_argument("Triangle " + std::to_string(i / 3) + " refers to vertex " + std::to_string(m_indices[i + corner]) + " of " + std::to_string(vertices));
+            }
+            box.expand(vertex(m_indices[i + corner]));
+        }
+        bounds.emplace_back(box);
+    }
+
+    std::vector<std::uint32_t> order{};
+    m_build_stats = build_bvh_nodes(bounds, max_leaf_size, m_nodes, order, static_cast<int>(lane_count));
+    std::vector<std::uint32_t> ordered{};
+    ordered.reserve(m_indices.size());
+    for(const auto triangle : order) {
+        ordered.insert(ordered.end(), m_indices.begin() + triangle * 3, m_indices.begin() + triangle * 3 + 3);
+    }
+    m_indices = std::move(ordered);
+}
+
+bool TriangleMesh::hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const {
+    const WatertightRay ray{r};
+    const auto origin = std::array<float, 3>{ray.origin.x(), ray.origin.y(), ray.origin.z()};
+    std::uint32_t closest_triangle = 0;
+    auto closest_t = t_max;
+    const auto found = traverse_bvh(m_nodes, r, t_min, t_max, [&](std::uint32_t first, std::uint32_t count, float& closest) {
+        RAY_STATS(thread_ray_stats().primitive_tests += count);
+        bool hit_anything = false;
+        for(auto base = first; base < first + count; base += static_cast<std::uint32_t>(lane_count)) {
+            const auto lanes = (std::min)(static_cast<std::uint32_t>(lane_count), first + count - base);
+            //Gather: the vertices relative to the origin, sheared into the ray's
+            //frame. Unused lanes stay zero and come out degenerate.
+            TriangleLanes tri{};
+            for(std::uint32_t lane = 0; lane < lanes; ++lane) {
+                const auto* index = &m_indices[(base + lane) * 3u];
+                const auto shear = [&](std::uint32_t vertex, float& x, float& y, float& z) {
+                    const auto* p = &m_positions[vertex * 3u];
+                    const auto pz = p[ray.kz] - origin[ray.kz];
+                    x = p[ray.kx] - origin[ray.kx] - ray.sx * pz;
+                    y = p[ray.ky] - origin[ray.ky] - ray.sy * pz;
+                    z = ray.sz * pz;
+                };
+                shear(index[0], tri.ax[lane], tri.ay[lane], tri.az[lane]);
+                shear(index[1], tri.bx[lane], tri.by[lane], tri.bz[lane]);
+                shear(index[2], tri.cx[lane], tri.cy[lane], tri.cz[lane]);
+            }
+            //The edge functions and distance of every lane at once, no branches.
+            std::array<float, lane_count> u{}, v{}, w{}, det{}, t_scaled{};
+            for(std::size_t lane = 0; lane < lane_count; ++lane) {
+                u[lane] = tri.cx[lane] * tri.by[lane] - tri.cy[lane] * tri.bx[lane];
+                v[lane] = tri.ax[lane] * tri.cy[lane] - tri.ay[lane] * tri.cx[lane];
+                w[lane] = tri.bx[lane] * tri.ay[lane] - tri.by[lane] * tri.ax[lane];
+            }
+            for(std::uint32_t lane = 0; lane < lanes; ++lane) {
+                //An edge function of exactly 0 may be rounding; decide it in double
+                //so neighbours sharing the edge agree.
+                if(u[lane] == 0.0f || v[lane] == 0.0f || w[lane] == 0.0f) {
+                    u[lane] = static_cast<float>(static_cast<double>(tri.cx[lane]) * tri.by[lane] - static_cast<double>(tri.cy[lane]) * tri.bx[lane]);
+                    v[lane] = static_cast<float>(static_cast<double>(tri.ax[lane]) * tri.cy[lane] - static_cast<double>(tri.ay[lane]) * tri.cx[lane]);
+                    w[lane] = static_cast<float>(static_cast<double>(tri.bx[lane]) * tri.ay[lane] - static_cast<double>(tri.by[lane]) * tri.ax[lane]);
+                }
+            }
+            for(std::size_t lane = 0; lane < lane_count; ++lane) {
+                det[lane] = u[lane] + v[lane] + w[lane];
+                t_scaled[lane] = u[lane] * tri.az[lane] + v[lane] * tri.bz[lane] + w[lane] * tri.cz[lane];
+            }
+            for(std::uint32_t lane = 0; lane < lanes; ++lane) {
+                const auto outside = (u[lane] < 0.0f || v[lane] < 0.0f || w[lane] < 0.0f) && (u[lane] > 0.0f || v[lane] > 0.0f || w[lane] > 0.0f);
+                if(outside || det[lane] == 0.0f) {
+                    continue;
+                }
+                const auto t = t_scaled[lane] / det[lane];
+                if(t < t_min || closest < t) {
+                    continue;
+                }
+                RAY_STATS(++thread_ray_stats().primitive_hits);
+                closest = t;
+                closest_t = t;
+                closest_triangle = base + lane;
+                hit_anything = true;
+            }
+        }
+        return hit_anything;
+    });
+    if(!found) {
+        return false;
+    }
+    //Only the closest triangle's record is filled in, after traversal.
+    const auto* index = &m_indices[closest_triangle * 3u];
+    const auto v0 = vertex(index[0]);
+    rec.hit = true;
+    rec.t = closest_t;
+    rec.p = r.at(closest_t);
+    rec.set_face_normal(r, unit_vector(cross(vertex(index[1]) - v0, vertex(index[2]) - v0)));
+    rec.material_id = m_material_id;
+    return true;
+}
+
+bool TriangleMesh::bounding_box(Aabb& output_box) const {
+    if(m_nodes.empty()) {
+        return false;
+    }
+    output_box = m_nodes.front().bounds;
+    return true;
+}
+
+std::size_t TriangleMesh::triangle_count() const noexcept {
+    return m_indices.size() / 3;
+}
+
+std::size_t TriangleMesh::vertex_count() const noexcept {
+    return m_positions.size() / 3;
+}
+
+Point3 TriangleMesh::vertex(std::uint32_t index) const noexcept {
+    const auto* p = &m_positions[index * std::size_t{3}];
+    return Point3{p[0], p[1], p[2]};
+}
+
+std::span<const std::uint32_t> TriangleMesh::indices() const noexcept {
+    return m_indices;
+}
+
+MaterialId TriangleMesh::material_id() const noexcept {
+    return m_material_id;
+}
+
+const BvhBuildStats& TriangleMesh::build_stats() const noexcept {
+    return m_build_stats;
+}
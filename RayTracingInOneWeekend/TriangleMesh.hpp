@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Aabb.hpp"
+#include "Bvh.hpp"
+#include "Hittable.hpp"
+#include "Material.hpp"
+#include "Ray3.hpp"
+#include "Vector3.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+//Vertex and index buffers of a triangle mesh: three floats per vertex, three
+//vertex indices per triangle.
+struct MeshBuffers {
+    std::vector<float> positions{};
+    std::vector<std::uint32_t> indices{};
+};
+
+//A whole triangle mesh as one Hittable. Triangles are rows of the shared
+//index buffer, not objects, and the mesh carries its own BVH over them, so a
+//scene's BVH treats the mesh as a single leaf. Every triangle uses the same
+//material.
+class TriangleMesh : public Hittable {
+public:
+    //Triangles tested together in a leaf; the intersection loop runs over
+    //this many lanes so the compiler can vectorize it.
+    static constexpr std::size_t lane_count = 8;
+
+    TriangleMesh() = delete;
+    TriangleMesh(const TriangleMesh& other) = default;
+    TriangleMesh(TriangleMesh&& other) noexcept = default;
+    TriangleMesh& operator=(const TriangleMesh& other) = default;
+    TriangleMesh& operator=(TriangleMesh&& other) noexcept = default;
+    virtual ~TriangleMesh() = default;
+
+    //Builds the BVH and reorders the triangles to match its leaves. Throws
+    //std::invalid_argument if an index is out of range or the buffers are not
+    //whole vertices and triangles.
+    TriangleMesh(MeshBuffers buffers, MaterialId material_id, int max_leaf_size = static_cast<int>(lane_count));
+
+    bool hit(const Ray3& r, float t_min, float t_max, hit_record& rec) const override;
+    bool bounding_box(Aabb& output_box) const override;
+
+    std::size_t triangle_count() const noexcept;
+    std::size_t vertex_count() const noexcept;
+    Point3 vertex(std::uint32_t index) const noexcept;
+    //Three vertex indices per triangle, in leaf order.
+    std::span<const std::uint32_t> indices() const noexcept;
+    MaterialId material_id() const noexcept;
+    const BvhBuildStats& build_stats() const noexcept;
+
+protected:
+private:
+    std::vector<float> m_positions{};
+    std::vector<std::uint32_t> m_indices{};
+    std::vector<BvhNode> m_nodes{};
+    MaterialId m_material_id{};
+    BvhBuildStats m_build_stats{};
+};
@@ -2,77 +2,238 @@
 
 #include "MathUtils.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <ostream>
+#include <type_traits>
+
+//Vector3 is header-only so every operator inlines into the intersection and
+//shading loops. Everything that does not draw random numbers is constexpr.
+//
+//Define RTIOW_VECTOR3_SIMD to store the three components in a 16-byte, 4-lane
+//register (SSE2 on x86/x64, NEON on ARM) and run the arithmetic operators on
+//it. The fourth lane is padding. Constant evaluation always takes the scalar path.
+#if defined(RTIOW_VECTOR3_SIMD)
+    #if defined(__ARM_NEON) || defined(_M_ARM64)
+        #include <arm_neon.h>
+        #define RTIOW_VECTOR3_NEON
+    #elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+        #define RTIOW_VECTOR3_SSE
+    #endif
+#endif
+
+#if defined(RTIOW_VECTOR3_SSE) || defined(RTIOW_VECTOR3_NEON)
+    #define RTIOW_VECTOR3_SIMD_PATH(expr) if(!std::is_constant_evaluated()) { return expr; }
+#else
+    #define RTIOW_VECTOR3_SIMD_PATH(expr)
+#endif
+
+namespace vector3_detail {
+#if defined(RTIOW_VECTOR3_SSE)
+    using simd_t = __m128;
+    inline simd_t load(const float* p) { return _mm_load_ps(p); }
+    inline void store(float* p, simd_t v) { _mm_store_ps(p, v); }
+    inline simd_t splat(float v) { return _mm_set1_ps(v); }
+    inline simd_t add(simd_t a, simd_t b) { return _mm_add_ps(a, b); }
+    inline simd_t sub(simd_t a, simd_t b) { return _mm_sub_ps(a, b); }
+    inline simd_t mul(simd_t a, simd_t b) { return _mm_mul_ps(a, b); }
+    inline simd_t neg(simd_t a) { return _mm_sub_ps(_mm_setzero_ps(), a); }
+    inline float dot3(simd_t a, simd_t b) {
+        const auto m = _mm_mul_ps(a, b);
+        const auto y = _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 1, 1, 1));
+        const auto z = _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 2, 2, 2));
+        return _mm_cvtss_f32(_mm_add_ss(_mm_add_ss(m, y), z));
+    }
+#elif defined(RTIOW_VECTOR3_NEON)
+    using simd_t = float32x4_t;
+    inline simd_t load(const float* p) { return vld1q_f32(p); }
+    inline void store(float* p, simd_t v) { vst1q_f32(p, v); }
+    inline simd_t splat(float v) { return vdupq_n_f32(v); }
+    inline simd_t add(simd_t a, simd_t b) { return vaddq_f32(a, b); }
+    inline simd_t sub(simd_t a, simd_t b) { return vsubq_f32(a, b); }
+    inline simd_t mul(simd_t a, simd_t b) { return vmulq_f32(a, b); }
+    inline simd_t neg(simd_t a) { return vnegq_f32(a); }
+    inline float dot3(simd_t a, simd_t b) {
+        const auto m = vmulq_f32(a, b);
+        return (vgetq_lane_f32(m, 0) + vgetq_lane_f32(m, 1)) + vgetq_lane_f32(m, 2);
+    }
+#endif
+}
 
 class Vector3 {
 public:
-    Vector3() = default;
-    Vector3(const Vector3& other) = default;
-    Vector3(Vector3&& other) = default;
-    Vector3& operator=(const Vector3& other) = default;
-    Vector3& operator=(Vector3&& other) = default;
-    Vector3(float e0, float e1, float e2);
-    ~Vector3() = default;
-
-    float x() const;
-    float y() const;
-    float z() const;
-
-    Vector3 operator-() const;
-    float operator[](int i) const;
-    float& operator[](int i);
-
-    Vector3& operator+=(const Vector3& rhs);
-
-    Vector3& operator*=(const float t);
-
-    Vector3& operator/=(const float t);
-
-    float length_squared() const;
-
-    float length() const;
-
-    static Vector3 random();
-
-    static Vector3 random(float min, float max);
-
-    bool near_zero() const;
+    constexpr Vector3() = default;
+    constexpr Vector3(const Vector3& other) = default;
+    constexpr Vector3(Vector3&& other) = default;
+    constexpr Vector3& operator=(const Vector3& other) = default;
+    constexpr Vector3& operator=(Vector3&& other) = default;
+    constexpr Vector3(float e0, float e1, float e2) : m_e{ e0, e1, e2 } {}
+    constexpr ~Vector3() = default;
+
+    constexpr float x() const { return m_e[0]; }
+    constexpr float y() const { return m_e[1]; }
+    constexpr float z() const { return m_e[2]; }
+
+    constexpr Vector3 operator-() const {
+        RTIOW_VECTOR3_SIMD_PATH(from_simd(vector3_detail::neg(simd())))
+        return Vector3{ -m_e[0], -m_e[1], -m_e[2] };
+    }
+
+    constexpr float operator[](int i) const { return m_e[i]; }
+    constexpr float& operator[](int i) { return m_e[i]; }
+
+    constexpr Vector3& operator+=(const Vector3& rhs) {
+        m_e[0] += rhs.m_e[0];
+        m_e[1] += rhs.m_e[1];
+        m_e[2] += rhs.m_e[2];
+        return *this;
+    }
+
+    constexpr Vector3& operator*=(const float t) {
+        m_e[0] *= t;
+        m_e[1] *= t;
+        m_e[2] *= t;
+        return *this;
+    }
+
+    constexpr Vector3& operator/=(const float t) {
+        return *this *= 1.0f / t;
+    }
+
+    constexpr float length_squared() const {
+        RTIOW_VECTOR3_SIMD_PATH(vector3_detail::dot3(simd(), simd()))
+        return m_e[0] * m_e[0] + m_e[1] * m_e[1] + m_e[2] * m_e[2];
+    }
+
+    float length() const {
+        return std::sqrt(length_squared());
+    }
+
+    static Vector3 random() {
+        return Vector3{ random_float(), random_float(), random_float() };
+    }
+
+    static Vector3 random(float min, float max) {
+        return Vector3{ random_float(min, max), random_float(min, max), random_float(min, max) };
+    }
+
+    constexpr bool near_zero() const {
+        const auto epsilon = 1e-8;
+        const auto abs = [](float v) { return v < 0.0f ? -v : v; };
+        return (abs(m_e[0]) < epsilon) && (abs(m_e[1]) < epsilon) && (abs(m_e[2]) < epsilon);
+    }
+
+#if defined(RTIOW_VECTOR3_SSE) || defined(RTIOW_VECTOR3_NEON)
+    vector3_detail::simd_t simd() const { return vector3_detail::load(m_e); }
+    static Vector3 from_simd(vector3_detail::simd_t v) {
+        Vector3 result{};
+        vector3_detail::store(result.m_e, v);
+        return result;
+    }
+#endif
 
 protected:
 private:
+#if defined(RTIOW_VECTOR3_SSE) || defined(RTIOW_VECTOR3_NEON)
+    alignas(16) float m_e[4]{};
+#else
     float m_e[3];
+#endif
 };
 
 using Point3 = Vector3;
 using Color = Vector3;
 
-std::ostream& operator<<(std::ostream& out, const Vector3& v);
-
-Vector3 operator+(const Vector3& u, const Vector3& v);
-
-Vector3 operator-(const Vector3& u, const Vector3& v);
-
-Vector3 operator*(const Vector3& u, const Vector3& v);
-
-Vector3 operator*(float t, const Vector3& v);
-
-Vector3 operator*(const Vector3& v, float t);
-
-Vector3 operator/(const Vector3& v, float t);
-
-float dot(const Vector3& u, const Vector3& v);
-
-Vector3 cross(const Vector3& u, const Vector3& v);
-
-Vector3 unit_vector(Vector3 v);
-
-Vector3 reflect(const Vector3& v, const Vector3& n);
-
-Vector3 refract(const Vector3& uv, const Vector3& n, float eta_over_etaprime);
-
-Vector3 random_in_unit_sphere();
-
-Vector3 random_unit_vector();
-
-Vector3 random_in_unit_disk();
\ No newline at end of file
+inline std::ostream& operator<<(std::ostream& out, const Vector3& v) {
+    return out << v.x() << ' ' << v.y() << ' ' << v.z();
+}
+
+constexpr Vector3 operator+(const Vector3& u, const Vector3& v) {
+    RTIOW_VECTOR3_SIMD_PATH(Vector3::from_simd(vector3_detail::add(u.simd(), v.simd())))
+    return Vector3{ u.x() + v.x(), u.y() + v.y(), u.z() + v.z() };
+}
+
+constexpr Vector3 operator-(const Vector3& u, const Vector3& v) {
+    RTIOW_VECTOR3_SIMD_PATH(Vector3::from_simd(vector3_detail::sub(u.simd(), v.simd())))
+    return Vector3{ u.x() - v.x(), u.y() - v.y(), u.z() - v.z() };
+}
+
+constexpr Vector3 operator*(const Vector3& u, const Vector3& v) {
+    RTIOW_VECTOR3_SIMD_PATH(Vector3::from_simd(vector3_detail::mul(u.simd(), v.simd())))
+    return Vector3{ u.x() * v.x(), u.y() * v.y(), u.z() * v.z() };
+}
+
+constexpr Vector3 operator*(float t, const Vector3& v) {
+    RTIOW_VECTOR3_SIMD_PATH(Vector3::from_simd(vector3_detail::mul(vector3_detail::splat(t), v.simd())))
+    return Vector3{ t * v.x(), t * v.y(), t * v.z() };
+}
+
+constexpr Vector3 operator*(const Vector3& v, float t) {
+    return t * v;
+}
+
+constexpr Vector3 operator/(const Vector3& v, float t) {
+    return (1 / t) * v;
+}
+
+constexpr float dot(const Vector3& u, const Vector3& v) {
+    RTIOW_VECTOR3_SIMD_PATH(vector3_detail::dot3(u.simd(), v.simd()))
+    return u.x() * v.x() + u.y() * v.y() + u.z() * v.z();
+}
+
+constexpr Vector3 cross(const Vector3& u, const Vector3& v) {
+    return Vector3{ u.y() * v.z() - u.z() * v.y(),
+                   u.z() * v.x() - u.x() * v.z(),
+                   u.x() * v.y() - u.y() * v.x() };
+}
+
+inline Vector3 unit_vector(Vector3 v) {
+    return v / v.length();
+}
+
+constexpr Vector3 reflect(const Vector3& v, const Vector3& n) {
+    return v - 2.0f * dot(v, n) * n;
+}
+
+inline Vector3 refract(const Vector3& uv, const Vector3& n, float eta_over_etaprime) {
+    const auto cos_theta = std::fmin(dot(-uv, n), 1.0f);
+    const auto perpendicular = eta_over_etaprime * (uv + cos_theta * n);
+    const auto parallel = -std::sqrt(std::fabs(1.0f - perpendicular.length_squared())) * n;
+    return perpendicular + parallel;
+}
+
+//The sampling helpers map a fixed number of random numbers straight onto their
+//domain instead of rejecting points of a cube, so a sampler can stratify each
+//number: a unit vector takes two, a point in the sphere three (the direction,
+//then the radius) and a point in the disk two.
+
+inline Vector3 random_unit_vector() {
+    //z is uniform in [-1, 1] on the unit sphere (Archimedes), and so is the azimuth around it.
+    const auto z = 1.0f - 2.0f * random_float();
+    const auto phi = 2.0f * pi * random_float();
+    const auto r = std::sqrt((std::max)(0.0f, 1.0f - z * z));
+    return Vector3{r * std::cos(phi), r * std::sin(phi), z};
+}
+
+inline Vector3 random_in_unit_sphere() {
+    const auto direction = random_unit_vector();
+    //The volume inside radius r grows as r^3.
+    return std::cbrt(random_float()) * direction;
+}
+
+inline Vector3 random_in_unit_disk() {
+    //Shirley and Chiu's concentric mapping: squares around the center of
+    //[-1, 1]^2 go to circles, so strata stay compact and keep their area.
+    const auto a = random_float(-1.0f, 1.0f);
+    const auto b = random_float(-1.0f, 1.0f);
+    if(a == 0.0f && b == 0.0f) {
+        return Vector3{0.0f, 0.0f, 0.0f};
+    }
+    if(std::abs(a) > std::abs(b)) {
+        const auto phi = (pi * 0.25f) * (b / a);
+        return Vector3{a * std::cos(phi), a * std::sin(phi), 0.0f};
+    }
+    const auto phi = pi * 0.5f - (pi * 0.25f) * (a / b);
+    return Vector3{b * std::cos(phi), b * std::sin(phi), 0.0f};
+}
@@ -0,0 +1,214 @@
+#include "WavefrontIntegrator.hpp"
+
+#include "Material.hpp"
+#include "MaterialKernels.hpp"
+#include "MathUtils.hpp"
+#include "PixelStatistics.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "RayStats.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace {
+
+    //Paths advanced together. Large enough to amortize each kernel launch,
+    //small enough that a wave's state stays in L2.
+    constexpr std::size_t max_wave_size = std::size_t{1} << 14u;
+
+    constexpr std::size_t material_type_count = 4;
+
+    struct PathState {
+        Ray3 ray{};
+        Color throughput{1.0f, 1.0f, 1.0f};
+        SamplePath sample{};
+        std::uint32_t path_index{0};
+    };
+
+    //Per-thread scratch space, reused from tile to tile.
+    struct WaveBuffers {
+        std::vector<PathState> paths{};
+        std::vector<PathState> next_paths{};
+        std::vector<hit_record> hits{};
+        std::vector<std::uint8_t> types{};
+        std::vector<std::uint32_t> sorted{};
+        std::vector<Color> radiance{};
+        //Per pixel of the tile: running sum, statistics, and the pixels still sampling.
+        std::vector<Color> sums{};
+        std::vector<PixelStatistics> stats{};
+        std::vector<std::uint32_t> active{};
+    };
+
+    WaveBuffers& thread_wave_buffers() {
+        static thread_local WaveBuffers buffers{};
+        return buffers;
+    }
+
+    //One material's kernel in the settings' shading math.
+    template<Material::Type type>
+    bool scatter_with(const Material& m, const Ray3& r, const hit_record& rec, Ray3& out, ShadingMath math) {
+        if(math == ShadingMath::Fast) {
+            return scatter_kernel<type, ShadingMath::Fast>(m, r, rec, out);
+        }
+        return scatter_kernel<type>(m, r, rec, out);
+    }
+
+    template<typename Kernel>
+    void shade_bucket(const std::uint32_t* first, const std::uint32_t* last, const MaterialTable& materials, WaveBuffers& buffers, int depth, const RenderSettings& settings, Kernel&& scatter) {
+        const auto rays_traced = settings.max_depth - depth + 1;
+        for(auto it = first; it != last; ++it) {
+            const auto& path = buffers.paths[*it];
+            const auto& rec = buffers.hits[*it];
+            const auto& material = materials[rec.material_id];
+            seed_sample_path(path.sample, static_cast<std::uint32_t>(rays_traced));
+            Ray3 scattered{};
+            if(scatter(material, path.ray, rec, scattered)) {
+                const auto throughput = path.throughput * material.color;
+                const auto weight = roulette_weight(throughput, rays_traced, settings.roulette_min_depth);
+                if(weight != 0.0f) {
+                    buffers.next_paths.emplace_back(PathState{scattered, throughput * weight, path.sample, path.path_index});
+                }
+            }
+        }
+    }
+
+    std::uint64_t trace_wave(const Hittable& world, const MaterialTable& materials, const RenderSettings& settings, WaveBuffers& buffers) {
+        const auto max_depth = settings.max_depth;
+        std::uint64_t ray_count = 0;
+        for(int depth = max_depth; depth > 0 && !buffers.paths.empty(); --depth) {
+            const auto wave_size = buffers.paths.size();
+            ray_count += wave_size;
+            RAY_STATS(thread_ray_stats().count_rays(max_depth - depth, wave_size));
+
+            //Intersect the whole wave and count hits per material type.
+            buffers.hits.resize(wave_size);
+            buffers.types.resize(wave_size);
+            std::array<std::uint32_t, material_type_count + 1> bucket_start{};
+            for(std::size_t i = 0; i < wave_size; ++i) {
+                auto& rec = buffers.hits[i];
+                rec = hit_record{};
+                if(world.hit(buffers.paths[i].ray, 0.001f, infinity, rec)) {
+                    const auto type = static_cast<std::uint8_t>(materials[rec.material_id].type);
+                    buffers.types[i] = type;
+                    ++bucket_start[type + 1u];
+                } else {
+                    const auto& path = buffers.paths[i];
+                    buffers.radiance[path.path_index] = path.throughput * background_color(path.ray);
+                    RAY_STATS(++thread_ray_stats().sky_misses);
+                }
+            }
+
+            //Counting sort of the hits by material type.
+            for(std::size_t t = 1; t <= material_type_count; ++t) {
+                bucket_start[t] += bucket_start[t - 1];
+            }
+            buffers.sorted.resize(bucket_start[material_type_count]);
+            auto bucket_fill = bucket_start;
+            for(std::size_t i = 0; i < wave_size; ++i) {
+                if(buffers.hits[i].hit) {
+                    buffers.sorted[bucket_fill[buffers.types[i]]++] = static_cast<std::uint32_t>(i);
+                }
+            }
+
+            //One kernel per material; Type::None absorbs everything and has no kernel.
+            buffers.next_paths.clear();
+            const auto bucket = [&buffers, &bucket_start](Material::Type type) {
+                const auto t = static_cast<std::size_t>(type);
+                return std::array<const std::uint32_t*, 2>{buffers.sorted.data() + bucket_start[t], buffers.sorted.data() + bucket_start[t + 1]};
+            };
+            const auto lambertian = bucket(Material::Type::Lambertian);
+            shade_bucket(lambertian[0], lambertian[1], materials, buffers, depth, settings, [math = settings.shading_math](const Material& m, const Ray3& r, const hit_record& rec, Ray3& out) { return scatter_with<Material::Type::Lambertian>(m, r, rec, out, math); });
+            const auto metal = bucket(Material::Type::Metal);
+            shade_bucket(metal[0], metal[1], materials, buffers, depth, settings, [math = settings.shading_math](const Material& m, const Ray3& r, const hit_record& rec, Ray3& out) { return scatter_with<Material::Type::Metal>(m, r, rec, out, math); });
+            const auto glass = bucket(Material::Type::Glass);
+            shade_bucket(glass[0], glass[1], materials, buffers, depth, settings, [math = settings.shading_math](const Material& m, const Ray3& r, const hit_record& rec, Ray3& out) { return scatter_with<Material::Type::Glass>(m, r, rec, out, math); });
+
+            std::swap(buffers.paths, buffers.next_paths);
+        }
+        //Paths still alive have hit the bounce limit and gather no light.
+        RAY_STATS(thread_ray_stats().max_depth_terminations += buffers.paths.size());
+        buffers.paths.clear();
+        return ray_count;
+    }
+
+}
+
+std::uint64_t render_tile_wavefront(const Tile& tile, const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer) {
+    auto& buffers = thread_wave_buffers();
+    const auto sampler = make_sampler(settings);
+    const auto tile_width = tile.x_end - tile.x_begin;
+    const auto tile_pixel_count = static_cast<std::size_t>(tile_width) * (tile.y_end - tile.y_begin);
+
+    buffers.sums.assign(tile_pixel_count, Color{0.0f, 0.0f, 0.0f});
+    buffers.stats.assign(tile_pixel_count, PixelStatistics{});
+    buffers.active.resize(tile_pixel_count);
+    for(std::size_t p = 0; p < tile_pixel_count; ++p) {
+        buffers.active[p] = static_cast<std::uint32_t>(p);
+    }
+
+    //Every pixel still being sampled has the same sample count, so each round
+    //takes the same sample range from all of them: up to the first convergence
+    //test, then one adaptive_sample_batch at a time.
+    std::uint64_t ray_count = 0;
+    int samples_taken = 0;
+    while(!buffers.active.empty()) {
+        const auto round_end = settings.adaptive
+            ? (std::min)(settings.samples_per_pixel, samples_taken < settings.min_samples_per_pixel ? settings.min_samples_per_pixel : samples_taken + adaptive_sample_batch)
+            : settings.samples_per_pixel;
+        const auto samples = static_cast<std::size_t>(round_end - samples_taken);
+        const auto pixels_per_wave = (std::max)(std::size_t{1}, max_wave_size / samples);
+        const auto active_count = buffers.active.size();
+
+        for(std::size_t wave_first = 0; wave_first < active_count; wave_first += pixels_per_wave) {
+            const auto wave_last = (std::min)(active_count, wave_first + pixels_per_wave);
+            const auto wave_paths = (wave_last - wave_first) * samples;
+
+            //Camera rays for every sample of every pixel in this wave.
+            buffers.paths.clear();
+            buffers.paths.reserve(wave_paths);
+            buffers.radiance.assign(wave_paths, Color{0.0f, 0.0f, 0.0f});
+            for(auto a = wave_first; a < wave_last; ++a) {
+                const auto p = buffers.active[a];
+                const auto x = tile.x_begin + static_cast<int>(p % static_cast<std::uint32_t>(tile_width));
+                const auto y = tile.y_begin + static_cast<int>(p / static_cast<std::uint32_t>(tile_width));
+                const auto pixel_index = static_cast<std::uint64_t>(y) * settings.image_width + x;
+                for(std::size_t sample = 0; sample < samples; ++sample) {
+                    const auto sample_index = settings.first_sample + static_cast<std::uint64_t>(samples_taken) + sample;
+                    const auto path = SamplePath{sampler.get(), make_path_key(settings.seed, pixel_index, sample_index), pixel_index, sample_index};
+                    seed_sample_path(path, 0);
+                    const auto u = (x + random_float()) / (settings.image_width - 1);
+                    const auto v = (y + random_float()) / (settings.image_height - 1);
+                    const auto path_index = static_cast<std::uint32_t>((a - wave_first) * samples + sample);
+                    buffers.paths.emplace_back(PathState{camera.get_ray(u, v), Color{1.0f, 1.0f, 1.0f}, path, path_index});
+                }
+            }
+
+            {
+                PROFILE_SCOPE("Trace Wave");
+                ray_count += trace_wave(world, materials, settings, buffers);
+            }
+
+            //Sum in sample order so the result does not depend on when each path finished.
+            for(auto a = wave_first; a < wave_last; ++a) {
+                const auto p = buffers.active[a];
+                for(std::size_t sample = 0; sample < samples; ++sample) {
+                    const auto& sample_color = buffers.radiance[(a - wave_first) * samples + sample];
+                    buffers.sums[p] += sample_color;
+                    buffers.stats[p].add(sample_color);
+                }
+            }
+        }
+
+        samples_taken = round_end;
+        std::erase_if(buffers.active, [&buffers, &settings](std::uint32_t p) { return sampling_done(buffers.stats[p], settings); });
+    }
+
+    for(std::size_t p = 0; p < tile_pixel_count; ++p) {
+        const auto x = tile.x_begin + static_cast<int>(p % static_cast<std::size_t>(tile_width));
+        const auto y = tile.y_begin + static_cast<int>(p / static_cast<std::size_t>(tile_width));
+        framebuffer.store(framebuffer.index(x, y), buffers.sums[p], buffers.stats[p].count());
+    }
+    end_sample_path();
+    return ray_count;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Camera.hpp"
+#include "Hittable.hpp"
+#include "Material.hpp"
+#include "Renderer.hpp"
+#include "Vector3.hpp"
+
+#include <cstdint>
+#include <vector>
+
+//Wavefront (stream) path tracing of one tile.
+//
+//Instead of following each path to the end before starting the next, every
+//camera ray of the tile is generated up front and the whole batch advances one
+//bounce at a time: intersect every live path, retire the misses against the
+//sky, bucket the hits by Material::Type, then run each material's scatter
+//kernel over its bucket. Survivors are compacted into the next wave.
+//
+//Random numbers are keyed exactly as in ray_color, so the result matches the
+//recursive integrator up to floating-point rounding of the throughput product.
+//With adaptive sampling the tile is traced in rounds, each one taking the next
+//batch of samples of the pixels that have not converged yet.
+//Returns the number of rays traced.
+std::uint64_t render_tile_wavefront(const Tile& tile, const Hittable& world, const MaterialTable& materials, const Camera& camera, const RenderSettings& settings, Framebuffer& framebuffer);
@@ -1,103 +1,256 @@
 #include "MathUtils.hpp"
 
+#include "Animation.hpp"
+#include "Bvh.hpp"
 #include "Camera.hpp"
-#include "Color.hpp"
+#include "Checkpoint.hpp"
+#include "Denoiser.hpp"
 #include "HittableList.hpp"
+#include "ImageEncoders.hpp"
 #include "Material.hpp"
+#include "PreviewStream.hpp"
 #include "Sphere3.hpp"
 #include "ProfileLogScope.hpp"
+#include "Profiler.hpp"
+#include "Random.hpp"
+#include "RayStats.hpp"
+#include "Renderer.hpp"
+#include "RenderOptions.hpp"
+#include "RenderServer.hpp"
+#include "Scene.hpp"
+#include "SceneFile.hpp"
+#include "SphereBatch.hpp"
+#include "ThreadPool.hpp"
 
-#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
 #include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
 #include <string>
 #include <chrono>
+#include <thread>
+#include <vector>
 
-Color ray_color(const Ray3& r, const Hittable& world, int depth);
 float hit_sphere(const Point3& center, float radius, const Ray3& r);
 
-HittableList random_scene();
+void report_bvh_traversal(const Bvh& bvh, const Scene& scene, const Camera& camera, const RenderSettings& settings);
+void report_adaptive_sampling(const Framebuffer& framebuffer, const RenderSettings& settings);
+void write_sample_heatmap(const std::string& path, const Framebuffer& framebuffer, const RenderSettings& settings);
+bool write_outputs(const Framebuffer& framebuffer, const std::vector<std::string>& paths);
+bool apply_aovs(const RenderOptions& options, const Hittable& world, const Scene& scene, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer);
+int render_sequence(const RenderOptions& options, const Scene& scene, const Hittable& world, const StaticSphereScene* static_scene, AnimatedSpheres* animated, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles);
+std::string frame_path(const std::string& path, int frame);
+RenderResult render_progressive(const RenderOptions& options, const Scene& scene, const Hittable& world, const StaticSphereScene* static_scene, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer);
+int merge_partials(const RenderOptions& options);
+int serve(const RenderOptions& options);
+int submit(const RenderOptions& options);
+int compile_scene(const RenderOptions& options);
+Scene build_scene(const RenderOptions& options);
+void write_profile(const std::string& path);
+bool write_ray_stats(const std::string& path, const RenderResult& result, const RenderSettings& settings, const RenderOptions& options, unsigned int thread_count);
 
 int main(int argc, char** argv) {
 
-    //Image
-    float aspect_ratio = 3.0f / 2.0f;
-    const int image_width = [argc, argv]() -> const int {
-        return argc > 1 ? static_cast<int>(std::stoll(argv[1])) : 400;
-    }();
-    const int image_height = [argc, argv, image_width, &aspect_ratio]() -> const int {
-        if(argc > 2) {
-            const int h = static_cast<int>(std::stoll(argv[2]));
-            aspect_ratio = image_width / static_cast<float>(h);
-            return h;
-        } else {
-            return static_cast<int>(image_width / aspect_ratio);
+    const auto options = [argc, argv]() {
+        try {
+            return parse_command_line(argc, argv);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            print_usage(std::cerr, argv[0]);
+            std::exit(1);
         }
     }();
-    const int samples_per_pixel = [argc, argv]() {
-        return argc > 3 ? static_cast<int>(std::stoll(argv[3])) : 100;
-    }();
-    const int max_depth = [argc, argv]() {
-        return argc > 4 ? static_cast<int>(std::stoll(argv[4])) : 50;
-    }();
 
+    if(options.mode == RunMode::Merge) {
+        return merge_partials(options);
+    }
+    if(options.mode == RunMode::Compile) {
+        return compile_scene(options);
+    }
+    if(options.mode == RunMode::Serve) {
+        return serve(options);
+    }
+    if(options.mode == RunMode::Submit) {
+        return submit(options);
+    }
+    PROFILE_THREAD_NAME("Main");
+    if(!options.profile_path.empty() && !RTIOW_PROFILER) {
+        std::cerr << "--profile: this build has no profiler (RTIOW_PROFILER is 0), only the timing lines are printed.\n";
+    }
+
+    //Image
+    const int image_width = options.image_width;
+    const int image_height = options.image_height;
+    const float aspect_ratio = options.aspect_ratio;
 
     //World
-    HittableList world = random_scene();
+    const Scene scene = [&options] {
+        try {
+            return build_scene(options);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            std::exit(1);
+        }
+    }();
+    //Scenes read from a file keep their spheres in scene.spheres; the paths that
+    //test one object at a time get them as a list.
+    SceneArena listed_arena{};
+    const HittableList listed = options.use_sphere_batch ? HittableList{} : make_sphere_list(scene.spheres, listed_arena);
+    const HittableList& world = listed.objects().empty() ? scene.world : listed;
+    const bool from_file = scene.world.objects().empty() && scene.spheres.size() > 0;
 
     //Camera
-    const auto lookFrom = Point3{13.0f, 2.0f, 3.0f};
-    const auto lookAt = Point3{0.0f, 0.0f, 0.0f};
-    const auto vUp = Vector3{0.0f, 1.0f, 0.0f};
-    const auto distance_to_focus = 10.0f;
-    const auto aperture = 0.1f;
-
-    Camera camera{lookFrom, lookAt, vUp, 20, aspect_ratio, aperture, distance_to_focus};
+    const Camera camera = make_camera(scene.camera, aspect_ratio);
 
     //Render
-    const int max_pixel_value = 255;
+    const auto settings = RenderSettings{image_width, image_height, options.samples_per_pixel, options.max_depth, options.tile_size, options.seed + options.seed_offset, options.integrator,
+                                         static_cast<std::uint64_t>(options.first_sample), options.adaptive, options.min_samples_per_pixel, options.error_threshold,
+                                         options.roulette_min_depth, options.sampler, options.fast_math ? ShadingMath::Fast : ShadingMath::Reference};
 
-    std::ofstream bin_file("image_binary.ppm", std::ios_base::binary);
-    bin_file << "P6\n" << image_width << ' ' << image_height << '\n' << max_pixel_value << '\n';
-    
-    {
-        PROFILE_LOG_SCOPE("Image Generation");
-        for(int y = image_height - 1; y >= 0; --y) {
-            std::cerr << "\rScanlines remaining: " << y << ' ' << std::flush;
-            for(int x = 0; x < image_width; ++x) {
-                Color pixel_color{ 0.0f, 0.0f, 0.0f };
-                for(int sample = 0; sample < samples_per_pixel; ++sample) {
-                    const auto u = (x + random_float()) / (image_width - 1);
-                    const auto v = (y + random_float()) / (image_height - 1);
-                    const auto r = camera.get_ray(u, v);
-                    pixel_color += ray_color(r, world, max_depth);
+    //Acceleration
+    std::shared_ptr<const Hittable> accelerator{};
+    std::shared_ptr<const StaticSphereScene> static_scene{};
+    std::unique_ptr<AnimatedSpheres> animated{};
+    if(options.frame_count > 1 && (options.moving_spheres || !scene.sphere_motions.empty())) {
+        SphereBatch spheres = from_file ? scene.spheres : SphereBatch{};
+        if(options.dispatch == Dispatch::Static || (!from_file && !make_sphere_batch(world, spheres))) {
+            std::cerr << "--frames: moving spheres need a scene of spheres only and --dispatch virtual.\n";
+            return 1;
+        }
+        PROFILE_SCOPE("Build Animated Spheres");
+        auto motions = options.moving_spheres ? cover_scene_motions(spheres) : scene.sphere_motions;
+        std::cerr << "Animating " << motions.size() << " of " << spheres.size() << " spheres.\n";
+        animated = std::make_unique<AnimatedSpheres>(spheres, std::move(motions), options.use_bvh);
+        if(animated->bvh()) {
+            std::cerr << animated->bvh()->build_stats() << '\n';
+        }
+    } else if(options.dispatch == Dispatch::Static) {
+        SphereBatch spheres = from_file ? scene.spheres : SphereBatch{};
+        if(!from_file && !make_sphere_batch(world, spheres)) {
+            std::cerr << "--dispatch static: the scene has objects other than spheres.\n";
+            return 1;
+        }
+        PROFILE_SCOPE("Build Static Scene");
+        static_scene = std::make_shared<const StaticSphereScene>(make_static_scene(spheres, options.use_bvh));
+        std::cerr << "Static dispatch: " << static_scene->size() << " spheres" << (static_scene->has_bvh() ? " in a BVH" : "") << ".\n";
+        accelerator = static_scene;
+    } else if(options.use_bvh) {
+        const auto leaf_format = options.use_sphere_batch ? BvhLeafFormat::SphereBatch : BvhLeafFormat::Objects;
+        auto bvh = options.use_sphere_batch ? scene.bvh : nullptr;
+        if(bvh) {
+            std::cerr << "Using the BVH stored in " << options.scene_path << ".\n";
+        } else {
+            PROFILE_SCOPE("Build BVH");
+            bvh = from_file && options.use_sphere_batch ? std::make_shared<const Bvh>(scene.spheres) : std::make_shared<const Bvh>(world, leaf_format);
+        }
+        std::cerr << bvh->build_stats() << '\n';
+        if(bvh->leaf_format() == BvhLeafFormat::SphereBatch) {
+            std::cerr << "BVH leaves: " << SphereBatch::kernel_name() << " sphere batches of up to " << SphereBatch::lane_count << '\n';
+        }
+        if(options.report_bvh_traversal) {
+            report_bvh_traversal(*bvh, scene, camera, settings);
+        }
+        accelerator = std::move(bvh);
+    } else if(options.use_sphere_batch && !from_file) {
+        auto batch = std::make_shared<SphereBatch>();
+        if(make_sphere_batch(world, *batch)) {
+            accelerator = std::move(batch);
+        }
+    }
+    const Hittable& traceable = animated ? animated->world() : accelerator ? *accelerator : from_file && options.use_sphere_batch ? static_cast<const Hittable&>(scene.spheres) : static_cast<const Hittable&>(world);
+
+    ThreadPool pool{options.thread_count ? options.thread_count : ThreadPool::default_thread_count()};
+    std::cerr << "Rendering " << image_width << 'x' << image_height << " with " << pool.thread_count() << " threads.\n";
+
+    Framebuffer framebuffer{image_width, image_height};
+    auto tiles = make_tiles(image_width, image_height, settings.tile_size);
+    if(options.first_tile > 0 || options.last_tile >= 0) {
+        const auto last_tile = options.last_tile < 0 ? static_cast<int>(tiles.size()) - 1 : options.last_tile;
+        if(last_tile >= static_cast<int>(tiles.size()) || options.first_tile > last_tile) {
+            std::cerr << "--tiles: the image only has tiles 0-" << tiles.size() - 1 << '\n';
+            return 1;
+        }
+        tiles = std::vector<Tile>(tiles.begin() + options.first_tile, tiles.begin() + last_tile + 1);
+        std::cerr << "Rendering tiles " << options.first_tile << '-' << last_tile << ".\n";
+    }
+    if(options.frame_count > 1) {
+        const auto exit_code = render_sequence(options, scene, traceable, static_scene.get(), animated.get(), settings, pool, tiles);
+        if(!options.profile_path.empty() && RTIOW_PROFILER) {
+            write_profile(options.profile_path);
+        }
+        return exit_code;
+    }
+    //Including the tiles a resumed render restores instead of rendering.
+    const auto image_tiles = tiles;
+    std::unique_ptr<CheckpointWriter> checkpoint{};
+    if(!options.checkpoint_path.empty()) {
+        try {
+            const auto header = make_checkpoint_header(settings, scene_fingerprint(scene));
+            std::uint64_t resume_from_bytes = 0;
+            if(options.resume && std::filesystem::exists(options.checkpoint_path)) {
+                const auto contents = read_checkpoint(options.checkpoint_path, framebuffer);
+                if(contents.header.scene_fingerprint != header.scene_fingerprint) {
+                    throw std::runtime_error(options.checkpoint_path + " was made from a different scene");
                 }
-                write_color_binary(bin_file, pixel_color, samples_per_pixel);
+                if(!(contents.header == header)) {
+                    throw std::runtime_error(options.checkpoint_path + " was made with different render settings");
+                }
+                std::cerr << "Resuming " << options.checkpoint_path << ": " << contents.tiles.size() << " of " << tiles.size() << " tiles already rendered.\n";
+                tiles = remaining_tiles(tiles, contents.tiles);
+                resume_from_bytes = contents.valid_bytes;
             }
+            checkpoint = std::make_unique<CheckpointWriter>(options.checkpoint_path, header, framebuffer, std::chrono::seconds{options.checkpoint_interval_seconds}, resume_from_bytes);
+        } catch(const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return 1;
         }
-        std::cerr << "\nDone.\n";
     }
-    bin_file.close();
-    return 0;
-}
-
-Color ray_color(const Ray3& r, const Hittable& world, int depth) {
-    hit_record rec{};
+    const auto tile_done = checkpoint ? TileDoneCallback{[&checkpoint](const Tile& tile) { checkpoint->tile_done(tile); }} : TileDoneCallback{};
 
-    //If we've exceeded the ray bounce limit, no more light is gathered.
-    if(depth <= 0) {
-        return Color{0.0f, 0.0f, 0.0f};
+    RenderResult result{};
+    {
+        PROFILE_LOG_SCOPE("Image Generation");
+        if(!options.preview_path.empty()) {
+            result = render_progressive(options, scene, traceable, static_scene.get(), camera, settings, pool, tiles, framebuffer);
+        } else {
+            result = static_scene ? render(*static_scene, scene.materials, camera, settings, pool, tiles, framebuffer, tile_done)
+                                  : render(traceable, scene.materials, camera, settings, pool, tiles, framebuffer, tile_done);
+        }
+        std::cerr << "Done.\n";
     }
-    if(world.hit(r, 0.001f, infinity, rec)) {
-        Ray3 scattered{};
-        if(rec.material.scatter(r, rec, scattered)) {
-            return rec.material.color * ray_color(scattered, world, depth - 1);
+    std::cerr << "Traced " << result.ray_count << " rays with the " << settings.integrator << " integrator and " << settings.shading_math << " shading math: "
+              << (result.ray_count / result.seconds) * 1e-6 << " Mrays/s\n";
+    if(options.report_ray_stats || !options.ray_stats_json_path.empty()) {
+        if(!RTIOW_RAY_STATS) {
+            std::cerr << "This build has no ray statistics (RTIOW_RAY_STATS is 0).\n";
+        } else if(options.report_ray_stats) {
+            print_ray_stats(std::cerr, result.stats, result.seconds);
         }
-        return Color{0.0f, 0.0f, 0.0f};
+        if(!options.ray_stats_json_path.empty() && !write_ray_stats(options.ray_stats_json_path, result, settings, options, pool.thread_count())) {
+            std::cerr << "Could not write " << options.ray_stats_json_path << '\n';
+        }
+    }
+    if(checkpoint && !checkpoint->finish()) {
+        std::cerr << "Could not write checkpoint " << options.checkpoint_path << '\n';
+    }
+
+    if((options.denoise || !options.aov_prefix.empty()) && !apply_aovs(options, traceable, scene, camera, settings, pool, image_tiles, framebuffer)) {
+        return 1;
+    }
+
+    if(settings.adaptive) {
+        report_adaptive_sampling(framebuffer, settings);
+        write_sample_heatmap("sample_heatmap.ppm", framebuffer, settings);
     }
 
-    Vector3 direction = unit_vector(r.direction());
-    auto t = 0.5f * (direction.y() + 1.0f);
-    return (1.0f - t) * Color(1.0f, 1.0f, 1.0f) + t * Color(0.5f, 0.7f, 1.0f);
+    const auto written = write_outputs(framebuffer, options.output_paths);
+    if(!options.profile_path.empty() && RTIOW_PROFILER) {
+        write_profile(options.profile_path);
+    }
+    return written ? 0 : 1;
 }
 
 float hit_sphere(const Point3& center, float radius, const Ray3& r) {
@@ -113,46 +266,404 @@ float hit_sphere(const Point3& center, float radius, const Ray3& r) {
     }
 }
 
-HittableList random_scene() {
-    HittableList world{};
-
-    const auto ground_material = make_lambertian(MaterialDesc{ Color{0.5f, 0.5f, 0.5f} });
-    world.add(std::make_shared<Sphere3>(Point3{0.0f, -1000.0f, 0.0f}, 1000.0f, ground_material));
-
-    for(int a = -11; a < 11; ++a) {
-        for(int b = -11; b < 11; ++b) {
-            const auto choose_mat = random_float();
-            const auto center = Point3{a + 0.9f * random_float(), 0.2f, b + 0.9f * random_float()};
-
-            if((center - Point3{4.0f, 0.2f, 0.0f}).length() > 0.9f) {
-                Material material{};
-                MaterialDesc desc{};
-                if(choose_mat < 0.8f) {
-                    desc.color = Color::random() * Color::random();
-                    material = make_lambertian(desc);
-                } else if(choose_mat < 0.95f) {
-                    desc.color = Color::random(0.5f, 1.0f);
-                    desc.roughness = random_float(0.0f, 0.5f);
-                    desc.metallic = 1.0f;
-                    material = make_metal(desc);
-                } else {
-                    desc.refractionIndex = 1.5f;
-                    desc.color = Color{1.0f, 1.0f, 1.0f};
-                    desc.roughness = 0.0f;
-                    material = make_dielectric(desc);
+//Follows one path per cell of a coarse grid over the image and reports how much
+//work the BVH does per ray, next to the cost of testing every object.
+void report_bvh_traversal(const Bvh& bvh, const Scene& scene, const Camera& camera, const RenderSettings& settings) {
+    constexpr int grid_size = 64;
+    BvhTraversalStats stats{};
+    for(int j = 0; j < grid_size; ++j) {
+        for(int i = 0; i < grid_size; ++i) {
+            const auto path_key = make_path_key(settings.seed, static_cast<std::uint64_t>(j) * grid_size + i, 0);
+            seed_thread_rng(path_key, 0);
+            auto r = camera.get_ray((i + 0.5f) / grid_size, (j + 0.5f) / grid_size);
+            for(int depth = settings.max_depth; depth > 0; --depth) {
+                hit_record rec{};
+                if(!bvh.hit(r, 0.001f, infinity, rec, stats)) {
+                    break;
+                }
+                seed_thread_rng(path_key, static_cast<std::uint32_t>(depth));
+                Ray3 scattered{};
+                if(!scene.materials[rec.material_id].scatter(r, rec, scattered)) {
+                    break;
+                }
+                r = scattered;
+            }
+        }
+    }
+    std::cerr << stats << " (linear scan: " << primitive_count(scene) << " tests/ray)\n";
+}
+
+void report_adaptive_sampling(const Framebuffer& framebuffer, const RenderSettings& settings) {
+    std::uint64_t total = 0;
+    std::size_t at_maximum = 0;
+    for(const auto count : framebuffer.sample_counts()) {
+        total += count;
+        at_maximum += count >= static_cast<std::uint32_t>(settings.samples_per_pixel) ? 1u : 0u;
+    }
+    const auto pixel_count = static_cast<double>(framebuffer.pixel_count());
+    std::cerr << "Adaptive sampling: " << total / pixel_count << " samples per pixel on average ("
+              << settings.min_samples_per_pixel << " to " << settings.samples_per_pixel << "), "
+              << 100.0 * at_maximum / pixel_count << "% of pixels used the whole budget\n";
+}
+
+//Samples taken per pixel, from blue at min_samples_per_pixel through green to
+//red at samples_per_pixel, written next to the image in the same orientation.
+void write_sample_heatmap(const std::string& path, const Framebuffer& framebuffer, const RenderSettings& settings) {
+    const auto low = static_cast<float>(settings.min_samples_per_pixel);
+    const auto range = (std::max)(1.0f, static_cast<float>(settings.samples_per_pixel) - low);
+    std::vector<std::uint8_t> rgb{};
+    rgb.reserve(framebuffer.pixel_count() * 3);
+    for(const auto count : framebuffer.sample_counts()) {
+        const auto t = std::clamp((static_cast<float>(count) - low) / range, 0.0f, 1.0f);
+        const auto red = std::clamp(2.0f * t - 1.0f, 0.0f, 1.0f);
+        const auto blue = std::clamp(1.0f - 2.0f * t, 0.0f, 1.0f);
+        const auto green = 1.0f - red - blue;
+        rgb.push_back(static_cast<std::uint8_t>(255.0f * red));
+        rgb.push_back(static_cast<std::uint8_t>(255.0f * green));
+        rgb.push_back(static_cast<std::uint8_t>(255.0f * blue));
+    }
+    if(write_file(path, encode_ppm(settings.image_width, settings.image_height, rgb))) {
+        std::cerr << "Wrote sample counts to " << path << '\n';
+    } else {
+        std::cerr << "Could not write " << path << '\n';
+    }
+}
+
+bool write_outputs(const Framebuffer& framebuffer, const std::vector<std::string>& paths) {
+    PROFILE_SCOPE_FUNCTION();
+    for(const auto& path : paths) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto bytes = encode_image(framebuffer, image_format_from_path(path));
+        if(!write_file(path, bytes)) {
+            std::cerr << "Could not write " << path << '\n';
+            return false;
+        }
+        const auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Wrote " << path << " (" << bytes.size() << " bytes) in " << milliseconds << " ms\n";
+    }
+    return true;
+}
+
+//Renders the AOVs of the tiles, writes them if asked to and denoises the framebuffer
+//if asked to. Returns false if an AOV could not be written.
+bool apply_aovs(const RenderOptions& options, const Hittable& world, const Scene& scene, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer) {
+    //The guides only need to resolve edges, which a few samples do.
+    constexpr int max_aov_samples = 8;
+    auto start = std::chrono::steady_clock::now();
+    const auto aovs = render_aovs(world, scene.materials, camera, settings, pool, tiles, (std::min)(settings.samples_per_pixel, max_aov_samples));
+    std::cerr << "Rendered AOVs in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+    if(!options.aov_prefix.empty()) {
+        const auto written = write_outputs(aovs.albedo, {options.aov_prefix + "_albedo.pfm"})
+                          && write_outputs(aovs.normal, {options.aov_prefix + "_normal.pfm"})
+                          && write_outputs(aovs.depth, {options.aov_prefix + "_depth.pfm"});
+        if(!written) {
+            return false;
+        }
+    }
+    if(options.denoise) {
+        start = std::chrono::steady_clock::now();
+        denoise(framebuffer, aovs, DenoiseSettings{}, pool);
+        std::cerr << "Denoised in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() << " ms\n";
+    }
+    return true;
+}
+
+//Renders options.frame_count frames along the scene's camera keys, or an
+//orbit if it has none, and writes each to the output paths with its number.
+//Before each frame the animated spheres, if any, move and their BVH is
+//refit or rebuilt; the pool, framebuffer, tiles and everything else are made
+//once and reused, so a frame costs its render, its BVH update and its writes.
+int render_sequence(const RenderOptions& options, const Scene& scene, const Hittable& world, const StaticSphereScene* static_scene, AnimatedSpheres* animated, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles) {
+    constexpr float default_orbit_degrees = 30.0f;
+    const auto keys = scene.camera_keys.empty() ? orbit_camera_keys(scene.camera, default_orbit_degrees) : scene.camera_keys;
+    Framebuffer framebuffer{settings.image_width, settings.image_height};
+    auto frame_options = options;
+    double total_frame_ms = 0.0;
+    double total_render_ms = 0.0;
+    double total_update_ms = 0.0;
+    for(int frame = 0; frame < options.frame_count; ++frame) {
+        const auto start = std::chrono::steady_clock::now();
+        const auto time = static_cast<float>(frame) / static_cast<float>(options.frame_count - 1);
+        const auto update_ms = animated ? animated->update(time, options.bvh_update) : 0.0;
+        const auto camera = make_camera(camera_at(keys, scene.camera, time), options.aspect_ratio);
+        const auto result = static_scene ? render(*static_scene, scene.materials, camera, settings, pool, tiles, framebuffer)
+                                         : render(world, scene.materials, camera, settings, pool, tiles, framebuffer);
+        if(options.report_ray_stats && RTIOW_RAY_STATS) {
+            print_ray_stats(std::cerr, result.stats, result.seconds);
+        }
+        if(!options.aov_prefix.empty()) {
+            frame_options.aov_prefix = frame_path(options.aov_prefix, frame);
+        }
+        if((options.denoise || !options.aov_prefix.empty()) && !apply_aovs(frame_options, world, scene, camera, settings, pool, tiles, framebuffer)) {
+            return 1;
+        }
+        std::vector<std::string> paths{};
+        for(const auto& path : options.output_paths) {
+            paths.emplace_back(frame_path(path, frame));
+        }
+        if(!write_outputs(framebuffer, paths)) {
+            return 1;
+        }
+        const auto frame_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Frame " << frame << " of " << options.frame_count << ": " << frame_ms << " ms, render " << result.seconds * 1e3 << " ms ("
+                  << (result.ray_count / result.seconds) * 1e-6 << " Mrays/s)";
+        if(animated) {
+            std::cerr << ", moving spheres" << (animated->bvh() ? " and BVH " : " ") << update_ms << " ms";
+        }
+        std::cerr << '\n';
+        total_frame_ms += frame_ms;
+        total_render_ms += result.seconds * 1e3;
+        total_update_ms += update_ms;
+    }
+    const auto frames = static_cast<double>(options.frame_count);
+    std::cerr << "Rendered " << options.frame_count << " frames. Per frame: " << total_frame_ms / frames << " ms, render "
+              << total_render_ms / frames << " ms, scene update " << total_update_ms / frames << " ms";
+    if(animated && animated->bvh()) {
+        std::cerr << " (BVH " << options.bvh_update << ')';
+    }
+    std::cerr << ", everything else " << (total_frame_ms - total_render_ms - total_update_ms) / frames << " ms\n";
+    return 0;
+}
+
+//path with the frame number before its extension: image.ppm becomes image_0007.ppm.
+std::string frame_path(const std::string& path, int frame) {
+    auto number = std::to_string(frame);
+    number.insert(0, number.size() < 4 ? 4 - number.size() : 0, '0');
+    const auto file = std::filesystem::path{path};
+    return (file.parent_path() / (file.stem().string() + '_' + number + file.extension().string())).string();
+}
+
+//Renders settings.samples_per_pixel passes of one sample per pixel, after a
+//one-sample pass at 1/options.preview_lowres of the resolution if asked for,
+//and streams the running average to options.preview_path. Pass i takes sample
+//i of every pixel, so the finished framebuffer holds the same samples a single
+//render would. Between passes this thread only adds the pass to the
+//framebuffer and copies it into the stream's mailbox; encoding and writing
+//happen on the stream's thread while the workers render the next pass.
+RenderResult render_progressive(const RenderOptions& options, const Scene& scene, const Hittable& world, const StaticSphereScene* static_scene, const Camera& camera, const RenderSettings& settings, ThreadPool& pool, const std::vector<Tile>& tiles, Framebuffer& framebuffer) {
+    const auto interval = std::chrono::milliseconds{static_cast<long long>(1000.0f / options.preview_fps)};
+    PreviewStream preview{options.preview_path, settings.image_width, settings.image_height, interval};
+    RenderResult total{};
+    const auto render_pass = [&](const RenderSettings& pass_settings, const std::vector<Tile>& pass_tiles, Framebuffer& pass_framebuffer) {
+        const auto result = static_scene ? render(*static_scene, scene.materials, camera, pass_settings, pool, pass_tiles, pass_framebuffer)
+                                         : render(world, scene.materials, camera, pass_settings, pool, pass_tiles, pass_framebuffer);
+        total.ray_count += result.ray_count;
+        total.seconds += result.seconds;
+        total.stats += result.stats;
+    };
+
+    auto pass_settings = settings;
+    pass_settings.samples_per_pixel = 1;
+    //The passes are short and many; the summary line below reports on them.
+    pass_settings.report_progress = false;
+    if(options.preview_lowres > 1) {
+        auto lowres_settings = pass_settings;
+        lowres_settings.image_width = (std::max)(1, settings.image_width / options.preview_lowres);
+        lowres_settings.image_height = (std::max)(1, settings.image_height / options.preview_lowres);
+        Framebuffer lowres{lowres_settings.image_width, lowres_settings.image_height};
+        render_pass(lowres_settings, make_tiles(lowres_settings.image_width, lowres_settings.image_height, settings.tile_size), lowres);
+        preview.post(lowres);
+    }
+
+    Framebuffer pass{settings.image_width, settings.image_height};
+    double between_passes_ms = 0.0;
+    for(int sample = 0; sample < settings.samples_per_pixel; ++sample) {
+        pass_settings.first_sample = settings.first_sample + static_cast<std::uint64_t>(sample);
+        render_pass(pass_settings, tiles, pass);
+        const auto start = std::chrono::steady_clock::now();
+        for(std::size_t i = 0; i < framebuffer.pixel_count(); ++i) {
+            framebuffer.accumulate(i, pass.sum(i), pass.sample_count(i));
+        }
+        if(preview.frame_due() || sample + 1 == settings.samples_per_pixel) {
+            preview.post(framebuffer);
+        }
+        between_passes_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    if(!preview.finish()) {
+        std::cerr << "Could not stream the preview to " << options.preview_path << '\n';
+    }
+    std::cerr << "Preview: " << settings.samples_per_pixel << " passes, " << preview.frames_sent() << " frames streamed, "
+              << preview.frames_replaced() << " replaced by newer ones before they were sent, "
+              << between_passes_ms / settings.samples_per_pixel << " ms between passes\n";
+    return total;
+}
+
+int serve(const RenderOptions& options) {
+    //The server runs until it is stopped, and would keep every scope of every
+    //job; record them only when they are written out at the end.
+    profiler_set_recording(!options.profile_path.empty());
+    PROFILE_THREAD_NAME("Main");
+    if(!options.profile_path.empty() && !RTIOW_PROFILER) {
+        std::cerr << "--profile: this build has no profiler (RTIOW_PROFILER is 0), nothing is written.\n";
+    }
+    try {
+        RenderServer server{options.socket_path, options.thread_count ? options.thread_count : ThreadPool::default_thread_count(), options.scene_cache_size};
+        std::cerr << "Serving on " << options.socket_path << " with " << server.thread_count() << " threads and room for " << options.scene_cache_size << " scenes.\n";
+        server.run();
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    std::cerr << "Stopped.\n";
+    if(!options.profile_path.empty() && RTIOW_PROFILER) {
+        write_profile(options.profile_path);
+    }
+    return 0;
+}
+
+//Sends one job built from the command line and writes the image that comes back.
+int submit(const RenderOptions& options) {
+    try {
+        if(options.stop_server) {
+            stop_server(options.socket_path);
+            std::cerr << "The server on " << options.socket_path << " is stopping.\n";
+            return 0;
+        }
+        RenderJob job{};
+        //The server may run elsewhere in the file system; send a path it can open.
+        job.scene = options.scene_path.empty() ? std::string{"random"} : std::filesystem::absolute(options.scene_path).string();
+        job.image_width = options.image_width;
+        job.image_height = options.image_height;
+        job.samples_per_pixel = options.samples_per_pixel;
+        job.max_depth = options.max_depth;
+        job.seed = options.seed;
+        job.priority = options.priority;
+        job.look_from = options.look_from;
+        job.look_at = options.look_at;
+        const auto& path = options.output_paths.front();
+        job.format = image_format_from_path(path);
+        const auto reply = submit_job(options.socket_path, job);
+        if(!reply.error.empty()) {
+            std::cerr << "The server could not render the job: " << reply.error << '\n';
+            return 1;
+        }
+        if(!write_file(path, reply.image)) {
+            std::cerr << "Could not write " << path << '\n';
+            return 1;
+        }
+        std::cerr << "Wrote " << path << ": queued " << reply.queued_ms << " ms, ";
+        if(reply.scene_ms > 0.0) {
+            std::cerr << "scene built in " << reply.scene_ms << " ms, ";
+        } else {
+            std::cerr << "scene cached, ";
+        }
+        std::cerr << "render " << reply.render_ms << " ms\n";
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
+
+//Adds up the tiles and samples of partial renders. Every pixel's radiance sum
+//and sample count are added separately, so each partial is weighted by how many
+//samples it holds when the encoder divides one by the other.
+int merge_partials(const RenderOptions& options) {
+    Framebuffer framebuffer{};
+    std::vector<CheckpointContents> partials{};
+    try {
+        for(const auto& path : options.merge_inputs) {
+            auto contents = read_checkpoint(path, framebuffer, CheckpointRead::Accumulate);
+            const auto& header = contents.header;
+            if(!partials.empty() && header.max_depth != partials.front().header.max_depth) {
+                throw std::runtime_error(path + " was rendered with a different max_depth");
+            }
+            if(!partials.empty() && header.scene_fingerprint != partials.front().header.scene_fingerprint) {
+                throw std::runtime_error(path + " was rendered from a different scene");
+            }
+            if(!partials.empty() && header.shading_math != partials.front().header.shading_math) {
+                throw std::runtime_error(path + " was rendered with a different shading math");
+            }
+            for(std::size_t i = 0; i < partials.size(); ++i) {
+                if(samples_overlap(partials[i], contents)) {
+                    throw std::runtime_error(path + " holds some of the same samples as " + options.merge_inputs[i]);
                 }
-                world.add(std::make_shared<Sphere3>(center, 0.2f, material));
             }
+            std::cerr << path << ": " << contents.tiles.size() << " tiles, samples " << header.first_sample << '-'
+                      << header.first_sample + header.samples_per_pixel - 1 << ", seed " << header.seed << '\n';
+            partials.emplace_back(std::move(contents));
         }
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
     }
+    const auto& counts = framebuffer.sample_counts();
+    const auto empty_pixels = std::count(counts.begin(), counts.end(), 0u);
+    if(empty_pixels > 0) {
+        std::cerr << "Warning: " << empty_pixels << " pixels have no samples in any partial file.\n";
+    }
+    return write_outputs(framebuffer, options.output_paths) ? 0 : 1;
+}
 
-    const auto glass = make_dielectric(MaterialDesc{ Color{1.0f, 1.0f, 1.0f}, 0.0f, 0.0f, 1.5f });
-    const auto lambertian = make_lambertian(MaterialDesc{ Color{0.4f, 0.2f, 0.1f}});
-    const auto metal = make_metal(MaterialDesc{ Color{0.7f, 0.6f, 0.5f}, 0.0f, 1.0f});
+//The random cover scene, or the scene file the options name.
+Scene build_scene(const RenderOptions& options) {
+    if(options.scene_path.empty()) {
+        PROFILE_SCOPE("Build Scene");
+        return random_scene();
+    }
+    PROFILE_SCOPE("Load Scene");
+    const auto start = std::chrono::steady_clock::now();
+    auto scene = load_scene(options.scene_path);
+    const auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Loaded " << options.scene_path << " (" << primitive_count(scene) << " objects, " << scene.materials.size() << " materials) in " << milliseconds << " ms\n";
+    return scene;
+}
 
-    world.add(std::make_shared<Sphere3>(Point3{0.0f, 1.0f, 0.0f}, 1.0f, glass));
-    world.add(std::make_shared<Sphere3>(Point3{-4.0f, 1.0f, 0.0f}, 1.0f, lambertian));
-    world.add(std::make_shared<Sphere3>(Point3{4.0f, 1.0f, 0.0f}, 1.0f, metal));
+//Writes the input scene as a compiled scene if the output ends in .rtsc, as text otherwise.
+int compile_scene(const RenderOptions& options) {
+    try {
+        const auto scene = options.compile_input == "random" ? random_scene() : load_scene(options.compile_input);
+        const auto start = std::chrono::steady_clock::now();
+        const auto compiled = std::filesystem::path{options.compile_output}.extension() == ".rtsc";
+        const auto written = compiled ? write_compiled_scene(scene, options.compile_output, options.compile_bvh) : write_scene_text(scene, options.compile_output);
+        if(!written) {
+            std::cerr << "Could not write " << options.compile_output << '\n';
+            return 1;
+        }
+        const auto milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << "Wrote " << primitive_count(scene) << " spheres to " << options.compile_output << " in " << milliseconds << " ms\n";
+    } catch(const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+    return 0;
+}
 
-    return world;
-}
\ No newline at end of file
+void write_profile(const std::string& path) {
+    print_profile_summary(std::cerr, profiler_summary());
+    if(write_chrome_trace(path)) {
+        std::cerr << "Wrote a Chrome trace to " << path << '\n';
+    } else {
+        std::cerr << "Could not write " << path << '\n';
+    }
+}
+
+bool write_ray_stats(const std::string& path, const RenderResult& result, const RenderSettings& settings, const RenderOptions& options, unsigned int thread_count) {
+    std::ostringstream integrator{};
+    integrator << settings.integrator;
+    std::ostringstream sampler{};
+    sampler << settings.sampler;
+    std::ostringstream dispatch{};
+    dispatch << options.dispatch;
+    std::ostringstream shading_math{};
+    shading_math << settings.shading_math;
+    const std::vector<std::pair<std::string, std::string>> context{
+        {"threads", std::to_string(thread_count)}
+        ,{"hardware_threads", std::to_string(std::thread::hardware_concurrency())}
+        ,{"sphere_batch_kernel", SphereBatch::kernel_name()}
+        ,{"accelerator", options.use_bvh ? "bvh" : options.use_sphere_batch ? "sphere_batch" : "list"}
+        ,{"integrator", integrator.str()}
+        ,{"dispatch", dispatch.str()}
+        ,{"image_width", std::to_string(settings.image_width)}
+        ,{"image_height", std::to_string(settings.image_height)}
+        ,{"samples_per_pixel", std::to_string(settings.samples_per_pixel)}
+        ,{"max_depth", std::to_string(settings.max_depth)}
+        ,{"adaptive", settings.adaptive ? "true" : "false"}
+        ,{"roulette_min_depth", std::to_string(settings.roulette_min_depth)}
+        ,{"sampler", sampler.str()}
+        ,{"shading_math", shading_math.str()}
+    };
+    std::ofstream file{path};
+    write_ray_stats_json(file, result.stats, result.seconds, context);
+    return static_cast<bool>(file);
+}